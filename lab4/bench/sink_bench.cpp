@@ -0,0 +1,216 @@
+// Бенчмарк записи журналов логгера по мере роста файлов:
+// прежняя схема (measurements.log переписывается целиком на каждое измерение,
+// hourly_avg.log и daily_avg.log перечитываются и переписываются через временные файлы)
+// против сегментированных журналов только на дозапись (src/segmented_log.h).
+// Измерения идут с шагом 5 с (как у симулятора), печатается samples/s
+// для каждого блока из STEP измерений и размер журнала измерений.
+//
+// Сборка и запуск из каталога lab4:
+//   g++ -std=c++17 -O2 -Isrc -o bench/sink_bench bench/sink_bench.cpp
+//   bench/sink_bench [--samples N] [--step N]
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "segmented_log.h"
+
+using Clock = std::chrono::steady_clock;
+
+const long SAMPLE_INTERVAL = 5;
+
+std::tm localTm(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    return tm;
+}
+
+double sampleValue(long i) {
+    return 18.0 + (i % 1000) / 100.0;
+}
+
+// Прежний логгер lab4: все файлы переписываются на каждое измерение
+class LegacySink {
+public:
+    explicit LegacySink(const std::string& dir) : dir(dir) {}
+
+    void add(std::time_t epoch, double value, std::time_t now) {
+        std::tm tm = localTm(epoch);
+        measurements.push_back({epoch, value});
+        while (!measurements.empty() && now - measurements.front().first > 24 * 3600) {
+            measurements.pop_front();
+        }
+
+        {
+            std::ifstream in(dir + "/daily_avg.log");
+            std::ofstream out(dir + "/daily_tmp.log");
+            std::string line;
+            while (std::getline(in, line)) {
+                std::tm t{};
+                std::istringstream ss(line);
+                ss >> std::get_time(&t, "%Y-%m-%d");
+                if (!ss.fail() && (t.tm_year == tm.tm_year || t.tm_year == tm.tm_year - 1)) {
+                    out << line << '\n';
+                }
+            }
+            in.close();
+            out.close();
+            std::rename((dir + "/daily_tmp.log").c_str(), (dir + "/daily_avg.log").c_str());
+        }
+        {
+            std::ifstream in(dir + "/hourly_avg.log");
+            std::ofstream out(dir + "/hourly_tmp.log");
+            std::string line;
+            while (std::getline(in, line)) {
+                std::tm t{};
+                std::istringstream ss(line);
+                ss >> std::get_time(&t, "%Y-%m-%d");
+                if (now - std::mktime(&t) < 30 * 86400) out << line << "\n";
+            }
+            in.close();
+            out.close();
+            std::rename((dir + "/hourly_tmp.log").c_str(), (dir + "/hourly_avg.log").c_str());
+        }
+
+        if (currentHour != -1 && tm.tm_hour != currentHour) {
+            std::ofstream(dir + "/hourly_avg.log", std::ios::app)
+                << std::put_time(&tm, "%Y-%m-%d ") << currentHour << " " << value << "\n";
+        }
+        if (currentDay != -1 && tm.tm_mday != currentDay) {
+            std::ofstream(dir + "/daily_avg.log", std::ios::app) << std::put_time(&tm, "%Y-%m-%d ") << value << "\n";
+        }
+        currentHour = tm.tm_hour;
+        currentDay = tm.tm_mday;
+
+        std::ofstream f(dir + "/measurements.log", std::ios::trunc);
+        for (const auto& m : measurements) {
+            std::tm mt = localTm(m.first);
+            f << std::put_time(&mt, "%Y-%m-%dT%H:%M:%S") << " " << m.second << "\n";
+        }
+    }
+
+    std::uintmax_t measurementBytes() const {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(dir + "/measurements.log", ec);
+        return ec ? 0 : size;
+    }
+
+private:
+    std::string dir;
+    std::deque<std::pair<std::time_t, double>> measurements;
+    int currentHour = -1;
+    int currentDay = -1;
+};
+
+// Сегментированные журналы, как в src/logger.cpp
+class SegmentedSink {
+public:
+    explicit SegmentedSink(const std::string& dir)
+        : dir(dir), measurementLog(dir + "/measurements"), hourlyLog(dir + "/hourly_avg"),
+          dailyLog(dir + "/daily_avg") {}
+
+    void add(std::time_t epoch, double value, std::time_t now) {
+        std::tm tm = localTm(epoch);
+        std::string segment = SegmentedLog::name(tm, "%Y-%m-%dT%H");
+        if (segment != currentSegment) {
+            measurementLog.dropBefore(SegmentedLog::name(localTm(now - 24 * 3600), "%Y-%m-%dT%H"));
+            hourlyLog.dropBefore(SegmentedLog::name(localTm(now - 30 * 86400), "%Y-%m-%d"));
+            dailyLog.dropBefore(std::to_string(tm.tm_year + 1900 - 1) + "-01");
+            currentSegment = segment;
+        }
+        if (currentHour != -1 && tm.tm_hour != currentHour) {
+            hourlyLog.at(SegmentedLog::name(tm, "%Y-%m-%d"))
+                << std::put_time(&tm, "%Y-%m-%d ") << currentHour << " " << value << std::endl;
+        }
+        if (currentDay != -1 && tm.tm_mday != currentDay) {
+            dailyLog.at(SegmentedLog::name(tm, "%Y-%m")) << std::put_time(&tm, "%Y-%m-%d ") << value << std::endl;
+        }
+        currentHour = tm.tm_hour;
+        currentDay = tm.tm_mday;
+
+        measurementLog.at(segment) << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S") << " " << value << std::endl;
+    }
+
+    std::uintmax_t measurementBytes() const {
+        std::uintmax_t total = 0;
+        std::error_code ec;
+        for (const auto& name : measurementLog.segments()) {
+            total += std::filesystem::file_size(measurementLog.pathOf(name), ec);
+        }
+        return total;
+    }
+
+private:
+    std::string dir;
+    SegmentedLog measurementLog;
+    SegmentedLog hourlyLog;
+    SegmentedLog dailyLog;
+    std::string currentSegment;
+    int currentHour = -1;
+    int currentDay = -1;
+};
+
+template <typename Sink>
+void run(const char* title, Sink& sink, long samples, long step, std::time_t start, std::time_t now) {
+    std::printf("%s\n", title);
+    std::printf("  %10s %12s %14s\n", "samples", "samples/s", "measurements");
+    auto blockStart = Clock::now();
+    auto total = Clock::now();
+    for (long i = 0; i < samples; ++i) {
+        sink.add(start + i * SAMPLE_INTERVAL, sampleValue(i), now);
+        if ((i + 1) % step == 0 || i + 1 == samples) {
+            long inBlock = (i + 1) % step == 0 ? step : (i + 1) % step;
+            double seconds = std::chrono::duration<double>(Clock::now() - blockStart).count();
+            std::printf("  %10ld %12.0f %11.1f KiB\n", i + 1, inBlock / seconds, sink.measurementBytes() / 1024.0);
+            std::fflush(stdout);
+            blockStart = Clock::now();
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - total).count();
+    std::printf("  total: %.2f s, %.0f samples/s\n\n", seconds, samples / seconds);
+}
+
+int main(int argc, char* argv[]) {
+    long samples = 12000;
+    long step = 2000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--samples" && i + 1 < argc) samples = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--step" && i + 1 < argc) step = std::max(1L, std::atol(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--samples N] [--step N]" << std::endl;
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/sink_benchXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string legacyDir = std::string(dir) + "/legacy";
+    std::string segmentedDir = std::string(dir) + "/segmented";
+    std::filesystem::create_directories(legacyDir);
+    std::filesystem::create_directories(segmentedDir);
+
+    // Измерения заканчиваются текущим моментом; окно 24 ч заполняется
+    // после 24 * 3600 / 5 = 17280 измерений
+    std::time_t now = std::time(nullptr);
+    std::time_t start = now - samples * SAMPLE_INTERVAL;
+
+    LegacySink legacy(legacyDir);
+    run("rewrite (old logger)", legacy, samples, step, start, now);
+    SegmentedSink segmented(segmentedDir);
+    run("append-only segments", segmented, samples, step, start, now);
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
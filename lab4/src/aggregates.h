@@ -0,0 +1,168 @@
+#pragma once
+// Потоковые агрегаты измерений по окнам времени (минута, час, сутки, неделя).
+//
+// Для каждого открытого окна хранится O(1) состояния: число измерений, сумма
+// с компенсацией Кэхэна, минимум, максимум и M2 (сумма квадратов отклонений
+// от среднего, алгоритм Уэлфорда) для дисперсии. Измерения не накапливаются,
+// поэтому память не зависит от частоты измерений. Когда очередное измерение
+// попадает в следующее окно, закрытые окна (все размеры сразу) возвращаются вызывающему.
+//
+// Границы окон - по локальному времени; неделя начинается в понедельник.
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+namespace aggregate {
+
+enum class Window { Minute, Hour, Day, Week };
+
+inline const char* windowName(Window window) {
+    switch (window) {
+    case Window::Minute: return "minute";
+    case Window::Hour: return "hour";
+    case Window::Day: return "day";
+    case Window::Week: return "week";
+    }
+    return "";
+}
+
+// Список окон через запятую: "minute,hour,day,week"
+inline bool parseWindows(const std::string& list, std::vector<Window>& out) {
+    const Window all[] = {Window::Minute, Window::Hour, Window::Day, Window::Week};
+    std::vector<Window> result;
+    std::istringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        auto it = std::find_if(std::begin(all), std::end(all),
+                               [&name](Window w) { return name == windowName(w); });
+        if (it == std::end(all)) return false;
+        if (std::find(result.begin(), result.end(), *it) == result.end()) result.push_back(*it);
+    }
+    if (result.empty()) return false;
+    out = result;
+    return true;
+}
+
+struct Stats {
+    long count = 0;
+    double sum = 0;
+    double compensation = 0;  // потерянные младшие разряды суммы (Кэхэн)
+    double minValue = 0;
+    double maxValue = 0;
+    double mean = 0;
+    double m2 = 0;
+
+    void add(double value) {
+        double y = value - compensation;
+        double t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+
+        minValue = count == 0 ? value : std::min(minValue, value);
+        maxValue = count == 0 ? value : std::max(maxValue, value);
+
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    double average() const {
+        return count > 0 ? sum / count : 0;
+    }
+
+    // Выборочная дисперсия
+    double variance() const {
+        return count > 1 ? m2 / (count - 1) : 0;
+    }
+
+    double stddev() const {
+        return std::sqrt(variance());
+    }
+};
+
+// Номер локальных суток от 1970-01-01 (алгоритм days_from_civil)
+inline long localDays(const std::tm& tm) {
+    long y = tm.tm_year + 1900;
+    unsigned m = static_cast<unsigned>(tm.tm_mon + 1);
+    unsigned d = static_cast<unsigned>(tm.tm_mday);
+    y -= m <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<long>(doe) - 719468;
+}
+
+// Ключ окна: одинаков у всех моментов одного окна, считается по полям без mktime
+inline long windowKey(Window window, const std::tm& tm) {
+    long days = localDays(tm);
+    switch (window) {
+    case Window::Minute: return (days * 24 + tm.tm_hour) * 60 + tm.tm_min;
+    case Window::Hour: return days * 24 + tm.tm_hour;
+    case Window::Day: return days;
+    case Window::Week: {
+        long shifted = days + 3;  // 1970-01-01 - четверг
+        return shifted >= 0 ? shifted / 7 : (shifted - 6) / 7;
+    }
+    }
+    return 0;
+}
+
+// Начало окна, содержащего момент с полями tm
+inline std::time_t windowStart(Window window, const std::tm& tm) {
+    std::tm start = tm;
+    start.tm_sec = 0;
+    if (window != Window::Minute) start.tm_min = 0;
+    if (window == Window::Day || window == Window::Week) start.tm_hour = 0;
+    if (window == Window::Week) start.tm_mday -= (tm.tm_wday + 6) % 7;
+    start.tm_isdst = -1;
+    return std::mktime(&start);
+}
+
+class Aggregator {
+public:
+    struct Closed {
+        Window window;
+        std::time_t start;
+        Stats stats;
+    };
+
+    explicit Aggregator(const std::vector<Window>& windows) {
+        for (Window w : windows) {
+            open.push_back({w, 0, 0, Stats()});
+        }
+    }
+
+    // Добавляет измерение с локальным временем tm. Окна, которые закрыло это
+    // измерение (оно уже относится к следующему окну), дописываются в closed
+    void add(const std::tm& tm, double value, std::vector<Closed>& closed) {
+        for (auto& w : open) {
+            long key = windowKey(w.window, tm);
+            if (w.stats.count == 0 || key != w.key) {
+                if (w.stats.count > 0) {
+                    closed.push_back({w.window, w.start, w.stats});
+                }
+                w.key = key;
+                w.start = windowStart(w.window, tm);
+                w.stats = Stats();
+            }
+            w.stats.add(value);
+        }
+    }
+
+private:
+    struct Open {
+        Window window;
+        long key;
+        std::time_t start;
+        Stats stats;
+    };
+
+    std::vector<Open> open;
+};
+
+}  // namespace aggregate
@@ -1,24 +1,26 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
-#include <deque>
 #include <vector>
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <cstdlib>
+#include <string>
 
-using Clock = std::chrono::system_clock;
+#include "timestamp.h"
+#include "segmented_log.h"
+#include "aggregates.h"
 
-struct Measurement {
-    Clock::time_point time;
-    double value;
-};
+using Clock = std::chrono::system_clock;
 
-Clock::time_point parseTime(const std::string& s) {
-    std::tm tm{};
-    std::istringstream ss(s);
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return Clock::from_time_t(std::mktime(&tm));
+// Строка симулятора "YYYY-MM-DDTHH:MM:SS temperature"
+bool parseLine(timestamp::Parser& parser, const std::string& line, std::time_t& epoch, std::tm& tm,
+               double& temp) {
+    if (!parser.parse(line.data(), line.size(), epoch, &tm)) return false;
+    const char* begin = line.c_str() + 19;
+    char* end;
+    temp = std::strtod(begin, &end);
+    return end != begin;
 }
 
 std::tm toTM(const Clock::time_point& tp) {
@@ -32,132 +34,132 @@ std::tm toTM(const Clock::time_point& tp) {
     return tm;
 }
 
-int main() {
-    std::deque<Measurement> measurements;
-    std::vector<Measurement> hourBuffer;
-    std::vector<Measurement> dayBuffer;
-
-    int currentHour = -1;
-    int currentDay  = -1;
-    int currentYear = -1;
-
-    std::string line;
+// Журналы: измерения - сегмент на час (хранятся 24 часа). Статистика по окнам:
+// за минуту - сегмент на сутки (7 дней), за час - сегмент на сутки (30 дней),
+// за сутки - сегмент на месяц, за неделю - сегмент на год (текущий и прошлый год)
+const char* const MEASUREMENTS_DIR = "measurements";
+const char* const MEASUREMENTS_SEGMENT = "%Y-%m-%dT%H";
+
+// Журнал статистики одного окна агрегации
+struct WindowLog {
+    aggregate::Window window;
+    SegmentedLog log;
+    const char* segment;  // формат имени сегмента
+};
 
-    while (std::getline(std::cin, line)) {
-        std::istringstream ss(line);
-        std::string ts;
-        double temp;
+WindowLog makeWindowLog(aggregate::Window window) {
+    switch (window) {
+    case aggregate::Window::Minute: return {window, SegmentedLog("minute_avg"), "%Y-%m-%d"};
+    case aggregate::Window::Hour: return {window, SegmentedLog("hourly_avg"), "%Y-%m-%d"};
+    case aggregate::Window::Day: return {window, SegmentedLog("daily_avg"), "%Y-%m"};
+    case aggregate::Window::Week: return {window, SegmentedLog("weekly_avg"), "%Y"};
+    }
+    return {window, SegmentedLog("."), ""};
+}
 
-        ss >> ts >> temp;
-        auto tp = parseTime(ts);
-        auto tm = toTM(tp);
+// Строка статистики закрытого окна: метка окна, среднее, min, max, число измерений,
+// выборочная дисперсия. Метки: "YYYY-MM-DDTHH:MM" (минута), "YYYY-MM-DD H" (час),
+// "YYYY-MM-DD" (сутки, неделя - дата понедельника)
+void writeWindow(WindowLog& w, const aggregate::Aggregator::Closed& closed) {
+    std::tm tm = toTM(Clock::from_time_t(closed.start));
+    std::ofstream& out = w.log.at(SegmentedLog::name(tm, w.segment));
+    if (w.window == aggregate::Window::Minute) {
+        out << std::put_time(&tm, "%Y-%m-%dT%H:%M ");
+    } else if (w.window == aggregate::Window::Hour) {
+        out << std::put_time(&tm, "%Y-%m-%d ") << tm.tm_hour << " ";
+    } else {
+        out << std::put_time(&tm, "%Y-%m-%d ");
+    }
+    const aggregate::Stats& s = closed.stats;
+    out << s.average() << " " << s.minValue << " " << s.maxValue << " " << s.count << " "
+        << s.variance() << '\n';
+    // Окна закрываются редко (не чаще раза в минуту): строка сразу видна читателям
+    out.flush();
+}
 
-        if (currentHour == -1) {
-            std::ofstream("hourly_avg.log", std::ios::app);
-            std::ofstream("daily_avg.log", std::ios::app);
-            currentHour = tm.tm_hour;
-            currentDay  = tm.tm_mday;
-            currentYear = tm.tm_year;
+// Удаление сегментов вне окна хранения. Сегмент, в который попадает граница окна,
+// удаляется целиком на следующем шаге: окно скользит с шагом в один сегмент
+void applyRetention(SegmentedLog& measurements, std::vector<WindowLog>& windowLogs, const std::tm& sampleTm) {
+    auto now = Clock::now();
+    measurements.dropBefore(SegmentedLog::name(toTM(now - std::chrono::hours(24)), MEASUREMENTS_SEGMENT));
+    // текущий или предыдущий календарный год
+    std::string previousYear = std::to_string(sampleTm.tm_year + 1900 - 1);
+    for (auto& w : windowLogs) {
+        switch (w.window) {
+        case aggregate::Window::Minute:
+            w.log.dropBefore(SegmentedLog::name(toTM(now - std::chrono::hours(24 * 7)), w.segment));
+            break;
+        case aggregate::Window::Hour:
+            w.log.dropBefore(SegmentedLog::name(toTM(now - std::chrono::hours(24 * 30)), w.segment));
+            break;
+        case aggregate::Window::Day:
+            w.log.dropBefore(previousYear + "-01");
+            break;
+        case aggregate::Window::Week:
+            w.log.dropBefore(previousYear);
+            break;
         }
+    }
+}
 
-        measurements.push_back({tp, temp});
-
-        // Очистка измерений старше 24 часов
-        auto now = Clock::now();
-        while (!measurements.empty() &&
-               now - measurements.front().time > std::chrono::hours(24)) {
-            measurements.pop_front();
+int main(int argc, char* argv[]) {
+    std::vector<aggregate::Window> windows = {aggregate::Window::Hour, aggregate::Window::Day};
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--windows" && i + 1 < argc && aggregate::parseWindows(argv[i + 1], windows)) {
+            ++i;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--windows minute,hour,day,week]" << std::endl;
+            return 1;
         }
+    }
 
-        // Очистка daily_avg.log старше года
-        {
-            std::ifstream in("daily_avg.log");
-            std::ofstream out("daily_tmp.log");
-
-            std::string line;
-            while (std::getline(in, line)) {
-                std::tm t{};
-                std::istringstream ss(line);
-                ss >> std::get_time(&t, "%Y-%m-%d");
-
-                if (!ss.fail()) {
-                    // текущий или предыдущий календарный год
-                    if (t.tm_year == tm.tm_year ||
-                        t.tm_year == tm.tm_year - 1) {
-                        out << line << '\n';
-                    }
-                }
-            }
-
-            in.close();
-            out.close();
-            std::rename("daily_tmp.log", "daily_avg.log");
-        }
+    // Статистика по окнам считается на лету: O(1) состояния на окно
+    aggregate::Aggregator aggregator(windows);
+    std::vector<aggregate::Aggregator::Closed> closed;
 
-        // Очистка hourly_avg.log старше месяца
-        {
-            std::ifstream in("hourly_avg.log");
-            std::ofstream out("hourly_tmp.log");
-            std::string l;
-            while (std::getline(in, l)) {
-                std::tm t{};
-                std::istringstream s(l);
-                s >> std::get_time(&t, "%Y-%m-%d");
-                auto tp2 = Clock::from_time_t(std::mktime(&t));
-                if (now - tp2 < std::chrono::hours(24 * 30)) {
-                    out << l << "\n";
-                }
-            }
-            in.close(); out.close();
-            std::rename("hourly_tmp.log", "hourly_avg.log");
-        }
+    SegmentedLog measurementLog(MEASUREMENTS_DIR);
+    std::vector<WindowLog> windowLogs;
+    for (auto w : windows) windowLogs.push_back(makeWindowLog(w));
+    std::string currentSegment;
 
-        // При смене часа сохраняем среднее за прошлый час
-        if (tm.tm_hour != currentHour) {
-            if (!hourBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : hourBuffer) sum += m.value;
-                double avg = sum / hourBuffer.size();
+    timestamp::Parser parser;
+    std::string line;
 
-                std::ofstream f("hourly_avg.log", std::ios::app);
-                std::tm oldTm = toTM(hourBuffer.front().time);
+    // Собственный буфер cin: in_avail() показывает, есть ли уже прочитанный ввод
+    std::ios::sync_with_stdio(false);
 
-                f << std::put_time(&oldTm, "%Y-%m-%d ")
-                << currentHour << " " << avg << "\n";
-            }
+    while (std::getline(std::cin, line)) {
+        std::time_t epoch;
+        std::tm tm;
+        double temp;
 
-            hourBuffer.clear();
-            currentHour = tm.tm_hour;
-        }
-        hourBuffer.push_back({tp, temp});
-
-        // При смене дня сохраняем среднее за прошлый день
-        if (tm.tm_mday != currentDay) {
-            if (!dayBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : dayBuffer) sum += m.value;
-                double avg = sum / dayBuffer.size();
-
-                std::ofstream f("daily_avg.log", std::ios::app);
-                std::tm oldTm = toTM(dayBuffer.front().time);
-                f << std::put_time(&oldTm, "%Y-%m-%d ")
-                << avg << "\n";
-            }
+        if (!parseLine(parser, line, epoch, tm, temp)) continue;
 
-            dayBuffer.clear();
-            currentDay = tm.tm_mday;
+        // Новый сегмент измерений (раз в час): удаляем сегменты вне окна хранения
+        std::string segment = SegmentedLog::name(tm, MEASUREMENTS_SEGMENT);
+        if (segment != currentSegment) {
+            applyRetention(measurementLog, windowLogs, tm);
+            currentSegment = segment;
         }
-        dayBuffer.push_back({tp, temp});
-
-        // Перезапись measurements.log
-        {
-            std::ofstream f("measurements.log", std::ios::trunc);
-            for (auto& m : measurements) {
-                std::tm tm = toTM(m.time);
-                f << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S")
-                    << " " << m.value << "\n";
 
+        // При смене окна (минуты, часа, суток, недели) сохраняем его статистику
+        aggregator.add(tm, temp, closed);
+        for (const auto& c : closed) {
+            for (auto& w : windowLogs) {
+                if (w.window == c.window) writeWindow(w, c);
             }
         }
+        closed.clear();
+
+        // Дозапись измерения в сегмент текущего часа. Буфер сбрасывается, когда прочитанный
+        // ввод кончился (конец пачки симулятора), и при смене сегмента (закрытие файла),
+        // а не после каждой строки
+        measurementLog.at(segment)
+            << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S")
+            << " " << temp << '\n';
+        if (std::cin.rdbuf()->in_avail() <= 0) {
+            measurementLog.flush();
+        }
     }
 }
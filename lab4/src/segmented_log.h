@@ -0,0 +1,82 @@
+#pragma once
+// Сегментированный журнал только на дозапись.
+//
+// Журнал - каталог, в котором каждый сегмент - файл <имя сегмента>.log за свой
+// интервал времени (час, сутки, месяц). Имена сегментов строятся из даты так, что
+// лексикографический порядок совпадает с порядком времени (2024-01-20T14, 2024-01-20,
+// 2024-01). Строка дописывается в конец текущего сегмента через открытый поток,
+// стоимость записи не зависит от размера журнала. Очистка удаляет старые сегменты
+// целиком (unlink), не перечитывая и не переписывая оставшиеся.
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+
+class SegmentedLog {
+public:
+    explicit SegmentedLog(const std::string& dir) : dir(dir) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+    }
+
+    // Поток для дозаписи в сегмент segment; переключение сегмента закрывает предыдущий
+    std::ofstream& at(const std::string& segment) {
+        if (segment != current || !out.is_open()) {
+            out.close();
+            out.clear();
+            out.open(pathOf(segment), std::ios::app);
+            current = segment;
+        }
+        return out;
+    }
+
+    // Отдать дописанные строки текущего сегмента читателям
+    void flush() {
+        if (out.is_open()) out.flush();
+    }
+
+    // Удаляет сегменты, имена которых меньше first, возвращает их число
+    int dropBefore(const std::string& first) {
+        int removed = 0;
+        for (const auto& name : segments()) {
+            if (name >= first) break;
+            if (name == current) {
+                out.close();
+                current.clear();
+            }
+            std::error_code ec;
+            if (std::filesystem::remove(pathOf(name), ec)) removed++;
+        }
+        return removed;
+    }
+
+    // Имена сегментов по возрастанию времени
+    std::vector<std::string> segments() const {
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            const auto& path = entry.path();
+            if (path.extension() == ".log") names.push_back(path.stem().string());
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::string pathOf(const std::string& segment) const {
+        return dir + "/" + segment + ".log";
+    }
+
+    // Имя сегмента для момента, заданного полями tm, по формату strftime
+    static std::string name(const std::tm& tm, const char* format) {
+        char buf[32];
+        size_t len = std::strftime(buf, sizeof(buf), format, &tm);
+        return std::string(buf, len);
+    }
+
+private:
+    std::string dir;
+    std::string current;
+    std::ofstream out;
+};
@@ -0,0 +1,239 @@
+#!/bin/bash
+# Бенчмарки lab5
+#
+# Использование:
+#   ./bench.sh server [CONNECTIONS] [DURATION_SEC] [PATH]
+#       HTTP сервер: модель "поток на соединение" против epoll,
+#       соединение на запрос против keep-alive / pipelining
+#   ./bench.sh ingest [SAMPLES] [BATCH_SIZES] [WORKERS] [SENSORS]
+#       логгер: пропускная способность записи при разных размерах пакета и числе обработчиков
+#   ./bench.sh partition [ROWS]
+#       схема хранения: одна таблица против секций по суткам
+#   ./bench.sh json [ROWS]
+#       сериализация ответа /api/stats: ostringstream против json::Writer
+#   ./bench.sh hot [CONNECTIONS] [DURATION_SEC]
+#       /api/current и /api/stats за 10 минут: SQLite против буфера последних измерений
+#   ./bench.sh ring [SAMPLES] [READERS]
+#       передача измерений: текст через pipe против кольцевого буфера в разделяемой памяти
+#   ./bench.sh time [LINES] [THREADS]
+#       разбор строк симулятора: std::get_time + mktime против timestamp::Parser
+#   ./bench.sh archive [SAMPLES]
+#       архив измерений: степень сжатия и скорость чтения против текста и SQLite
+#   ./bench.sh pipeline [RATE] [DURATION_SEC] [OUTPUT] [PATTERN]
+#       simulator | logger и server вместе: запись, свежесть /api/current, задержки запросов, RSS, размер БД (JSON)
+
+cd "$(dirname "$0")"
+ROOT=$(pwd)
+
+COMPILER=${CXX:-clang++}
+PORT=${BENCH_PORT:-18080}
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+if [ ! -f "src/server" ] || [ ! -f "src/logger" ]; then
+    echo -e "${RED}Сначала скомпилируйте программы: ./build.sh${NC}"
+    exit 1
+fi
+
+# build_tool ИМЯ: компиляция bench/ИМЯ.cpp в bench/ИМЯ
+build_tool() {
+    echo -e "${YELLOW}Компиляция $1${NC}"
+    if ! $COMPILER -std=c++17 -O2 -pthread -Isrc -o bench/$1 bench/$1.cpp -lsqlite3; then
+        echo -e "${RED}Ошибка компиляции $1${NC}"
+        exit 1
+    fi
+}
+
+bench_server() {
+    local connections=${1:-64}
+    local duration=${2:-10}
+    local request_path=${3:-/api/current}
+
+    build_tool load_gen
+
+    # Временный каталог с БД и статикой, чтобы не трогать рабочую measurements.db
+    WORKDIR=$(mktemp -d)
+    trap 'rm -rf "$WORKDIR"' EXIT
+    cp src/index.html src/style.css src/script.js "$WORKDIR"
+    (cd "$WORKDIR" && echo "$(date +%Y-%m-%dT%H:%M:%S) 22.50" | "$ROOT/src/logger" 2>/dev/null)
+
+    # run_case ЗАГОЛОВОК "ФЛАГИ_СЕРВЕРА" [ФЛАГИ_LOAD_GEN...]
+    run_case() {
+        local title=$1
+        local server_flags=$2
+        shift 2
+
+        (cd "$WORKDIR" && exec "$ROOT/src/server" --port $PORT $server_flags > /dev/null) &
+        local pid=$!
+        sleep 1
+
+        echo ""
+        echo -e "${GREEN}${title}${NC}"
+        bench/load_gen --port $PORT --path "$request_path" \
+            --connections $connections --duration $duration "$@"
+        grep -E "VmHWM|Threads" /proc/$pid/status 2>/dev/null | tr -s '\t ' ' '
+
+        kill $pid 2>/dev/null
+        wait $pid 2>/dev/null
+    }
+
+    echo "connections=$connections duration=${duration}s path=$request_path"
+    run_case "Поток на соединение (--threaded), соединение на запрос" "--threaded"
+    run_case "Поток на соединение (--threaded), keep-alive" "--threaded" --keepalive
+    run_case "epoll, соединение на запрос" ""
+    run_case "epoll, keep-alive" "" --keepalive
+    run_case "epoll, keep-alive + pipelining (8)" "" --pipeline 8
+}
+
+bench_ingest() {
+    local samples=${1:-20000}
+    local batch_sizes=${2:-1,10,100,1000}
+    local workers=${3:-1}
+    local sensors=${4:-1}
+
+    build_tool ingest_bench
+    echo ""
+    bench/ingest_bench --logger src/logger --samples $samples --batch-sizes $batch_sizes \
+        --workers $workers --sensors $sensors
+}
+
+bench_partition() {
+    local rows=${1:-3000000}
+
+    build_tool partition_bench
+    echo ""
+    bench/partition_bench --rows $rows
+}
+
+bench_json() {
+    local rows=${1:-100000}
+
+    build_tool json_bench
+    echo ""
+    bench/json_bench --rows $rows
+}
+
+bench_ring() {
+    local samples=${1:-2000000}
+    local readers=${2:-4}
+
+    build_tool ring_bench
+    echo ""
+    bench/ring_bench --samples $samples --readers $readers
+}
+
+bench_time() {
+    local lines=${1:-10000000}
+    local threads=${2:-4}
+
+    build_tool time_bench
+    echo ""
+    bench/time_bench --lines $lines --threads $threads
+}
+
+bench_archive() {
+    local samples=${1:-3000000}
+
+    build_tool archive_bench
+    echo ""
+    bench/archive_bench --samples $samples
+}
+
+bench_pipeline() {
+    local rate=${1:-2000}
+    local duration=${2:-10}
+    local output=${3:-}
+    local pattern=${4:-steady}
+
+    if [ ! -f "src/simulator" ]; then
+        echo -e "${RED}Сначала скомпилируйте программы: ./build.sh${NC}"
+        exit 1
+    fi
+    build_tool pipeline_bench
+    echo ""
+    bench/pipeline_bench --simulator src/simulator --logger src/logger --server src/server --port $PORT \
+        --rate $rate --duration $duration --pattern $pattern ${output:+--output "$output"}
+}
+
+bench_hot() {
+    local connections=${1:-16}
+    local duration=${2:-5}
+
+    build_tool load_gen
+
+    # Временная БД с измерениями за последний час, по одному в секунду
+    WORKDIR=$(mktemp -d)
+    trap 'rm -rf "$WORKDIR"' EXIT
+    local now=$(date +%s)
+    for ((t = now - 3600; t <= now; t++)); do
+        echo "$(date -d @$t +%Y-%m-%dT%H:%M:%S) $((20 + t % 5)).$((t % 100))"
+    done | (cd "$WORKDIR" && "$ROOT/src/logger" --batch-size 1000 > /dev/null 2>&1)
+    local stats_path="/api/stats?start=$(date -d @$((now - 600)) +%Y-%m-%dT%H:%M:%S)"
+
+    # run_hot ЗАГОЛОВОК "ФЛАГИ_СЕРВЕРА"
+    run_hot() {
+        (cd "$WORKDIR" && exec "$ROOT/src/server" --port $PORT $2 > /dev/null 2>&1) &
+        local pid=$!
+        sleep 1
+
+        for path in /api/current "$stats_path"; do
+            echo ""
+            echo -e "${GREEN}$1: $path${NC}"
+            bench/load_gen --port $PORT --path "$path" \
+                --connections $connections --duration $duration --keepalive
+        done
+
+        kill $pid 2>/dev/null
+        wait $pid 2>/dev/null
+    }
+
+    run_hot "SQLite (--hot-samples 0)" "--hot-samples 0"
+    run_hot "Буфер последних измерений" ""
+}
+
+case "$1" in
+    server)
+        shift
+        bench_server "$@"
+        ;;
+    ingest)
+        shift
+        bench_ingest "$@"
+        ;;
+    partition)
+        shift
+        bench_partition "$@"
+        ;;
+    json)
+        shift
+        bench_json "$@"
+        ;;
+    hot)
+        shift
+        bench_hot "$@"
+        ;;
+    ring)
+        shift
+        bench_ring "$@"
+        ;;
+    time)
+        shift
+        bench_time "$@"
+        ;;
+    archive)
+        shift
+        bench_archive "$@"
+        ;;
+    pipeline)
+        shift
+        bench_pipeline "$@"
+        ;;
+    *)
+        sed -n '2,23p' "$0" | sed 's/^# \{0,1\}//'
+        exit 1
+        ;;
+esac
+exit 0
@@ -0,0 +1,289 @@
+// Бенчмарк архива измерений (archive.h): степень сжатия и скорость чтения.
+// Ряды из SAMPLES измерений (по умолчанию 3 млн, одно в 5 с - около полугода):
+//  - noise:  вывод симулятора, нормальный шум 22 +- 2 с точностью 0.01 (худший случай
+//            для XOR значений - соседние значения независимы);
+//  - smooth: суточный ход температуры с небольшим шумом, точность 0.01;
+//  - steps:  датчик с шагом 0.1, значение меняется редко.
+// В каждом ряду 2% интервалов на секунду длиннее (сдвиг сна симулятора).
+// Размер архива сравнивается с двоичной записью {int64, double}, строками measurements.log
+// и секцией SQLite (storage.h); скорость - полная распаковка, запросы за период
+// (архив через индекс блоков против секции SQLite) и суточные агрегаты (заголовки
+// блоков против распаковки). Файлы читаются из кэша страниц.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage.h"
+#include "archive.h"
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+struct Series {
+    std::vector<std::time_t> times;
+    std::vector<double> values;
+};
+
+Series generate(const std::string& kind, long samples, std::time_t start) {
+    std::mt19937_64 gen(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    Series s;
+    s.times.reserve(samples);
+    s.values.reserve(samples);
+    std::time_t t = start;
+    double level = 22.0;
+    for (long i = 0; i < samples; ++i) {
+        t += uniform(gen) < 0.02 ? 6 : 5;
+        double v;
+        if (kind == "noise") {
+            v = std::round((22.0 + 2.0 * noise(gen)) * 100.0) / 100.0;
+        } else if (kind == "smooth") {
+            double day = std::sin(2 * M_PI * (t % 86400) / 86400.0);
+            v = std::round((22.0 + 3.0 * day + 0.05 * noise(gen)) * 100.0) / 100.0;
+        } else {
+            if (uniform(gen) < 0.05) level += uniform(gen) < 0.5 ? -0.1 : 0.1;
+            v = std::round(level * 10.0) / 10.0;
+        }
+        s.times.push_back(t);
+        s.values.push_back(v);
+    }
+    return s;
+}
+
+// Длина строк measurements.log: "YYYY-MM-DDTHH:MM:SS 22.45\n"
+long textSize(const Series& s) {
+    long bytes = 0;
+    char buf[32];
+    for (double v : s.values) {
+        bytes += 19 + 1 + std::snprintf(buf, sizeof(buf), "%.2f", v) + 1;
+    }
+    return bytes;
+}
+
+void fillSqlite(sqlite3* db, const Series& s) {
+    storage::exec(db, "CREATE TABLE m" + std::string(storage::PARTITION_COLUMNS));
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO m (sensor, epoch, temperature) VALUES (0, ?, ?)", -1, &stmt, nullptr);
+    storage::exec(db, "BEGIN");
+    for (size_t i = 0; i < s.times.size(); ++i) {
+        sqlite3_bind_int64(stmt, 1, s.times[i]);
+        sqlite3_bind_double(stmt, 2, s.values[i]);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    storage::exec(db, "COMMIT");
+    sqlite3_finalize(stmt);
+    storage::exec(db, "PRAGMA wal_checkpoint(TRUNCATE)");
+}
+
+long querySqlite(sqlite3* db, std::time_t from, std::time_t to, double& sum) {
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "SELECT epoch, temperature FROM m WHERE sensor = 0 AND epoch >= ? AND epoch <= ? "
+                           "ORDER BY epoch", -1, &stmt, nullptr);
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    long rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        sum += sqlite3_column_double(stmt, 1);
+        rows++;
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+long queryArchive(const archive::Reader& reader, std::time_t from, std::time_t to, double& sum) {
+    long rows = 0;
+    reader.scan(from, to, [&](std::time_t, double v) {
+        sum += v;
+        rows++;
+    });
+    return rows;
+}
+
+// Суточные суммы: блок внутри суток учитывается по заголовку (useIndex) или распаковывается
+double dailySums(const archive::Reader& reader, bool useIndex, long& days) {
+    std::time_t times[archive::BLOCK_SAMPLES];
+    double values[archive::BLOCK_SAMPLES];
+    double total = 0;
+    std::time_t currentDay = -1;
+    days = 0;
+    for (const auto& block : reader.blocks()) {
+        std::time_t day = block.firstTime / 86400;
+        if (useIndex && day == block.lastTime / 86400) {
+            if (day != currentDay) {
+                currentDay = day;
+                days++;
+            }
+            total += block.sum;
+            continue;
+        }
+        archive::decodeBlock(block, times, values);
+        for (uint32_t i = 0; i < block.count; ++i) {
+            if (times[i] / 86400 != currentDay) {
+                currentDay = times[i] / 86400;
+                days++;
+            }
+            total += values[i];
+        }
+    }
+    return total;
+}
+
+// Среднее время вызова в миллисекундах
+double timeMs(const std::function<void()>& f, int repeats) {
+    auto start = Clock::now();
+    for (int i = 0; i < repeats; ++i) f();
+    return secondsSince(start) * 1000.0 / repeats;
+}
+
+int main(int argc, char* argv[]) {
+    long samples = 3000000;
+    int repeats = 20;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--samples" && i + 1 < argc) samples = std::max(2L, std::atol(argv[++i]));
+        else if (arg == "--repeats" && i + 1 < argc) repeats = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--samples N] [--repeats N]" << std::endl;
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/archive_benchXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    std::time_t start = std::time(nullptr) - samples * 5;
+    std::cout << "samples=" << samples << " block=" << archive::BLOCK_SAMPLES << std::endl;
+
+    bool failed = false;
+    for (const char* kind : {"noise", "smooth", "steps"}) {
+        Series s = generate(kind, samples, start);
+        std::string archivePath = std::string(dir) + "/" + kind + archive::EXTENSION;
+        std::string dbPath = std::string(dir) + "/" + kind + ".db";
+
+        auto t0 = Clock::now();
+        {
+            archive::Writer writer;
+            writer.open(archivePath);
+            for (long i = 0; i < samples; ++i) writer.append(s.times[i], s.values[i]);
+            writer.sync();
+        }
+        double writeSec = secondsSince(t0);
+
+        sqlite3* db;
+        sqlite3_open(dbPath.c_str(), &db);
+        storage::exec(db, "PRAGMA journal_mode=WAL");
+        storage::exec(db, "PRAGMA synchronous=NORMAL");
+        fillSqlite(db, s);
+
+        archive::Reader reader;
+        if (!reader.open(archivePath)) {
+            std::cerr << "cannot open " << archivePath << std::endl;
+            return 1;
+        }
+
+        long archiveBytes = fileSize(archivePath);
+        long rawBytes = samples * 16;
+        long text = textSize(s);
+        long sqliteBytes = fileSize(dbPath);
+        std::printf("\n%s\n", kind);
+        std::printf("  size: archive %ld B (%.2f B/sample), raw %ld B, text %ld B, sqlite %ld B\n",
+                    archiveBytes, static_cast<double>(archiveBytes) / samples, rawBytes, text, sqliteBytes);
+        std::printf("  ratio: %.1fx raw, %.1fx text, %.1fx sqlite; encode %.1f M samples/s\n",
+                    static_cast<double>(rawBytes) / archiveBytes, static_cast<double>(text) / archiveBytes,
+                    static_cast<double>(sqliteBytes) / archiveBytes, samples / writeSec / 1e6);
+
+        // Полная распаковка со сверкой с исходным рядом
+        long mismatches = 0;
+        double decodeMs = timeMs([&] {
+            long i = 0;
+            reader.scan(s.times.front(), s.times.back(), [&](std::time_t t, double v) {
+                if (i >= samples || t != s.times[i] || v != s.values[i]) mismatches++;
+                i++;
+            });
+            if (i != samples) mismatches++;
+        }, std::max(1, repeats / 4));
+        double sqliteScanMs = timeMs([&] {
+            double sum = 0;
+            querySqlite(db, s.times.front(), s.times.back(), sum);
+        }, std::max(1, repeats / 4));
+        std::printf("  full scan: archive %8.2f ms (%.0f M samples/s, %.0f MB/s compressed), sqlite %8.2f ms\n",
+                    decodeMs, samples / decodeMs / 1e3, archiveBytes / decodeMs / 1e3, sqliteScanMs);
+        if (mismatches) {
+            std::cerr << "  decoded series differs from the original (" << mismatches << ")" << std::endl;
+            failed = true;
+        }
+
+        // Запросы за период в случайных местах ряда
+        struct Range { const char* name; long seconds; };
+        const Range ranges[] = {{"1h", 3600}, {"24h", 86400}, {"7d", 7 * 86400}};
+        for (const auto& r : ranges) {
+            std::mt19937 pick(7);
+            std::time_t span = s.times.back() - s.times.front() - r.seconds;
+            if (span <= 0) continue;
+            std::vector<std::time_t> froms;
+            for (int i = 0; i < repeats; ++i) froms.push_back(s.times.front() + pick() % span);
+
+            long archiveRows = 0, sqliteRows = 0;
+            double archiveSum = 0, sqliteSum = 0;
+            size_t next = 0;
+            double archiveMs = timeMs([&] {
+                std::time_t from = froms[next++ % froms.size()];
+                archiveRows += queryArchive(reader, from, from + r.seconds, archiveSum);
+            }, repeats);
+            next = 0;
+            double sqliteMs = timeMs([&] {
+                std::time_t from = froms[next++ % froms.size()];
+                sqliteRows += querySqlite(db, from, from + r.seconds, sqliteSum);
+            }, repeats);
+            std::printf("  range %-4s rows=%-7ld archive=%8.3f ms  sqlite=%8.3f ms\n",
+                        r.name, archiveRows / repeats, archiveMs, sqliteMs);
+            if (archiveRows != sqliteRows || std::fabs(archiveSum - sqliteSum) > 1e-6 * std::fabs(sqliteSum)) {
+                std::cerr << "  range result mismatch" << std::endl;
+                failed = true;
+            }
+        }
+
+        // Суточные агрегаты всего ряда
+        long daysIndex = 0, daysDecode = 0;
+        double sumIndex = 0, sumDecode = 0;
+        double indexMs = timeMs([&] { sumIndex = dailySums(reader, true, daysIndex); }, repeats);
+        double fullMs = timeMs([&] { sumDecode = dailySums(reader, false, daysDecode); }, std::max(1, repeats / 4));
+        std::printf("  daily sums (%ld days): block index %8.3f ms, decode %8.2f ms\n", daysIndex, indexMs, fullMs);
+        if (daysIndex != daysDecode || std::fabs(sumIndex - sumDecode) > 1e-6 * std::fabs(sumDecode)) {
+            std::cerr << "  daily sums mismatch" << std::endl;
+            failed = true;
+        }
+
+        sqlite3_close(db);
+        std::remove(archivePath.c_str());
+        std::remove(dbPath.c_str());
+        std::remove((dbPath + "-wal").c_str());
+        std::remove((dbPath + "-shm").c_str());
+    }
+    rmdir(dir);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+// Бенчмарк записи измерений логгером lab5.
+// Для каждого числа обработчиков и размера пакета запускает логгер на пустой временной БД,
+// подает ему на stdin N измерений (по кругу от SENSORS датчиков) и печатает
+// пропускную способность (samples/s).
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+std::string isoTime(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+std::vector<long> parseList(const std::string& s) {
+    std::vector<long> values;
+    std::istringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        values.push_back(std::atol(item.c_str()));
+    }
+    return values;
+}
+
+// Готовые строки: каждую секунду по измерению от каждого датчика, заканчивая текущим моментом
+std::vector<std::string> generateSamples(long count, long sensors) {
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    std::time_t start = std::time(nullptr) - count / sensors;
+    char value[32];
+    for (long i = 0; i < count; ++i) {
+        std::snprintf(value, sizeof(value), "%.2f %ld", 22.0 + (i % 200) / 50.0 - 2.0, i % sensors);
+        lines.push_back(isoTime(start + i / sensors) + " " + value + "\n");
+    }
+    return lines;
+}
+
+double runLogger(const std::string& logger, const std::string& extraArgs,
+                 const std::vector<std::string>& lines) {
+    char dir[] = "/tmp/ingest_benchXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 0;
+    }
+    std::string db = std::string(dir) + "/measurements.db";
+    std::string cmd = logger + " --db " + db + " " + extraArgs + " 2>/dev/null";
+
+    auto start = Clock::now();
+    FILE* pipe = popen(cmd.c_str(), "w");
+    if (!pipe) {
+        std::perror("popen");
+        return 0;
+    }
+    for (const auto& line : lines) {
+        std::fwrite(line.data(), 1, line.size(), pipe);
+    }
+    // pclose ждет, пока логгер обработает ввод и завершится
+    pclose(pipe);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::string cleanup = std::string("rm -rf ") + dir;
+    std::system(cleanup.c_str());
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    std::string logger = "src/logger";
+    long samples = 20000;
+    std::vector<long> batchSizes = {1, 10, 100, 1000};
+    std::vector<long> workers = {1};
+    long sensors = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--logger" && i + 1 < argc) logger = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc) samples = std::atol(argv[++i]);
+        else if (arg == "--batch-sizes" && i + 1 < argc) batchSizes = parseList(argv[++i]);
+        else if (arg == "--workers" && i + 1 < argc) workers = parseList(argv[++i]);
+        else if (arg == "--sensors" && i + 1 < argc) sensors = std::max(1L, std::atol(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--logger PATH] [--samples N] [--batch-sizes 1,10,100]"
+                         " [--workers 1,2,4] [--sensors N]" << std::endl;
+            return 1;
+        }
+    }
+
+    auto lines = generateSamples(samples, sensors);
+    std::cout << "samples=" << samples << " sensors=" << sensors << std::endl;
+
+    for (long w : workers) {
+        for (long batch : batchSizes) {
+            double elapsed = runLogger(logger, "--workers " + std::to_string(w) +
+                                       " --batch-size " + std::to_string(batch), lines);
+            std::cout << "workers=" << w
+                      << " batch_size=" << batch
+                      << " elapsed_s=" << elapsed
+                      << " samples/s=" << static_cast<long>(samples / elapsed)
+                      << std::endl;
+        }
+    }
+    return 0;
+}
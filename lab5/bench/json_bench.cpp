@@ -0,0 +1,123 @@
+// Микробенчмарк сериализации ответа /api/stats: std::ostringstream с
+// std::fixed << std::setprecision(2) (прежний код сервера) против json::Writer.
+// Оба варианта формируют одинаковый JSON (проверяется) для ROWS измерений
+// с интервалом в 1 с и считают сводку count/average/min/max.
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "json_writer.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Measurement {
+    std::time_t epoch;
+    double temperature;
+};
+
+// Прежняя реализация: ostringstream и formatTime на каждую строку
+std::string serializeStream(const std::vector<Measurement>& stats) {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(2);
+    json << "{\"data\":[";
+
+    for (size_t i = 0; i < stats.size(); ++i) {
+        if (i > 0) json << ",";
+        json << "{"
+             << "\"timestamp\":\"" << storage::formatTime(stats[i].epoch) << "\","
+             << "\"temperature\":" << stats[i].temperature
+             << "}";
+    }
+
+    if (!stats.empty()) {
+        double sum = 0, minT = stats[0].temperature, maxT = stats[0].temperature;
+        for (const auto& m : stats) {
+            sum += m.temperature;
+            minT = std::min(minT, m.temperature);
+            maxT = std::max(maxT, m.temperature);
+        }
+        json << "],\"summary\":{"
+             << "\"count\":" << stats.size() << ","
+             << "\"average\":" << sum / stats.size() << ","
+             << "\"min\":" << minT << ","
+             << "\"max\":" << maxT
+             << "}}";
+    } else {
+        json << "],\"summary\":{\"count\":0}}";
+    }
+    return json.str();
+}
+
+// json::Writer в переиспользуемый буфер, сводка в том же проходе
+void serializeWriter(const std::vector<Measurement>& stats, std::string& out) {
+    out.clear();
+    json::Writer w(out);
+    json::Summary summary;
+    w.raw("{\"data\":[");
+    for (const auto& m : stats) {
+        if (summary.count > 0) w.raw(',');
+        json::writeMeasurement(w, m.epoch, m.temperature);
+        summary.add(m.temperature);
+    }
+    w.raw("],");
+    summary.write(w);
+    w.raw('}');
+}
+
+int main(int argc, char* argv[]) {
+    long rows = 100000;
+    int repeats = 20;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rows" && i + 1 < argc) rows = std::atol(argv[++i]);
+        else if (arg == "--repeats" && i + 1 < argc) repeats = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--rows N] [--repeats N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Measurement> stats;
+    stats.reserve(rows);
+    std::time_t start = std::time(nullptr) - rows;
+    std::srand(42);
+    for (long i = 0; i < rows; ++i) {
+        stats.push_back({start + i, 18.0 + (std::rand() % 1000) / 100.0});
+    }
+
+    std::string expected = serializeStream(stats);
+    std::string buffer;
+    serializeWriter(stats, buffer);
+    if (buffer != expected) {
+        std::cerr << "output mismatch" << std::endl;
+        return 1;
+    }
+
+    size_t sink = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        sink += serializeStream(stats).size();
+    }
+    double streamMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / repeats;
+
+    t0 = Clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        serializeWriter(stats, buffer);
+        sink += buffer.size();
+    }
+    double writerMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / repeats;
+
+    double mb = expected.size() / (1024.0 * 1024.0);
+    std::printf("rows=%ld bytes=%zu repeats=%d\n", rows, expected.size(), repeats);
+    std::printf("ostringstream: %8.2f ms  %7.1f MB/s\n", streamMs, mb / (streamMs / 1000.0));
+    std::printf("json::Writer:  %8.2f ms  %7.1f MB/s  (x%.1f)\n",
+                writerMs, mb / (writerMs / 1000.0), streamMs / writerMs);
+    return sink > 0 ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+// Генератор нагрузки для HTTP сервера lab5.
+// Открывает N параллельных клиентов, каждый в цикле отправляет GET запрос,
+// и по окончании печатает пропускную способность (req/s) и перцентили задержки.
+// По умолчанию каждый запрос идет в новом соединении (Connection: close);
+// --keepalive переиспользует соединение, --pipeline D отправляет D запросов подряд.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string path = "/api/current";
+    int connections = 64;
+    int duration = 10;
+    bool keepAlive = false;
+    int pipeline = 1;
+};
+
+struct WorkerResult {
+    std::vector<double> latenciesUs;
+    long errors = 0;
+};
+
+int connectTo(const Options& opt) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Один запрос на соединение: читаем ответ до закрытия сокета сервером
+bool requestOnce(const Options& opt, const std::string& request) {
+    int fd = connectTo(opt);
+    if (fd < 0) return false;
+
+    bool ok = sendAll(fd, request);
+    char buffer[16384];
+    size_t total = 0;
+    while (ok) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0) ok = false;
+        if (n <= 0) break;
+        total += n;
+    }
+    close(fd);
+    return ok && total > 0;
+}
+
+// Длина тела в кодировке chunked, начинающегося с позиции pos, 0 если тело неполное
+size_t chunkedLength(const std::string& buffer, size_t pos) {
+    size_t start = pos;
+    while (true) {
+        size_t lineEnd = buffer.find("\r\n", pos);
+        if (lineEnd == std::string::npos) return 0;
+        size_t size = std::strtoul(buffer.c_str() + pos, nullptr, 16);
+        pos = lineEnd + 2 + size + 2;
+        if (buffer.size() < pos) return 0;
+        if (size == 0) return pos - start;
+    }
+}
+
+// Длина полного ответа в буфере (заголовки + Content-Length или chunked тело),
+// 0 если ответ неполный
+size_t responseLength(const std::string& buffer) {
+    size_t headersEnd = buffer.find("\r\n\r\n");
+    if (headersEnd == std::string::npos) return 0;
+
+    size_t bodyLength = 0;
+    size_t pos = 0;
+    while ((pos = buffer.find("\r\n", pos)) != std::string::npos && pos < headersEnd) {
+        pos += 2;
+        if (strncasecmp(buffer.c_str() + pos, "Content-Length:", 15) == 0) {
+            bodyLength = std::strtoul(buffer.c_str() + pos + 15, nullptr, 10);
+            break;
+        }
+        if (strncasecmp(buffer.c_str() + pos, "Transfer-Encoding: chunked", 26) == 0) {
+            bodyLength = chunkedLength(buffer, headersEnd + 4);
+            if (bodyLength == 0) return 0;
+            break;
+        }
+    }
+
+    size_t total = headersEnd + 4 + bodyLength;
+    return buffer.size() >= total ? total : 0;
+}
+
+// Постоянное соединение: пачками по opt.pipeline запросов, ответы разбираются по Content-Length
+void keepAliveWorker(const Options& opt, Clock::time_point deadline, WorkerResult& result) {
+    std::string request = "GET " + opt.path + " HTTP/1.1\r\n"
+                          "Host: " + opt.host + "\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < opt.pipeline; ++i) batch += request;
+
+    int fd = -1;
+    std::string buffer;
+    char chunk[16384];
+
+    while (Clock::now() < deadline) {
+        if (fd < 0) {
+            fd = connectTo(opt);
+            buffer.clear();
+            if (fd < 0) {
+                result.errors++;
+                continue;
+            }
+        }
+
+        auto start = Clock::now();
+        bool ok = sendAll(fd, batch);
+        int received = 0;
+        while (ok && received < opt.pipeline) {
+            size_t length = responseLength(buffer);
+            if (length > 0) {
+                buffer.erase(0, length);
+                received++;
+                result.latenciesUs.push_back(
+                    std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                continue;
+            }
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) ok = false;
+            else buffer.append(chunk, n);
+        }
+
+        if (!ok) {
+            result.errors += opt.pipeline - received;
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0) close(fd);
+}
+
+void worker(const Options& opt, Clock::time_point deadline, WorkerResult& result) {
+    if (opt.keepAlive) {
+        keepAliveWorker(opt, deadline, result);
+        return;
+    }
+
+    std::string request = "GET " + opt.path + " HTTP/1.1\r\n"
+                          "Host: " + opt.host + "\r\n"
+                          "Connection: close\r\n\r\n";
+
+    while (Clock::now() < deadline) {
+        auto start = Clock::now();
+        bool ok = requestOnce(opt, request);
+        auto end = Clock::now();
+
+        if (ok) {
+            result.latenciesUs.push_back(
+                std::chrono::duration<double, std::micro>(end - start).count());
+        } else {
+            result.errors++;
+        }
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) opt.host = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) opt.port = std::atoi(argv[++i]);
+        else if (arg == "--path" && i + 1 < argc) opt.path = argv[++i];
+        else if (arg == "--connections" && i + 1 < argc) opt.connections = std::atoi(argv[++i]);
+        else if (arg == "--duration" && i + 1 < argc) opt.duration = std::atoi(argv[++i]);
+        else if (arg == "--keepalive") opt.keepAlive = true;
+        else if (arg == "--pipeline" && i + 1 < argc) {
+            opt.pipeline = std::max(1, std::atoi(argv[++i]));
+            opt.keepAlive = true;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--host H] [--port N] [--path P] [--connections N] [--duration SEC]"
+                         " [--keepalive] [--pipeline DEPTH]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    auto deadline = Clock::now() + std::chrono::seconds(opt.duration);
+    std::vector<WorkerResult> results(opt.connections);
+    std::vector<std::thread> threads;
+
+    auto start = Clock::now();
+    for (int i = 0; i < opt.connections; ++i) {
+        threads.emplace_back(worker, std::cref(opt), deadline, std::ref(results[i]));
+    }
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    long errors = 0;
+    for (auto& r : results) {
+        all.insert(all.end(), r.latenciesUs.begin(), r.latenciesUs.end());
+        errors += r.errors;
+    }
+    std::sort(all.begin(), all.end());
+
+    std::cout << "requests=" << all.size()
+              << " errors=" << errors
+              << " req/s=" << static_cast<long>(all.size() / elapsed)
+              << " p50_us=" << static_cast<long>(percentile(all, 0.50))
+              << " p99_us=" << static_cast<long>(percentile(all, 0.99))
+              << " max_us=" << static_cast<long>(all.empty() ? 0 : all.back())
+              << std::endl;
+
+    return all.empty() ? 1 : 0;
+}
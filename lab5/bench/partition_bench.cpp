@@ -0,0 +1,221 @@
+// Бенчмарк схемы хранения: одна таблица с TEXT timestamp (старая схема)
+// против секций по суткам с ключом epoch (storage.h).
+// Заполняет обе БД одинаковыми данными (по умолчанию 3 млн измерений, одно в секунду),
+// затем измеряет запросы за период и очистку старых данных.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage.h"
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+sqlite3* openDb(const std::string& path) {
+    sqlite3* db;
+    sqlite3_open(path.c_str(), &db);
+    storage::exec(db, "PRAGMA journal_mode=WAL");
+    storage::exec(db, "PRAGMA synchronous=NORMAL");
+    return db;
+}
+
+double sampleValue(long i) {
+    return 22.0 + (i % 400) / 100.0 - 2.0;
+}
+
+void fillLegacy(sqlite3* db, std::time_t start, long rows) {
+    storage::exec(db, R"(
+        CREATE TABLE measurements (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            timestamp TEXT UNIQUE,
+            temperature REAL,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )");
+
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, "INSERT INTO measurements (timestamp, temperature) VALUES (?, ?)",
+                       -1, &stmt, nullptr);
+    storage::exec(db, "BEGIN");
+    for (long i = 0; i < rows; ++i) {
+        std::string ts = storage::formatTime(start + i);
+        sqlite3_bind_text(stmt, 1, ts.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(stmt, 2, sampleValue(i));
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    storage::exec(db, "COMMIT");
+    sqlite3_finalize(stmt);
+}
+
+void fillPartitioned(sqlite3* db, std::time_t start, long rows) {
+    storage::initSchema(db);
+
+    storage::exec(db, "BEGIN");
+    storage::Partition current{"", 0, 0};
+    sqlite3_stmt* stmt = nullptr;
+    for (long i = 0; i < rows; ++i) {
+        std::time_t t = start + i;
+        if (!stmt || t >= current.end) {
+            if (stmt) sqlite3_finalize(stmt);
+            storage::ensurePartition(db, t, current);
+            std::string sql = "INSERT INTO " + current.name + " (epoch, temperature) VALUES (?, ?)";
+            sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        }
+        sqlite3_bind_int64(stmt, 1, t);
+        sqlite3_bind_double(stmt, 2, sampleValue(i));
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    storage::exec(db, "COMMIT");
+    sqlite3_finalize(stmt);
+}
+
+long queryLegacy(sqlite3* db, std::time_t from, std::time_t to) {
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(db, R"(
+        SELECT timestamp, temperature FROM measurements
+        WHERE timestamp >= ? AND timestamp <= ?
+        ORDER BY timestamp ASC
+    )", -1, &stmt, nullptr);
+    std::string a = storage::formatTime(from), b = storage::formatTime(to);
+    sqlite3_bind_text(stmt, 1, a.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, b.c_str(), -1, SQLITE_STATIC);
+
+    long rows = 0;
+    double sum = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        sum += sqlite3_column_double(stmt, 1);
+        rows++;
+    }
+    sqlite3_finalize(stmt);
+    return sum > 0 ? rows : 0;
+}
+
+long queryPartitioned(sqlite3* db, std::time_t from, std::time_t to) {
+    sqlite3_stmt* partitions;
+    sqlite3_prepare_v2(db, storage::PARTITIONS_IN_RANGE_SQL, -1, &partitions, nullptr);
+
+    long rows = 0;
+    double sum = 0;
+    for (const auto& p : storage::partitionsInRange(partitions, from, to)) {
+        sqlite3_stmt* stmt;
+        std::string sql = "SELECT epoch, temperature FROM " + p.name +
+                          " WHERE sensor = ? AND epoch >= ? AND epoch <= ? ORDER BY epoch";
+        sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_bind_int(stmt, 1, storage::DEFAULT_SENSOR);
+        sqlite3_bind_int64(stmt, 2, from);
+        sqlite3_bind_int64(stmt, 3, to);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            sum += sqlite3_column_double(stmt, 1);
+            rows++;
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_finalize(partitions);
+    return sum > 0 ? rows : 0;
+}
+
+// Среднее время запроса в миллисекундах
+double timeQuery(const std::function<long()>& query, int repeats, long& rows) {
+    auto start = Clock::now();
+    for (int i = 0; i < repeats; ++i) rows = query();
+    return secondsSince(start) * 1000.0 / repeats;
+}
+
+int main(int argc, char* argv[]) {
+    long rows = 3000000;
+    int repeats = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--rows" && i + 1 < argc) rows = std::atol(argv[++i]);
+        else if (arg == "--repeats" && i + 1 < argc) repeats = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--rows N] [--repeats N]" << std::endl;
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/partition_benchXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string legacyPath = std::string(dir) + "/legacy.db";
+    std::string partitionedPath = std::string(dir) + "/partitioned.db";
+
+    std::time_t end = std::time(nullptr);
+    std::time_t start = end - rows;
+    std::cout << "rows=" << rows << " days=" << rows / 86400.0 << std::endl;
+
+    sqlite3* legacy = openDb(legacyPath);
+    sqlite3* partitioned = openDb(partitionedPath);
+
+    auto t0 = Clock::now();
+    fillLegacy(legacy, start, rows);
+    std::cout << "fill legacy:      " << secondsSince(t0) << " s" << std::endl;
+    t0 = Clock::now();
+    fillPartitioned(partitioned, start, rows);
+    std::cout << "fill partitioned: " << secondsSince(t0) << " s" << std::endl;
+
+    struct Range { const char* name; long seconds; };
+    const Range ranges[] = {{"1h", 3600}, {"24h", 86400}, {"7d", 7 * 86400}, {"30d", 30 * 86400}};
+    for (const auto& r : ranges) {
+        std::time_t from = end - r.seconds;
+        long legacyRows = 0, partitionedRows = 0;
+        double legacyMs = timeQuery([&] { return queryLegacy(legacy, from, end); }, repeats, legacyRows);
+        double partitionedMs = timeQuery([&] { return queryPartitioned(partitioned, from, end); },
+                                         repeats, partitionedRows);
+        std::printf("range %-4s rows=%-8ld legacy=%9.2f ms  partitioned=%9.2f ms\n",
+                    r.name, partitionedRows, legacyMs, partitionedMs);
+        if (legacyRows != partitionedRows) {
+            std::cerr << "row count mismatch: " << legacyRows << " vs " << partitionedRows << std::endl;
+        }
+    }
+
+    // Очистка: все, что старше end - 30 суток
+    std::time_t cutoff = end - 30 * 86400;
+    t0 = Clock::now();
+    {
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(legacy, "DELETE FROM measurements WHERE timestamp < ?", -1, &stmt, nullptr);
+        std::string c = storage::formatTime(cutoff);
+        sqlite3_bind_text(stmt, 1, c.c_str(), -1, SQLITE_STATIC);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    std::cout << "retention legacy (DELETE):          " << secondsSince(t0) * 1000.0 << " ms" << std::endl;
+    t0 = Clock::now();
+    long dropped = 0;
+    for (const auto& p : storage::expiredPartitions(partitioned, cutoff)) {
+        storage::dropPartition(partitioned, p);
+        dropped++;
+    }
+    std::cout << "retention partitioned (DROP x" << dropped << "): "
+              << secondsSince(t0) * 1000.0 << " ms" << std::endl;
+
+    sqlite3_close(legacy);
+    sqlite3_close(partitioned);
+    std::cout << "size legacy=" << fileSize(legacyPath) / 1024 << " KiB"
+              << " partitioned=" << fileSize(partitionedPath) / 1024 << " KiB" << std::endl;
+
+    std::string cleanup = std::string("rm -rf ") + dir;
+    std::system(cleanup.c_str());
+    return 0;
+}
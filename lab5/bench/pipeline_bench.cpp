@@ -0,0 +1,494 @@
+// Сквозной бенчмарк lab5: simulator | logger и server на loopback во временном каталоге.
+// Симулятор в режиме нагрузки (--rate, --sensors, --pattern) работает --duration секунд,
+// логгер пишет в пустую БД, сервер читает ее. БД хранит одно значение на датчик в секунду,
+// поэтому по умолчанию датчиков столько же, сколько измерений в секунду на пике формы
+// нагрузки (loadgen::Options::wallClockSensors: N, 10N для burst, 1.8N для diurnal):
+// каждое измерение - отдельная строка. Пока идет запись, два клиента опрашивают сервер:
+//  - свежесть: /api/current?sensor=K для --freshness-sensors датчиков (по умолчанию 8,
+//    равномерно по номерам) каждые --poll-ms мс; для каждой новой секунды датчика в ответе
+//    задержка - момент, когда она впервые видна, минус сама метка (точность - период
+//    опроса). Датчик 0 отвечает из буфера сервера, остальные - из БД. Число задержек
+//    (count) печатается рядом с перцентилями: каждый датчик дает новую метку раз в круг
+//    датчиков, при пачках - раз в период;
+//  - запросы: по кругу /api/current, /api/stats за 10 минут и /api/stats за час с
+//    max_points=500, каждый в новом соединении, не чаще раза в --query-interval-ms мс.
+// По окончании печатает JSON: пропускная способность записи (строк в БД в секунду от запуска
+// до завершения логгера), перцентили свежести и запросов, пиковый RSS процессов (ru_maxrss)
+// и размер БД. Результаты удобно сохранять (--output FILE) и сравнивать между версиями.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sqlite3.h>
+
+#include "json_writer.h"
+#include "load_gen.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string simulator = "src/simulator";
+    std::string logger = "src/logger";
+    std::string server = "src/server";
+    int port = 18080;
+    double rate = 2000;
+    int sensors = 0;  // 0 - по числу измерений в секунду
+    int duration = 10;
+    std::string pattern = "steady";
+    int pollMs = 10;
+    int freshnessSensors = 8;
+    int queryIntervalMs = 20;
+    std::string loggerArgs;
+    std::string serverArgs;
+    std::string output;
+};
+
+struct Child {
+    pid_t pid = -1;
+    long maxRssKb = 0;
+    int status = 0;
+};
+
+std::vector<std::string> splitArgs(const std::string& s) {
+    std::vector<std::string> args;
+    size_t pos = 0;
+    while ((pos = s.find_first_not_of(' ', pos)) != std::string::npos) {
+        size_t end = s.find(' ', pos);
+        args.push_back(s.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+        pos = end;
+    }
+    return args;
+}
+
+std::string absolutePath(const std::string& path) {
+    if (!path.empty() && path[0] == '/') return path;
+    char cwd[4096];
+    return getcwd(cwd, sizeof(cwd)) ? std::string(cwd) + "/" + path : path;
+}
+
+// Запуск программы в каталоге dir; stdin/stdout подменяются, если inFd/outFd >= 0
+Child spawn(const std::string& dir, const std::vector<std::string>& args, int inFd, int outFd,
+            const std::vector<int>& closeFds) {
+    Child child;
+    child.pid = fork();
+    if (child.pid == 0) {
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        if (inFd >= 0) dup2(inFd, STDIN_FILENO);
+        if (outFd >= 0) dup2(outFd, STDOUT_FILENO);
+        for (int fd : closeFds) close(fd);
+        // Сообщения программ не смешиваются с JSON
+        int null = open("/dev/null", O_WRONLY);
+        if (outFd < 0) dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+
+        std::vector<char*> argv;
+        for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    return child;
+}
+
+// Ожидание завершения с пиковым RSS процесса
+void reap(Child& child) {
+    if (child.pid <= 0) return;
+    rusage usage{};
+    if (wait4(child.pid, &child.status, 0, &usage) == child.pid) {
+        child.maxRssKb = usage.ru_maxrss;
+    }
+    child.pid = -1;
+}
+
+// Остановка сервера: SIGINT, через 5 с - SIGKILL
+void stop(Child& child) {
+    if (child.pid <= 0) return;
+    kill(child.pid, SIGINT);
+    auto exited = [&] {
+        siginfo_t info{};
+        return waitid(P_PID, child.pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == child.pid;
+    };
+    for (int i = 0; i < 50 && !exited(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!exited()) kill(child.pid, SIGKILL);
+    reap(child);
+}
+
+int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// GET в новом соединении, тело ответа 200 в body
+bool get(int port, const std::string& path, std::string& body) {
+    int fd = connectTo(port);
+    if (fd < 0) return false;
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+    std::string response;
+    char buffer[16384];
+    while (ok) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0) ok = false;
+        if (n <= 0) break;
+        response.append(buffer, n);
+    }
+    close(fd);
+
+    size_t headersEnd = response.find("\r\n\r\n");
+    if (!ok || headersEnd == std::string::npos || response.compare(8, 5, " 200 ") != 0) return false;
+    body.assign(response, headersEnd + 4, std::string::npos);
+    return true;
+}
+
+std::string isoTime(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+// Метка "timestamp":"YYYY-MM-DDTHH:MM:SS" ответа /api/current
+bool currentTimestamp(const std::string& body, std::time_t& epoch) {
+    static const char KEY[] = "\"timestamp\":\"";
+    size_t pos = body.find(KEY);
+    if (pos == std::string::npos) return false;
+    std::tm tm{};
+    if (!strptime(body.c_str() + pos + sizeof(KEY) - 1, "%Y-%m-%dT%H:%M:%S", &tm)) return false;
+    tm.tm_isdst = -1;
+    epoch = std::mktime(&tm);
+    return true;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+// Датчики, которые опрашивает клиент свежести: равномерно по номерам
+std::vector<int> freshnessSensors(const Options& opt) {
+    int count = std::min(opt.freshnessSensors, opt.sensors);
+    std::vector<int> sensors;
+    for (int i = 0; i < count; ++i) {
+        sensors.push_back(static_cast<int>(static_cast<long long>(i) * opt.sensors / count));
+    }
+    return sensors;
+}
+
+// Задержки свежести, мс. Каждый датчик получает новую метку раз в круг датчиков (при пачках -
+// раз в период), поэтому опрашивается несколько датчиков: иначе выборка из нескольких точек
+void pollFreshness(const Options& opt, const std::atomic<bool>& running, std::vector<double>& latencies) {
+    std::vector<int> sensors = freshnessSensors(opt);
+    std::vector<std::time_t> seen(sensors.size(), 0);
+    std::string body;
+    while (running) {
+        for (size_t i = 0; i < sensors.size(); ++i) {
+            std::time_t epoch;
+            std::string path = sensors[i] == 0 ? "/api/current" : "/api/current?sensor=" + std::to_string(sensors[i]);
+            if (get(opt.port, path, body) && currentTimestamp(body, epoch) && epoch > seen[i]) {
+                auto now = std::chrono::system_clock::now();
+                if (seen[i] != 0) {
+                    latencies.push_back(std::chrono::duration<double, std::milli>(
+                                            now - std::chrono::system_clock::from_time_t(epoch)).count());
+                }
+                seen[i] = epoch;  // первая увиденная секунда могла начаться до опроса
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.pollMs));
+    }
+}
+
+struct QueryStats {
+    std::string name;
+    std::vector<double> latenciesUs;
+    long errors = 0;
+};
+
+void runQueries(const Options& opt, const std::atomic<bool>& running, std::vector<QueryStats>& stats) {
+    stats = {{"current", {}, 0}, {"stats_10min", {}, 0}, {"stats_1h_500", {}, 0}};
+    std::string body;
+    for (size_t i = 0; running; ++i) {
+        std::time_t now = std::time(nullptr);
+        QueryStats& q = stats[i % stats.size()];
+        std::string path = i % 3 == 0 ? "/api/current"
+                         : i % 3 == 1 ? "/api/stats?start=" + isoTime(now - 600) + "&end=" + isoTime(now)
+                                      : "/api/stats?start=" + isoTime(now - 3600) + "&end=" + isoTime(now) +
+                                            "&max_points=500";
+        auto start = Clock::now();
+        if (get(opt.port, path, body)) {
+            q.latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        } else {
+            q.errors++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(opt.queryIntervalMs));
+    }
+}
+
+// Строки во всех секциях БД
+long long countRows(const std::string& db) {
+    sqlite3* conn;
+    if (sqlite3_open_v2(db.c_str(), &conn, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        sqlite3_close(conn);
+        return -1;
+    }
+    std::vector<std::string> names;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(conn, "SELECT name FROM measurement_partitions", -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            names.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+    }
+    long long rows = 0;
+    for (const auto& name : names) {
+        if (sqlite3_prepare_v2(conn, ("SELECT COUNT(*) FROM " + name).c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) rows += sqlite3_column_int64(stmt, 0);
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_close(conn);
+    return rows;
+}
+
+long long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<long long>(st.st_size) : 0;
+}
+
+void writePercentiles(json::Writer& w, std::vector<double>& values, long errors, bool withErrors) {
+    std::sort(values.begin(), values.end());
+    w.raw("{\"count\":");
+    w.integer(static_cast<long long>(values.size()));
+    if (withErrors) {
+        w.raw(",\"errors\":");
+        w.integer(errors);
+    }
+    w.raw(",\"p50\":");
+    w.number(percentile(values, 0.50), 1);
+    w.raw(",\"p99\":");
+    w.number(percentile(values, 0.99), 1);
+    w.raw(",\"max\":");
+    w.number(values.empty() ? 0 : values.back(), 1);
+    w.raw('}');
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--simulator" && i + 1 < argc) opt.simulator = argv[++i];
+        else if (arg == "--logger" && i + 1 < argc) opt.logger = argv[++i];
+        else if (arg == "--server" && i + 1 < argc) opt.server = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) opt.port = std::atoi(argv[++i]);
+        else if (arg == "--rate" && i + 1 < argc) opt.rate = std::atof(argv[++i]);
+        else if (arg == "--sensors" && i + 1 < argc) opt.sensors = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--duration" && i + 1 < argc) opt.duration = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--pattern" && i + 1 < argc) opt.pattern = argv[++i];
+        else if (arg == "--poll-ms" && i + 1 < argc) opt.pollMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--freshness-sensors" && i + 1 < argc) opt.freshnessSensors = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--query-interval-ms" && i + 1 < argc) opt.queryIntervalMs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--logger-args" && i + 1 < argc) opt.loggerArgs = argv[++i];
+        else if (arg == "--server-args" && i + 1 < argc) opt.serverArgs = argv[++i];
+        else if (arg == "--output" && i + 1 < argc) opt.output = argv[++i];
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--simulator PATH] [--logger PATH] [--server PATH] [--port N]"
+                         " [--rate N] [--sensors N] [--duration SEC] [--pattern steady|burst|diurnal]"
+                         " [--poll-ms MS] [--freshness-sensors N] [--query-interval-ms MS] [--logger-args \"...\"]"
+                         " [--server-args \"...\"] [--output FILE]" << std::endl;
+            return 1;
+        }
+    }
+    // Та же форма нагрузки, что у симулятора: пиковая частота и число выданных измерений
+    loadgen::Options load;
+    load.rate = opt.rate;
+    if (opt.pattern == "steady") load.pattern = loadgen::Pattern::Steady;
+    else if (opt.pattern == "burst") load.pattern = loadgen::Pattern::Burst;
+    else if (opt.pattern == "diurnal") load.pattern = loadgen::Pattern::Diurnal;
+    else {
+        std::cerr << "Unknown pattern " << opt.pattern << std::endl;
+        return 1;
+    }
+    int needed = std::max(1, load.wallClockSensors());
+    if (opt.sensors == 0) {
+        opt.sensors = needed;
+    } else if (opt.sensors < needed) {
+        std::cerr << "Warning: " << opt.sensors << " sensors at peak rate " << load.peakRate()
+                  << "/s: the database keeps one sample per sensor per second, rows will undercount"
+                  << " ingest (need " << needed << " sensors)" << std::endl;
+    }
+    opt.simulator = absolutePath(opt.simulator);
+    opt.logger = absolutePath(opt.logger);
+    opt.server = absolutePath(opt.server);
+
+    char dirTemplate[] = "/tmp/pipeline_benchXXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string dir = dirTemplate;
+    std::string db = dir + "/measurements.db";
+
+    // simulator | logger
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) {
+        std::perror("pipe");
+        return 1;
+    }
+    std::vector<std::string> simulatorArgs = {opt.simulator, "--rate", std::to_string(opt.rate),
+                                              "--sensors", std::to_string(opt.sensors),
+                                              "--duration", std::to_string(opt.duration),
+                                              "--pattern", opt.pattern, "--seed", "1"};
+    std::vector<std::string> loggerArgs = {opt.logger, "--db", db};
+    for (const auto& a : splitArgs(opt.loggerArgs)) loggerArgs.push_back(a);
+
+    auto start = Clock::now();
+    Child simulator = spawn(dir, simulatorArgs, -1, pipeFds[1], {pipeFds[0], pipeFds[1]});
+    Child logger = spawn(dir, loggerArgs, pipeFds[0], -1, {pipeFds[0], pipeFds[1]});
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    // Сервер открывает БД, созданную логгером
+    for (int i = 0; i < 100 && fileSize(db) == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    std::vector<std::string> serverArgs = {opt.server, "--port", std::to_string(opt.port),
+                                           "--db", db, "--static", dir};
+    for (const auto& a : splitArgs(opt.serverArgs)) serverArgs.push_back(a);
+    Child server = spawn(dir, serverArgs, -1, -1, {});
+    bool serverReady = false;
+    for (int i = 0; i < 100 && !serverReady; ++i) {
+        int fd = connectTo(opt.port);
+        serverReady = fd >= 0;
+        if (fd >= 0) close(fd);
+        else std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (!serverReady) {
+        std::cerr << "Server did not start on port " << opt.port << std::endl;
+    }
+
+    std::atomic<bool> running{true};
+    std::vector<double> freshness;
+    std::vector<QueryStats> queries;
+    std::thread freshnessThread(pollFreshness, std::cref(opt), std::cref(running), std::ref(freshness));
+    std::thread queryThread(runQueries, std::cref(opt), std::cref(running), std::ref(queries));
+
+    // Логгер завершается, записав все измерения после конца ввода
+    reap(simulator);
+    reap(logger);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    running = false;
+    freshnessThread.join();
+    queryThread.join();
+    stop(server);
+
+    long long rows = countRows(db);
+    long long dbBytes = fileSize(db) + fileSize(db + "-wal") + fileSize(db + "-shm");
+
+    std::string out;
+    json::Writer w(out);
+    w.raw("{\"config\":{\"rate\":");
+    w.number(opt.rate, 0);
+    w.raw(",\"sensors\":");
+    w.integer(opt.sensors);
+    w.raw(",\"peak_rate\":");
+    w.number(load.peakRate(), 0);
+    w.raw(",\"duration_s\":");
+    w.integer(opt.duration);
+    w.raw(",\"pattern\":");
+    w.string(opt.pattern);
+    w.raw(",\"logger_args\":");
+    w.string(opt.loggerArgs);
+    w.raw(",\"server_args\":");
+    w.string(opt.serverArgs);
+    w.raw("},\"started\":\"");
+    w.time(std::time(nullptr) - static_cast<std::time_t>(elapsed));
+    w.raw("\",\"ingest\":{\"rows\":");
+    w.integer(rows);
+    w.raw(",\"offered\":");
+    w.integer(static_cast<long long>(std::llround(load.expected(opt.duration))));
+    w.raw(",\"elapsed_s\":");
+    w.number(elapsed, 3);
+    w.raw(",\"samples_per_s\":");
+    w.number(rows > 0 ? rows / elapsed : 0, 0);
+    w.raw(",\"logger_exit\":");
+    w.integer(WIFEXITED(logger.status) ? WEXITSTATUS(logger.status) : -1);
+    w.raw("},\"freshness_ms\":");
+    writePercentiles(w, freshness, 0, false);
+    w.raw(",\"freshness_sensors\":");
+    w.integer(static_cast<long long>(freshnessSensors(opt).size()));
+    w.raw(",\"queries_us\":{");
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (i > 0) w.raw(',');
+        w.raw('"');
+        w.raw(queries[i].name.c_str());
+        w.raw("\":");
+        writePercentiles(w, queries[i].latenciesUs, queries[i].errors, true);
+    }
+    w.raw("},\"max_rss_kb\":{\"simulator\":");
+    w.integer(simulator.maxRssKb);
+    w.raw(",\"logger\":");
+    w.integer(logger.maxRssKb);
+    w.raw(",\"server\":");
+    w.integer(server.maxRssKb);
+    w.raw("},\"db\":{\"bytes\":");
+    w.integer(dbBytes);
+    w.raw(",\"bytes_per_row\":");
+    w.number(rows > 0 ? static_cast<double>(dbBytes) / rows : 0, 1);
+    w.raw("}}\n");
+
+    std::string cleanup = "rm -rf " + dir;
+    std::system(cleanup.c_str());
+
+    if (opt.output.empty()) {
+        std::cout << out;
+    } else {
+        std::ofstream file(opt.output);
+        file << out;
+        if (!file) {
+            std::cerr << "Cannot write " << opt.output << std::endl;
+            return 1;
+        }
+        std::cerr << "Results written to " << opt.output << std::endl;
+    }
+    return rows > 0 && serverReady ? 0 : 1;
+}
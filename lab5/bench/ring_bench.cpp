@@ -0,0 +1,185 @@
+// Бенчмарк передачи измерений от симулятора к потребителям:
+// текст через pipe с разбором istringstream + std::get_time (как в логгере)
+// против кольцевого буфера в разделяемой памяти (sample_ring.h) с 1 и READERS читателями.
+// Писатель и читатели - отдельные процессы; время - от начала записи до получения
+// последнего измерения всеми читателями.
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "storage.h"
+#include "sample_ring.h"
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double sampleValue(long i) {
+    return 18.0 + (i % 1000) / 100.0;
+}
+
+// Разбор строки так же, как в логгере
+std::time_t parseLine(const std::string& line, double& temp) {
+    std::istringstream ss(line);
+    std::string ts;
+    ss >> ts >> temp;
+    std::tm tm{};
+    std::istringstream ts_ss(ts);
+    ts_ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+void benchPipe(long samples, std::time_t start) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        std::exit(1);
+    }
+
+    auto t0 = Clock::now();
+    pid_t child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        FILE* out = fdopen(fds[1], "w");
+        for (long i = 0; i < samples; ++i) {
+            std::tm tm = storage::toLocalTm(start + i);
+            char ts[32];
+            std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm);
+            std::fprintf(out, "%s %.2f\n", ts, sampleValue(i));
+        }
+        std::fclose(out);
+        std::_Exit(0);
+    }
+    close(fds[1]);
+
+    FILE* in = fdopen(fds[0], "r");
+    char buf[128];
+    long received = 0;
+    std::time_t last = 0;
+    while (std::fgets(buf, sizeof(buf), in)) {
+        double temp;
+        last = parseLine(buf, temp);
+        received++;
+    }
+    std::fclose(in);
+    waitpid(child, nullptr, 0);
+
+    double elapsed = secondsSince(t0);
+    std::printf("pipe + text parse:   %8.3f s  %10.0f samples/s  received=%ld ok=%d\n",
+                elapsed, samples / elapsed, received, last == start + samples - 1);
+}
+
+// Читатель в отдельном процессе: ждет, пока писатель опубликует все samples записей.
+// Результат - через разделяемую страницу results[index]
+struct ReaderResult {
+    long received;
+    long lost;
+    long outOfOrder;
+};
+
+void runReader(const std::string& name, long samples, ReaderResult* result) {
+    ring::Reader reader;
+    while (!reader.open(name)) {
+        usleep(1000);
+    }
+    ring::Record records[256];
+    long received = 0;
+    long outOfOrder = 0;
+    std::time_t last = 0;
+    while (static_cast<long>(reader.position()) < samples) {
+        size_t count = reader.read(records, sizeof(records) / sizeof(records[0]));
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].epoch <= last) outOfOrder++;
+            last = records[i].epoch;
+        }
+        received += count;
+    }
+    result->received = received;
+    result->lost = static_cast<long>(reader.lost());
+    result->outOfOrder = outOfOrder;
+}
+
+void benchRing(long samples, std::time_t start, int readers, uint64_t capacity) {
+    std::string name = "/lab5_ring_bench_" + std::to_string(getpid());
+    ring::Writer writer;
+    if (!writer.open(name, capacity)) {
+        std::perror("shm_open");
+        std::exit(1);
+    }
+
+    void* shared = mmap(nullptr, sizeof(ReaderResult) * readers, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    auto* results = static_cast<ReaderResult*>(shared);
+
+    std::vector<pid_t> children;
+    for (int r = 0; r < readers; ++r) {
+        pid_t child = fork();
+        if (child == 0) {
+            runReader(name, samples, &results[r]);
+            std::_Exit(0);
+        }
+        children.push_back(child);
+    }
+
+    auto t0 = Clock::now();
+    for (long i = 0; i < samples; ++i) {
+        writer.push(start + i, sampleValue(i));
+    }
+    for (pid_t child : children) {
+        waitpid(child, nullptr, 0);
+    }
+    double elapsed = secondsSince(t0);
+
+    long received = 0, lost = 0, outOfOrder = 0;
+    for (int r = 0; r < readers; ++r) {
+        received += results[r].received;
+        lost += results[r].lost;
+        outOfOrder += results[r].outOfOrder;
+    }
+    std::printf("shm ring, %d reader%s: %8.3f s  %10.0f samples/s  received=%ld lost=%ld out_of_order=%ld"
+                " (capacity %llu)\n",
+                readers, readers == 1 ? " " : "s", elapsed, samples / elapsed, received, lost, outOfOrder,
+                static_cast<unsigned long long>(capacity));
+
+    munmap(shared, sizeof(ReaderResult) * readers);
+    shm_unlink(name.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    long samples = 2000000;
+    int readers = 4;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--samples" && i + 1 < argc) samples = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--readers" && i + 1 < argc) readers = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--samples N] [--readers N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::time_t start = std::time(nullptr) - samples;
+    std::printf("samples=%ld\n", samples);
+    benchPipe(samples, start);
+    // Буфер на все измерения: читатели не теряют записей, меряется стоимость передачи
+    benchRing(samples, start, 1, samples);
+    benchRing(samples, start, readers, samples);
+    // Буфер по умолчанию: писатель не ждет читателей, отставшие теряют записи
+    benchRing(samples, start, readers, ring::DEFAULT_CAPACITY);
+    return 0;
+}
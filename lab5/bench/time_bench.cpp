@@ -0,0 +1,206 @@
+// Микробенчмарк разбора строк симулятора "YYYY-MM-DDTHH:MM:SS temperature":
+// istringstream + std::get_time + mktime (прежний код логгеров) против timestamp::Parser
+// (timestamp.h) + strtod. Файл из LINES строк (по умолчанию 10 млн, одно измерение
+// в секунду) создается во временном каталоге; результаты обоих способов сверяются.
+// Второй прогон разбирает файл из памяти в THREADS потоках: mktime берет глобальную
+// блокировку часового пояса, и прежний способ почти не масштабируется.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "timestamp.h"
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Контрольная сумма разобранных значений: сумма времени и температуры в сотых
+struct Checksum {
+    long long epochs = 0;
+    long long values = 0;
+    long lines = 0;
+    long failed = 0;
+
+    void add(std::time_t epoch, double value) {
+        epochs += epoch;
+        values += static_cast<long long>(value * 100.0 + 0.5);
+        lines++;
+    }
+
+    bool operator==(const Checksum& other) const {
+        return epochs == other.epochs && values == other.values && lines == other.lines;
+    }
+};
+
+bool parseStream(const char* line, size_t len, std::time_t& epoch, double& value) {
+    std::istringstream ss(std::string(line, len));
+    std::string ts;
+    if (!(ss >> ts >> value)) return false;
+    std::tm tm{};
+    std::istringstream tsStream(ts);
+    tsStream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if (tsStream.fail()) return false;
+    tm.tm_isdst = -1;
+    epoch = std::mktime(&tm);
+    return true;
+}
+
+bool parseFast(timestamp::Parser& parser, const char* line, size_t len, std::time_t& epoch, double& value) {
+    if (!parser.parse(line, len, epoch)) return false;
+    const char* begin = line + 19;
+    char* end;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
+
+Checksum parseFile(const std::string& path, bool fast) {
+    std::ifstream in(path);
+    timestamp::Parser parser;
+    Checksum sum;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::time_t epoch;
+        double value;
+        bool ok = fast ? parseFast(parser, line.data(), line.size(), epoch, value)
+                       : parseStream(line.data(), line.size(), epoch, value);
+        if (ok) sum.add(epoch, value);
+        else sum.failed++;
+    }
+    return sum;
+}
+
+// Разбор строк [begin, end) буфера в памяти
+Checksum parseRange(const char* begin, const char* end, bool fast) {
+    timestamp::Parser parser;
+    Checksum sum;
+    while (begin < end) {
+        const char* eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!eol) eol = end;
+        std::time_t epoch;
+        double value;
+        bool ok = fast ? parseFast(parser, begin, eol - begin, epoch, value)
+                       : parseStream(begin, eol - begin, epoch, value);
+        if (ok) sum.add(epoch, value);
+        else sum.failed++;
+        begin = eol + 1;
+    }
+    return sum;
+}
+
+Checksum parseParallel(const std::string& data, int threads, bool fast) {
+    std::vector<Checksum> results(threads);
+    std::vector<std::thread> workers;
+    const char* base = data.data();
+    const char* limit = base + data.size();
+    const char* begin = base;
+    for (int t = 0; t < threads; ++t) {
+        // Границы частей - по концам строк
+        const char* end = t + 1 == threads ? limit : base + data.size() * (t + 1) / threads;
+        if (end < limit) {
+            const char* eol = static_cast<const char*>(std::memchr(end, '\n', limit - end));
+            end = eol ? eol + 1 : limit;
+        }
+        workers.emplace_back([&results, t, begin, end, fast] { results[t] = parseRange(begin, end, fast); });
+        begin = end;
+    }
+    Checksum total;
+    for (int t = 0; t < threads; ++t) {
+        workers[t].join();
+        total.epochs += results[t].epochs;
+        total.values += results[t].values;
+        total.lines += results[t].lines;
+        total.failed += results[t].failed;
+    }
+    return total;
+}
+
+void report(const char* name, double seconds, const Checksum& sum, double baseline) {
+    std::printf("%-34s %8.3f s  %6.1f M lines/s", name, seconds, sum.lines / seconds / 1e6);
+    if (baseline > 0) std::printf("  (x%.1f)", baseline / seconds);
+    std::printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    long lines = 10000000;
+    int threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lines" && i + 1 < argc) lines = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--lines N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/time_benchXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string path = std::string(dir) + "/measurements.txt";
+
+    // Файл в формате симулятора: одно измерение в секунду до текущего момента
+    {
+        FILE* out = std::fopen(path.c_str(), "w");
+        std::time_t start = std::time(nullptr) - lines;
+        for (long i = 0; i < lines; ++i) {
+            std::time_t t = start + i;
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            char ts[32];
+            std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm);
+            std::fprintf(out, "%s %.2f\n", ts, 18.0 + (i % 1000) / 100.0);
+        }
+        std::fclose(out);
+    }
+    std::printf("lines=%ld threads=%d file=%s\n", lines, threads, path.c_str());
+
+    auto t0 = Clock::now();
+    Checksum stream = parseFile(path, false);
+    double streamSec = secondsSince(t0);
+    t0 = Clock::now();
+    Checksum fast = parseFile(path, true);
+    double fastSec = secondsSince(t0);
+    report("getline + get_time + mktime:", streamSec, stream, 0);
+    report("getline + timestamp::Parser:", fastSec, fast, streamSec);
+
+    std::string data;
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        data = buffer.str();
+    }
+    t0 = Clock::now();
+    Checksum streamParallel = parseParallel(data, threads, false);
+    double streamParallelSec = secondsSince(t0);
+    t0 = Clock::now();
+    Checksum fastParallel = parseParallel(data, threads, true);
+    double fastParallelSec = secondsSince(t0);
+    std::string title = "memory, " + std::to_string(threads) + " threads, get_time:";
+    report(title.c_str(), streamParallelSec, streamParallel, 0);
+    title = "memory, " + std::to_string(threads) + " threads, Parser:";
+    report(title.c_str(), fastParallelSec, fastParallel, streamParallelSec);
+
+    bool ok = stream == fast && stream == streamParallel && stream == fastParallel && stream.failed == 0;
+    std::printf("results %s (failed lines: %ld)\n", ok ? "match" : "MISMATCH", fast.failed);
+
+    unlink(path.c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -14,7 +14,7 @@ set ERRORS=0
 REM Компилируем Simulator
 echo.
 echo [1/3] Компиляция Simulator
-%COMPILER% -std=c++17 -o simulator.exe simulator.cpp
+%COMPILER% -std=c++17 -O2 -o simulator.exe simulator.cpp
 if errorlevel 1 (
     echo Ошибка компиляции Simulator
     set /a ERRORS=ERRORS+1
@@ -25,7 +25,7 @@ if errorlevel 1 (
 REM Компилируем Logger
 echo.
 echo [2/3] Компиляция Logger (с SQLite)
-%COMPILER% -std=c++17 -o logger.exe logger.cpp -lsqlite3
+%COMPILER% -std=c++17 -O2 -o logger.exe logger.cpp -lsqlite3
 if errorlevel 1 (
     echo Ошибка компиляции Logger
     set /a ERRORS=ERRORS+1
@@ -36,7 +36,7 @@ if errorlevel 1 (
 REM Компилируем Server
 echo.
 echo [3/3] Компиляция Server (с SQLite и Winsock2)
-%COMPILER% -std=c++17 -o server.exe server.cpp -lsqlite3 -lws2_32
+%COMPILER% -std=c++17 -O2 -o server.exe server.cpp -lsqlite3 -lws2_32
 if errorlevel 1 (
     echo Ошибка компиляции Server
     set /a ERRORS=ERRORS+1
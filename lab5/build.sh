@@ -6,21 +6,37 @@ cd "$(dirname "$0")/src"
 if [[ "$OSTYPE" == "msys" || "$OSTYPE" == "cygwin" || "$OSTYPE" == "win32" ]]; then
     # Windows
     COMPILER=${CXX:-clang++}
-    SIMULATOR_FLAGS="-std=c++17"
-    LOGGER_FLAGS="-std=c++17 -lsqlite3"
-    SERVER_FLAGS="-std=c++17 -lsqlite3 -lws2_32"
+    SIMULATOR_FLAGS="-std=c++17 -O2"
+    LOGGER_FLAGS="-std=c++17 -O2"
+    LOGGER_LIBS="-lsqlite3"
+    SERVER_FLAGS="-std=c++17 -O2"
+    SERVER_LIBS="-lsqlite3 -lws2_32"
     EXE_EXT=".exe"
     USE_COLOR=0
 else
     # POSIX (Linux, macOS)
     COMPILER=${CXX:-clang++}
-    SIMULATOR_FLAGS="-std=c++17"
-    LOGGER_FLAGS="-std=c++17 -lsqlite3"
-    SERVER_FLAGS="-std=c++17 -lsqlite3"
+    SIMULATOR_FLAGS="-std=c++17 -O2"
+    LOGGER_FLAGS="-std=c++17 -O2"
+    LOGGER_LIBS="-lsqlite3"
+    SERVER_FLAGS="-std=c++17 -O2 -pthread"
+    SERVER_LIBS="-lsqlite3"
     EXE_EXT=""
     USE_COLOR=1
 fi
 
+# Сжатие статических файлов сервера: gzip (zlib) и brotli, если библиотеки установлены
+if command -v pkg-config > /dev/null 2>&1; then
+    if pkg-config --exists zlib; then
+        SERVER_FLAGS="$SERVER_FLAGS -DHAVE_ZLIB $(pkg-config --cflags zlib)"
+        SERVER_LIBS="$SERVER_LIBS $(pkg-config --libs zlib)"
+    fi
+    if pkg-config --exists libbrotlienc; then
+        SERVER_FLAGS="$SERVER_FLAGS -DHAVE_BROTLI $(pkg-config --cflags libbrotlienc)"
+        SERVER_LIBS="$SERVER_LIBS $(pkg-config --libs libbrotlienc)"
+    fi
+fi
+
 if [ $USE_COLOR -eq 1 ]; then
     RED='\033[0;31m'
     GREEN='\033[0;32m'
@@ -48,7 +64,7 @@ fi
 # Компилируем Logger
 echo ""
 echo -e "${YELLOW}[2/3]${NC} Компиляция Logger (с SQLite)"
-if $COMPILER $LOGGER_FLAGS -o logger$EXE_EXT logger.cpp; then
+if $COMPILER $LOGGER_FLAGS -o logger$EXE_EXT logger.cpp $LOGGER_LIBS; then
     echo -e "${GREEN}Logger скомпилирован успешно${NC}"
 else
     echo -e "${RED}Ошибка компиляции Logger${NC}"
@@ -58,7 +74,7 @@ fi
 # Компилируем Server
 echo ""
 echo -e "${YELLOW}[3/3]${NC} Компиляция Server (с SQLite)"
-if $COMPILER $SERVER_FLAGS -o server$EXE_EXT server.cpp; then
+if $COMPILER $SERVER_FLAGS -o server$EXE_EXT server.cpp $SERVER_LIBS; then
     echo -e "${GREEN}Server скомпилирован успешно${NC}"
 else
     echo -e "${RED}Ошибка компиляции Server${NC}"
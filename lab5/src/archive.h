@@ -0,0 +1,594 @@
+#pragma once
+// Архив измерений: компактный двоичный формат для долговременного хранения одного ряда
+// (измерений одного датчика по возрастанию времени).
+//
+// Файл - заголовок и последовательность блоков до BLOCK_SAMPLES измерений. Блок начинается
+// с заголовка, который служит и индексом: число измерений, время первого и последнего,
+// min, max и сумма значений. За ним два столбца, каждый - битовый поток:
+//  - время: разность соседних разностей (delta-of-delta). При постоянном интервале
+//    симулятора разность разностей равна нулю и занимает один бит;
+//  - значения: XOR с предыдущим значением (Gorilla). Повтор значения - один бит,
+//    у близких значений совпадают знак, порядок и старшие разряды мантиссы, поэтому
+//    хранятся только значащие биты между ведущими и хвостовыми нулями XOR.
+//
+// Reader отображает файл в память (mmap) и при открытии собирает индекс из заголовков
+// блоков. Запрос за период находит первый нужный блок двоичным поиском и распаковывает
+// только пересекающиеся с периодом блоки; агрегаты блока, целиком попавшего в интервал,
+// берутся из заголовка без распаковки.
+//
+// Файл только дописывается, записанные блоки не меняются. Блок пишется одной операцией;
+// недописанный блок в конце файла (сбой во время записи) читатель пропускает, а Writer
+// при открытии отрезает. Порядок байт - порядок байт машины (x86 и ARM - little-endian).
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace archive {
+
+const uint32_t MAGIC = 0x5241354c;        // "L5AR"
+const uint32_t BLOCK_MAGIC = 0x4b42354c;  // "L5BK"
+const uint32_t VERSION = 1;
+// Измерений в блоке: больше - лучше сжатие, меньше - точнее отбор блоков по индексу
+const uint32_t BLOCK_SAMPLES = 1024;
+const char* const EXTENSION = ".l5a";
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t reserved;
+};
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t count;
+    int64_t firstTime;
+    int64_t lastTime;
+    double minValue;
+    double maxValue;
+    double sum;
+    uint32_t timeBytes;   // длина столбца времени
+    uint32_t valueBytes;  // длина столбца значений
+};
+
+// Файл ряда датчика в каталоге архива
+inline std::string seriesPath(const std::string& dir, int sensor) {
+    return dir + "/sensor_" + std::to_string(sensor) + EXTENSION;
+}
+
+inline int leadingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return x ? __builtin_clzll(x) : 64;
+#else
+    int n = 0;
+    for (uint64_t bit = 1ull << 63; bit && !(x & bit); bit >>= 1) n++;
+    return n;
+#endif
+}
+
+inline int trailingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return x ? __builtin_ctzll(x) : 64;
+#else
+    int n = 0;
+    for (uint64_t bit = 1; bit && !(x & bit); bit <<= 1) n++;
+    return n;
+#endif
+}
+
+inline uint64_t toBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double fromBits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Битовый поток, старшие биты первыми
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    // Младшие bits (1..64) битов value
+    void write(uint64_t value, int bits) {
+        while (bits > 0) {
+            if (free == 0) {
+                out.push_back(0);
+                free = 8;
+            }
+            int take = std::min(bits, free);
+            uint64_t part = (value >> (bits - take)) & ((1u << take) - 1);
+            out.back() |= static_cast<uint8_t>(part << (free - take));
+            free -= take;
+            bits -= take;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out;
+    int free = 0;  // свободных битов в последнем байте
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint64_t read(int bits) {
+        if (bits == 0) return 0;
+        if (bits > 56) {
+            uint64_t high = read(bits - 32);
+            return (high << 32) | read(32);
+        }
+        // 8 байт от текущего: после сдвига на смещение внутри байта остается не меньше 57 битов
+        uint64_t window = load(position >> 3) << (position & 7);
+        position += bits;
+        return window >> (64 - bits);
+    }
+
+    bool readBit() {
+        bool bit = position < size * 8 && ((data[position >> 3] >> (7 - (position & 7))) & 1);
+        position++;
+        return bit;
+    }
+
+    // Не вышло ли чтение за конец потока (поврежденный блок)
+    bool overrun() const {
+        return position > size * 8;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;  // в битах
+
+    uint64_t load(size_t byte) const {
+        uint64_t v = 0;
+        if (byte + 8 <= size) {
+            std::memcpy(&v, data + byte, 8);
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_bswap64(v);
+#else
+            uint64_t r = 0;
+            for (int i = 0; i < 8; ++i) r = (r << 8) | ((v >> (8 * i)) & 0xff);
+            return r;
+#endif
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            v = (v << 8) | (byte + i < size ? data[byte + i] : 0);
+        }
+        return v;
+    }
+};
+
+// Разность разностей меток времени: 0 - один бит '0', остальное - префикс класса и значение
+// со смещением: '10' + 7 битов, '110' + 9, '1110' + 12, '1111' + 64 (без сжатия)
+inline void writeTimeDelta(BitWriter& bits, int64_t dod) {
+    if (dod == 0) {
+        bits.write(0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        bits.write(0x2, 2);
+        bits.write(static_cast<uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        bits.write(0x6, 3);
+        bits.write(static_cast<uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        bits.write(0xe, 4);
+        bits.write(static_cast<uint64_t>(dod + 2047), 12);
+    } else {
+        bits.write(0xf, 4);
+        bits.write(static_cast<uint64_t>(dod), 64);
+    }
+}
+
+inline int64_t readTimeDelta(BitReader& bits) {
+    if (!bits.readBit()) return 0;
+    if (!bits.readBit()) return static_cast<int64_t>(bits.read(7)) - 63;
+    if (!bits.readBit()) return static_cast<int64_t>(bits.read(9)) - 255;
+    if (!bits.readBit()) return static_cast<int64_t>(bits.read(12)) - 2047;
+    return static_cast<int64_t>(bits.read(64));
+}
+
+// Сжатие блока: заголовок и оба столбца дописываются в out
+inline void encodeBlock(const std::time_t* times, const double* values, size_t count,
+                        std::vector<uint8_t>& out) {
+    BlockHeader header{};
+    header.magic = BLOCK_MAGIC;
+    header.count = static_cast<uint32_t>(count);
+    header.firstTime = times[0];
+    header.lastTime = times[count - 1];
+    header.minValue = values[0];
+    header.maxValue = values[0];
+
+    std::vector<uint8_t> timeColumn;
+    BitWriter timeBits(timeColumn);
+    int64_t prevDelta = 0;
+    for (size_t i = 1; i < count; ++i) {
+        int64_t delta = static_cast<int64_t>(times[i] - times[i - 1]);
+        writeTimeDelta(timeBits, delta - prevDelta);
+        prevDelta = delta;
+    }
+
+    std::vector<uint8_t> valueColumn;
+    BitWriter valueBits(valueColumn);
+    uint64_t prev = toBits(values[0]);
+    valueBits.write(prev, 64);
+    int prevLeading = -1;  // окно значащих битов предыдущего XOR
+    int prevTrailing = 0;
+    for (size_t i = 0; i < count; ++i) {
+        header.minValue = std::min(header.minValue, values[i]);
+        header.maxValue = std::max(header.maxValue, values[i]);
+        header.sum += values[i];
+        if (i == 0) continue;
+
+        uint64_t current = toBits(values[i]);
+        uint64_t x = current ^ prev;
+        prev = current;
+        if (x == 0) {
+            valueBits.write(0, 1);
+            continue;
+        }
+        int leading = std::min(leadingZeros(x), 31);
+        int trailing = trailingZeros(x);
+        if (prevLeading >= 0 && leading >= prevLeading && trailing >= prevTrailing) {
+            // Значащие биты укладываются в окно предыдущего XOR
+            valueBits.write(0x2, 2);
+            valueBits.write(x >> prevTrailing, 64 - prevLeading - prevTrailing);
+        } else {
+            int meaningful = 64 - leading - trailing;
+            valueBits.write(0x3, 2);
+            valueBits.write(static_cast<uint64_t>(leading), 5);
+            valueBits.write(static_cast<uint64_t>(meaningful - 1), 6);
+            valueBits.write(x >> trailing, meaningful);
+            prevLeading = leading;
+            prevTrailing = trailing;
+        }
+    }
+
+    header.timeBytes = static_cast<uint32_t>(timeColumn.size());
+    header.valueBytes = static_cast<uint32_t>(valueColumn.size());
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(&header);
+    out.insert(out.end(), raw, raw + sizeof(header));
+    out.insert(out.end(), timeColumn.begin(), timeColumn.end());
+    out.insert(out.end(), valueColumn.begin(), valueColumn.end());
+}
+
+// Блок в отображенном файле: агрегаты из заголовка и указатели на столбцы
+struct Block {
+    std::time_t firstTime;
+    std::time_t lastTime;
+    double minValue;
+    double maxValue;
+    double sum;
+    uint32_t count;
+    const uint8_t* times;
+    uint32_t timeBytes;
+    const uint8_t* values;
+    uint32_t valueBytes;
+};
+
+// Распаковка блока в массивы по count элементов. false - блок поврежден
+inline bool decodeBlock(const Block& block, std::time_t* times, double* values) {
+    BitReader timeBits(block.times, block.timeBytes);
+    BitReader valueBits(block.values, block.valueBytes);
+
+    std::time_t t = block.firstTime;
+    int64_t delta = 0;
+    uint64_t current = valueBits.read(64);
+    int leading = 0;
+    int trailing = 0;
+    times[0] = t;
+    values[0] = fromBits(current);
+    for (uint32_t i = 1; i < block.count; ++i) {
+        delta += readTimeDelta(timeBits);
+        t += delta;
+        times[i] = t;
+
+        if (valueBits.readBit()) {
+            if (valueBits.readBit()) {
+                leading = static_cast<int>(valueBits.read(5));
+                int meaningful = static_cast<int>(valueBits.read(6)) + 1;
+                trailing = 64 - leading - meaningful;
+                if (trailing < 0) return false;
+            }
+            current ^= valueBits.read(64 - leading - trailing) << trailing;
+        }
+        values[i] = fromBits(current);
+    }
+    return !timeBits.overrun() && !valueBits.overrun() && t == block.lastTime;
+}
+
+// Чтение архива через отображение файла в память. Видит блоки, записанные до open();
+// дописанные позже - после повторного открытия.
+class Reader {
+public:
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        std::fseek(f, 0, SEEK_END);
+        long length = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        copy.resize(length > 0 ? static_cast<size_t>(length) : 0);
+        size_t got = copy.empty() ? 0 : std::fread(copy.data(), 1, copy.size(), f);
+        std::fclose(f);
+        copy.resize(got);
+        data = copy.data();
+        size = copy.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            data = static_cast<const uint8_t*>(p);
+        }
+        ::close(fd);
+#endif
+        FileHeader header;
+        if (size < sizeof(header)) {
+            close();
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION) {
+            close();
+            return false;
+        }
+        validSize = sizeof(FileHeader);
+        buildIndex();
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        copy.clear();
+#else
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+        validSize = 0;
+        index.clear();
+        samples = 0;
+    }
+
+    bool isOpen() const {
+        return data != nullptr;
+    }
+
+    const std::vector<Block>& blocks() const {
+        return index;
+    }
+
+    uint64_t sampleCount() const {
+        return samples;
+    }
+
+    // Длина файла до конца последнего целого блока
+    size_t bytes() const {
+        return validSize;
+    }
+
+    bool empty() const {
+        return index.empty();
+    }
+
+    std::time_t firstTime() const {
+        return index.empty() ? 0 : index.front().firstTime;
+    }
+
+    std::time_t lastTime() const {
+        return index.empty() ? 0 : index.back().lastTime;
+    }
+
+    // Номер первого блока, который может содержать измерения не раньше from
+    size_t firstBlock(std::time_t from) const {
+        return std::lower_bound(index.begin(), index.end(), from,
+                                [](const Block& b, std::time_t t) { return b.lastTime < t; }) -
+               index.begin();
+    }
+
+    // Обход измерений за период [from, to] по возрастанию времени: visit(epoch, value)
+    template <typename Visitor>
+    void scan(std::time_t from, std::time_t to, Visitor&& visit) const {
+        std::time_t times[BLOCK_SAMPLES];
+        double values[BLOCK_SAMPLES];
+        for (size_t b = firstBlock(from); b < index.size() && index[b].firstTime <= to; ++b) {
+            const Block& block = index[b];
+            if (!decodeBlock(block, times, values)) continue;
+            bool inside = block.firstTime >= from && block.lastTime <= to;
+            for (uint32_t i = 0; i < block.count; ++i) {
+                if (inside || (times[i] >= from && times[i] <= to)) visit(times[i], values[i]);
+            }
+        }
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t validSize = 0;
+    std::vector<Block> index;
+    uint64_t samples = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> copy;
+#endif
+
+    // Индекс по заголовкам блоков; разбор останавливается на первом неполном или
+    // поврежденном блоке
+    void buildIndex() {
+        size_t offset = sizeof(FileHeader);
+        while (offset + sizeof(BlockHeader) <= size) {
+            BlockHeader h;
+            std::memcpy(&h, data + offset, sizeof(h));
+            size_t end = offset + sizeof(h) + h.timeBytes + h.valueBytes;
+            if (h.magic != BLOCK_MAGIC || h.count == 0 || h.count > BLOCK_SAMPLES ||
+                h.lastTime < h.firstTime || end > size) {
+                break;
+            }
+            if (!index.empty() && h.firstTime <= index.back().lastTime) break;
+
+            const uint8_t* columns = data + offset + sizeof(h);
+            index.push_back({static_cast<std::time_t>(h.firstTime), static_cast<std::time_t>(h.lastTime),
+                             h.minValue, h.maxValue, h.sum, h.count,
+                             columns, h.timeBytes, columns + h.timeBytes, h.valueBytes});
+            samples += h.count;
+            offset = end;
+        }
+        validSize = offset;
+    }
+};
+
+// Дозапись ряда в архив. Измерения копятся до BLOCK_SAMPLES и пишутся блоком;
+// неполный блок пишется при flush()/sync() и закрытии. Измерения не новее последнего
+// записанного пропускаются, поэтому повторная выгрузка тех же данных безопасна.
+class Writer {
+public:
+    Writer() = default;
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer() {
+        close();
+    }
+
+    // Открытие или создание файла; недописанный хвост отрезается.
+    // Существующий файл другого формата не перезаписывается (false)
+    bool open(const std::string& path) {
+        close();
+        long length = 0;
+        if (FILE* probe = std::fopen(path.c_str(), "rb")) {
+            std::fseek(probe, 0, SEEK_END);
+            length = std::ftell(probe);
+            std::fclose(probe);
+        }
+
+        if (length > 0) {
+            size_t validSize;
+            {
+                Reader existing;
+                if (!existing.open(path)) return false;
+                lastStored = existing.lastTime();
+                hasLast = !existing.empty();
+                validSize = existing.bytes();
+            }
+            file = std::fopen(path.c_str(), "r+b");
+            if (!file) return false;
+#ifdef _WIN32
+            _chsize_s(_fileno(file), static_cast<long long>(validSize));
+#else
+            if (ftruncate(fileno(file), static_cast<off_t>(validSize)) != 0) {
+                close();
+                return false;
+            }
+#endif
+            std::fseek(file, 0, SEEK_END);
+        } else {
+            file = std::fopen(path.c_str(), "w+b");
+            if (!file) return false;
+            FileHeader header{MAGIC, VERSION, 0};
+            if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+                close();
+                return false;
+            }
+            lastStored = 0;
+            hasLast = false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (!file) return;
+        flush();
+        std::fclose(file);
+        file = nullptr;
+        pendingTimes.clear();
+        pendingValues.clear();
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Время последнего принятого измерения (0, если архив пуст)
+    std::time_t lastTime() const {
+        return lastStored;
+    }
+
+    // false - ошибка записи заполненного блока
+    bool append(std::time_t epoch, double value) {
+        if (hasLast && epoch <= lastStored) return true;
+        pendingTimes.push_back(epoch);
+        pendingValues.push_back(value);
+        lastStored = epoch;
+        hasLast = true;
+        return pendingTimes.size() < BLOCK_SAMPLES || flush();
+    }
+
+    // Запись накопленных измерений блоком
+    bool flush() {
+        if (!file) return false;
+        if (pendingTimes.empty()) return true;
+        buffer.clear();
+        encodeBlock(pendingTimes.data(), pendingValues.data(), pendingTimes.size(), buffer);
+        pendingTimes.clear();
+        pendingValues.clear();
+        return std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() &&
+               std::fflush(file) == 0;
+    }
+
+    // flush() и сброс на диск: после возврата данные переживут сбой питания
+    bool sync() {
+        if (!flush()) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+private:
+    FILE* file = nullptr;
+    std::vector<std::time_t> pendingTimes;
+    std::vector<double> pendingValues;
+    std::vector<uint8_t> buffer;
+    std::time_t lastStored = 0;
+    bool hasLast = false;
+};
+
+}  // namespace archive
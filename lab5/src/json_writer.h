@@ -0,0 +1,169 @@
+#pragma once
+// Сериализация JSON ответов API без std::ostringstream.
+//
+// Writer дописывает текст в переданную строку (буфер можно переиспользовать между
+// ответами: clear() сохраняет выделенную память), числа форматируются std::to_chars
+// (не зависит от локали и не выделяет память), время - с кэшем текущих суток, так что
+// localtime вызывается один раз на сутки, а не на каждую строку.
+// Summary считает count/average/min/max в том же проходе, что и вывод строк.
+#include <string>
+#include <charconv>
+#include <ctime>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "storage.h"
+
+namespace json {
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : out(out) {}
+
+    // Готовый фрагмент JSON (разметка, имена полей)
+    void raw(const char* s) {
+        out.append(s);
+    }
+
+    void raw(const char* s, size_t len) {
+        out.append(s, len);
+    }
+
+    void raw(char c) {
+        out.push_back(c);
+    }
+
+    // Строка в кавычках: ", \ и управляющие символы экранируются, остальные байты
+    // (в том числе UTF-8) выводятся как есть
+    void string(const std::string& s) {
+        static const char HEX[] = "0123456789abcdef";
+        out.push_back('"');
+        for (char c : s) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(c);
+            } else if (c == '\n') {
+                out.append("\\n");
+            } else if (c == '\t') {
+                out.append("\\t");
+            } else if (u < 0x20) {
+                char buf[6] = {'\\', 'u', '0', '0', HEX[u >> 4], HEX[u & 0xf]};
+                out.append(buf, sizeof(buf));
+            } else {
+                out.push_back(c);
+            }
+        }
+        out.push_back('"');
+    }
+
+    // Число с фиксированной точностью (как std::fixed << std::setprecision(2)).
+    // NaN и бесконечность в JSON непредставимы и выводятся как null.
+    void number(double value, int precision = 2) {
+        if (!std::isfinite(value)) {
+            out.append("null");
+            return;
+        }
+        char buf[64];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::fixed, precision);
+        out.append(buf, result.ptr - buf);
+    }
+
+    void integer(long long value) {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, result.ptr - buf);
+    }
+
+    // Локальное время YYYY-MM-DDTHH:MM:SS (без кавычек), совпадает с storage::formatTime
+    void time(std::time_t t) {
+        if (t < dayBegin || t >= dayEnd) {
+            cacheDay(t);
+        }
+        if (dayEnd - dayBegin != 86400) {
+            // Сутки перехода на летнее/зимнее время: смещение от полуночи не равно времени суток
+            std::tm tm = storage::toLocalTm(t);
+            char buf[32];
+            size_t len = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+            out.append(buf, len);
+            return;
+        }
+
+        long seconds = static_cast<long>(t - dayBegin);
+        char buf[19];
+        std::memcpy(buf, datePrefix, 11);
+        writeTwoDigits(buf + 11, seconds / 3600);
+        buf[13] = ':';
+        writeTwoDigits(buf + 14, seconds / 60 % 60);
+        buf[16] = ':';
+        writeTwoDigits(buf + 17, seconds % 60);
+        out.append(buf, sizeof(buf));
+    }
+
+private:
+    std::string& out;
+    std::time_t dayBegin = 0;
+    std::time_t dayEnd = 0;
+    char datePrefix[12] = {};  // "YYYY-MM-DDT"
+
+    void cacheDay(std::time_t t) {
+        dayBegin = storage::dayStart(t);
+        dayEnd = storage::nextDayStart(dayBegin);
+        std::tm tm = storage::toLocalTm(dayBegin);
+        std::strftime(datePrefix, sizeof(datePrefix), "%Y-%m-%dT", &tm);
+    }
+
+    static void writeTwoDigits(char* p, long value) {
+        p[0] = static_cast<char>('0' + value / 10);
+        p[1] = static_cast<char>('0' + value % 10);
+    }
+};
+
+// Сводка по выведенным значениям, накапливается в том же проходе
+struct Summary {
+    long count = 0;
+    double sum = 0;
+    double minValue = 0;
+    double maxValue = 0;
+
+    void add(double value) {
+        add(value, value, value, 1);
+    }
+
+    // Агрегат интервала: min/max по интервалу, sum - сумма count значений
+    void add(double lo, double hi, double total, long n) {
+        minValue = count == 0 ? lo : std::min(minValue, lo);
+        maxValue = count == 0 ? hi : std::max(maxValue, hi);
+        sum += total;
+        count += n;
+    }
+
+    // "summary":{...}
+    void write(Writer& w) const {
+        if (count == 0) {
+            w.raw("\"summary\":{\"count\":0}");
+            return;
+        }
+        w.raw("\"summary\":{\"count\":");
+        w.integer(count);
+        w.raw(",\"average\":");
+        w.number(sum / count);
+        w.raw(",\"min\":");
+        w.number(minValue);
+        w.raw(",\"max\":");
+        w.number(maxValue);
+        w.raw('}');
+    }
+};
+
+// {"timestamp":"...","temperature":...}
+inline void writeMeasurement(Writer& w, std::time_t epoch, double temperature) {
+    w.raw("{\"timestamp\":\"");
+    w.time(epoch);
+    w.raw("\",\"temperature\":");
+    w.number(temperature);
+    w.raw('}');
+}
+
+}  // namespace json
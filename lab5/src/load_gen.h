@@ -0,0 +1,413 @@
+#pragma once
+// Режим нагрузки симулятора: поток измерений с заданной частотой для измерения
+// пропускной способности логгера и сервера.
+//
+// Без параметров нагрузки симулятор работает как раньше: одно измерение на датчик раз в 5 с.
+// С --rate N измерения выдаются с частотой N в секунду (суммарно по датчикам, до миллионов
+// в секунду), датчики чередуются по кругу, метки одного круга совпадают. Форма нагрузки
+// (--pattern):
+//  - steady  - равномерно;
+//  - burst   - пачками: все измерения периода (--period, по умолчанию 10 с) выдаются
+//              за первую десятую его часть;
+//  - diurnal - частота меняется по суточному циклу от 0.2N до 1.8N (период по умолчанию
+//              сутки, для испытаний его удобно сжать), температура тоже следует суточному
+//              ходу по меткам времени.
+// Средняя частота во всех формах - N. Метки времени - текущее время, а с --step SEC -
+// виртуальные: круг датчиков номер k получает метку --start + k * SEC (так можно за
+// секунды заполнить базу историей за месяцы).
+//
+// Ограничение: метки текущего времени - целые секунды, и все измерения одной секунды
+// получают одну метку. БД lab5 хранит одно значение на датчик в секунду (первичный ключ
+// (sensor, epoch)), и логгер lab5 при чтении из разделяемой памяти тоже отбрасывает
+// измерения датчика с меткой не новее сохраненной, поэтому без --step в БД попадает не
+// больше одного измерения на датчик в секунду. Чтобы каждое измерение стало строкой,
+// датчиков нужно не меньше пиковой частоты формы (wallClockSensors()): симулятор lab5
+// не меняет --sensors сам, а предупреждает, если датчиков меньше.
+//
+// --seed задает начальное значение генератора: mt19937_64 и преобразование Бокса-Мюллера
+// определены стандартом однозначно, поэтому при одинаковом seed и виртуальном времени
+// вывод совпадает байт в байт на любой платформе (std::normal_distribution этого не
+// гарантирует).
+//
+// --replay FILE повторяет записанный measurements.log ("YYYY-MM-DDTHH:MM:SS t [датчик]")
+// с исходными метками времени, ускоряя паузы между строками в --speed раз (0 - без пауз).
+//
+// Вывод текстовый, через собственный буфер: строки не сбрасываются по одной (std::endl),
+// буфер отдается целиком, когда заполнен или когда генератору нечего выдавать до
+// следующего измерения.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "timestamp.h"
+
+namespace loadgen {
+
+// Интервал обычного режима, секунды
+const int CLASSIC_INTERVAL = 5;
+
+// M_PI есть не во всех стандартных библиотеках (MSVC без _USE_MATH_DEFINES)
+const double PI = 3.14159265358979323846;
+
+enum class Pattern {
+    Steady,
+    Burst,
+    Diurnal
+};
+
+struct Options {
+    double rate = 0;          // измерений в секунду; 0 - обычный режим
+    Pattern pattern = Pattern::Steady;
+    double period = 0;        // период burst/diurnal, секунды (0 - по умолчанию)
+    bool seeded = false;
+    uint64_t seed = 0;
+    long step = 0;            // шаг виртуального времени, секунды; 0 - текущее время
+    std::time_t start = 0;    // метка первого круга при --step (0 - step * count назад от текущего)
+    uint64_t count = 0;       // сколько измерений выдать (0 - без ограничения)
+    double duration = 0;      // сколько секунд работать (0 - без ограничения)
+    std::string replay;       // файл для повтора
+    double speed = 1;         // ускорение повтора, 0 - без пауз
+
+    // Разбор параметра argv[i] (и его значения); false - параметр не из этого набора
+    bool parse(int& i, int argc, char* argv[]) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* value = argv[i + 1];
+        if (arg == "--rate") {
+            rate = std::max(0.0, std::atof(value));
+        } else if (arg == "--pattern") {
+            std::string p = value;
+            if (p == "steady") pattern = Pattern::Steady;
+            else if (p == "burst") pattern = Pattern::Burst;
+            else if (p == "diurnal") pattern = Pattern::Diurnal;
+            else return false;
+        } else if (arg == "--period") {
+            period = std::max(0.0, std::atof(value));
+        } else if (arg == "--seed") {
+            seeded = true;
+            seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--step") {
+            step = std::max(0L, std::atol(value));
+        } else if (arg == "--start") {
+            timestamp::Parser parser;
+            if (!parser.parse(value, std::strlen(value), start)) {
+                start = static_cast<std::time_t>(std::atoll(value));
+            }
+        } else if (arg == "--count") {
+            count = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--duration") {
+            duration = std::max(0.0, std::atof(value));
+        } else if (arg == "--replay") {
+            replay = value;
+        } else if (arg == "--speed") {
+            speed = std::max(0.0, std::atof(value));
+        } else {
+            return false;
+        }
+        i++;
+        return true;
+    }
+
+    static const char* usage() {
+        return " [--rate N] [--pattern steady|burst|diurnal] [--period SEC] [--seed N]"
+               " [--step SEC] [--start TIME] [--count N] [--duration SEC]"
+               " [--replay FILE] [--speed N]";
+    }
+
+    // Наибольшая мгновенная частота формы нагрузки
+    double peakRate() const {
+        switch (pattern) {
+            case Pattern::Steady: return rate;
+            case Pattern::Burst: return rate * 10.0;
+            case Pattern::Diurnal: return rate * 1.8;
+        }
+        return rate;
+    }
+
+    // Сколько датчиков нужно, чтобы при метках текущего времени каждый датчик получал не
+    // больше одного измерения в секунду (0 - ограничения нет: обычный режим или --step)
+    int wallClockSensors() const {
+        if (rate <= 0 || step > 0 || !replay.empty()) return 0;
+        return static_cast<int>(std::min(std::ceil(peakRate()), 1e9));
+    }
+
+    double patternPeriod() const {
+        if (period > 0) return period;
+        return pattern == Pattern::Burst ? 10.0 : 86400.0;
+    }
+
+    // Сколько измерений должно быть выдано к моменту t секунд от начала
+    double expected(double t) const {
+        double p = patternPeriod();
+        switch (pattern) {
+            case Pattern::Steady:
+                return rate * t;
+            case Pattern::Burst: {
+                double phase = std::fmod(t, p);
+                return rate * p * (std::floor(t / p) + std::min(1.0, phase / (0.1 * p)));
+            }
+            case Pattern::Diurnal:
+                // Интеграл rate * (1 - 0.8 cos(2 pi t / p))
+                return rate * (t - 0.8 * p / (2 * PI) * std::sin(2 * PI * t / p));
+        }
+        return rate * t;
+    }
+};
+
+// Воспроизводимый генератор: результат зависит только от seed
+class Random {
+public:
+    explicit Random(uint64_t seed) : engine(seed) {}
+
+    // Равномерно в (0, 1)
+    double uniform() {
+        return (static_cast<double>(engine() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    // Нормальное распределение (Бокс-Мюллер, второе значение пары сохраняется)
+    double normal(double mean, double stddev) {
+        if (hasSpare) {
+            hasSpare = false;
+            return mean + stddev * spare;
+        }
+        double r = std::sqrt(-2.0 * std::log(uniform()));
+        double a = 2.0 * PI * uniform();
+        spare = r * std::sin(a);
+        hasSpare = true;
+        return mean + stddev * r * std::cos(a);
+    }
+
+private:
+    std::mt19937_64 engine;
+    double spare = 0;
+    bool hasSpare = false;
+};
+
+// Буферизованный текстовый вывод строк "YYYY-MM-DDTHH:MM:SS t[ датчик]\n".
+// Метка форматируется один раз на секунду, температура - целочисленно с двумя знаками
+class TextOutput {
+public:
+    explicit TextOutput(bool withSensor, size_t capacity = 1 << 16)
+        : withSensor(withSensor), capacity(capacity) {
+        buffer.reserve(capacity + 64);
+    }
+
+    ~TextOutput() {
+        flush();
+    }
+
+    void append(std::time_t epoch, double value, int sensor) {
+        if (epoch != cachedEpoch) {
+            std::tm tm{};
+#ifdef _WIN32
+            localtime_s(&tm, &epoch);
+#else
+            localtime_r(&epoch, &tm);
+#endif
+            std::strftime(cachedTime, sizeof(cachedTime), "%Y-%m-%dT%H:%M:%S", &tm);
+            cachedEpoch = epoch;
+        }
+        buffer.append(cachedTime, 19);
+        buffer.push_back(' ');
+
+        long long cents = std::llround(value * 100.0);
+        if (cents < 0) {
+            buffer.push_back('-');
+            cents = -cents;
+        }
+        appendInteger(cents / 100);
+        buffer.push_back('.');
+        buffer.push_back(static_cast<char>('0' + cents / 10 % 10));
+        buffer.push_back(static_cast<char>('0' + cents % 10));
+        if (withSensor) {
+            buffer.push_back(' ');
+            if (sensor < 0) {
+                buffer.push_back('-');
+                sensor = -sensor;
+            }
+            appendInteger(sensor);
+        }
+        buffer.push_back('\n');
+
+        if (buffer.size() >= capacity) flush();
+    }
+
+    // false - вывод закрыт (потребитель завершился)
+    bool flush() {
+        if (!buffer.empty()) {
+            ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), stdout) == buffer.size();
+            buffer.clear();
+        }
+        ok = ok && std::fflush(stdout) == 0;
+        return ok;
+    }
+
+    bool good() const {
+        return ok;
+    }
+
+private:
+    bool withSensor;
+    size_t capacity;
+    std::string buffer;
+    std::time_t cachedEpoch = -1;
+    char cachedTime[32] = {};
+    bool ok = true;
+
+    void appendInteger(long long v) {
+        char digits[24];
+        int n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+        while (n > 0) buffer.push_back(digits[--n]);
+    }
+};
+
+// Температура датчика в момент epoch
+inline double sampleValue(const Options& options, Random& random, std::time_t epoch) {
+    if (options.pattern != Pattern::Diurnal) {
+        return random.normal(22.0, 2.0);
+    }
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &epoch);
+#else
+    localtime_r(&epoch, &tm);
+#endif
+    // Минимум в 03:00, максимум в 15:00
+    double hours = tm.tm_hour + tm.tm_min / 60.0;
+    return 22.0 - 3.0 * std::cos(2 * PI * (hours - 3.0) / 24.0) + random.normal(0.0, 0.5);
+}
+
+// Генерация: emit(epoch, value, sensor) на каждое измерение, flush() перед каждой паузой;
+// flush() возвращает false, если продолжать некуда. Возвращает число выданных измерений.
+template <typename Emit, typename Flush>
+uint64_t generate(const Options& options, int sensors, Emit emit, Flush flush) {
+    Random random(options.seeded ? options.seed : std::random_device{}());
+    sensors = std::max(1, sensors);
+
+    using Clock = std::chrono::steady_clock;
+    auto begin = Clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(Clock::now() - begin).count(); };
+
+    std::time_t virtualStart = options.start;
+    if (options.step > 0 && virtualStart == 0) {
+        // История, заканчивающаяся сейчас
+        uint64_t rounds = options.count > 0 ? options.count / sensors : 0;
+        virtualStart = std::time(nullptr) - static_cast<std::time_t>(rounds) * options.step;
+    }
+
+    uint64_t emitted = 0;
+    uint64_t round = 0;
+    int sensor = 0;
+    std::time_t now = std::time(nullptr);
+
+    auto next = [&] {
+        std::time_t epoch = options.step > 0 ? virtualStart + static_cast<std::time_t>(round) * options.step : now;
+        emit(epoch, sampleValue(options, random, epoch), sensor);
+        emitted++;
+        if (++sensor == sensors) {
+            sensor = 0;
+            round++;
+        }
+    };
+
+    if (options.rate <= 0) {
+        // Обычный режим: круг датчиков раз в CLASSIC_INTERVAL секунд
+        while (true) {
+            now = std::time(nullptr);
+            for (int i = 0; i < sensors; ++i) next();
+            if (!flush()) break;
+            if ((options.count > 0 && emitted >= options.count) ||
+                (options.duration > 0 && elapsed() + CLASSIC_INTERVAL > options.duration)) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::seconds(CLASSIC_INTERVAL));
+        }
+        return emitted;
+    }
+
+    // Пауза, когда выдавать нечего: примерно полинтервала между измерениями, от 1 до 100 мс
+    auto idle = std::chrono::duration<double>(std::min(0.1, std::max(0.001, 0.5 / options.rate)));
+    const uint64_t BATCH = 4096;  // измерений между проверками времени
+    while (true) {
+        double t = elapsed();
+        if (options.duration > 0 && t >= options.duration) break;
+        uint64_t due = static_cast<uint64_t>(options.expected(t));
+        if (options.count > 0) due = std::min(due, options.count);
+        if (due <= emitted) {
+            if (options.count > 0 && emitted >= options.count) break;
+            if (!flush()) return emitted;
+            std::this_thread::sleep_for(idle);
+            continue;
+        }
+        now = std::time(nullptr);
+        uint64_t end = std::min(due, emitted + BATCH);
+        while (emitted < end) next();
+    }
+    flush();
+    return emitted;
+}
+
+// Повтор журнала: строки "YYYY-MM-DDTHH:MM:SS t [датчик]" с исходными метками, паузы
+// между ними сокращаются в options.speed раз. Возвращает число выданных измерений
+// или -1, если файл не открылся.
+template <typename Emit, typename Flush>
+long long replay(const Options& options, Emit emit, Flush flush) {
+    std::ifstream in(options.replay);
+    if (!in.is_open()) return -1;
+
+    using Clock = std::chrono::steady_clock;
+    auto begin = Clock::now();
+    timestamp::Parser parser;
+    std::string line;
+    std::time_t first = 0;
+    bool started = false;
+    long long emitted = 0;
+    while (std::getline(in, line)) {
+        std::time_t epoch;
+        if (!parser.parse(line.data(), line.size(), epoch)) continue;
+        const char* begin19 = line.c_str() + 19;
+        char* end;
+        double value = std::strtod(begin19, &end);
+        if (end == begin19) continue;
+        long sensor = std::strtol(end, &end, 10);
+
+        if (!started) {
+            first = epoch;
+            started = true;
+        }
+        if (options.speed > 0) {
+            auto due = begin + std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>((epoch - first) / options.speed));
+            if (due > Clock::now()) {
+                if (!flush()) break;
+                std::this_thread::sleep_until(due);
+            }
+        }
+        emit(epoch, value, static_cast<int>(sensor));
+        emitted++;
+
+        if ((options.count > 0 && static_cast<uint64_t>(emitted) >= options.count) ||
+            (options.duration > 0 &&
+             std::chrono::duration<double>(Clock::now() - begin).count() >= options.duration)) {
+            break;
+        }
+    }
+    flush();
+    return emitted;
+}
+
+}  // namespace loadgen
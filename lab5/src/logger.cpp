@@ -1,40 +1,68 @@
 #include <iostream>
 #include <sqlite3.h>
-#include <sstream>
-#include <deque>
 #include <vector>
 #include <chrono>
-#include <iomanip>
 #include <ctime>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+#include <memory>
+#include <cstdlib>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
 
-using Clock = std::chrono::system_clock;
+#include "storage.h"
+#include "sample_ring.h"
+#include "timestamp.h"
+#include "aggregates.h"
+#include "archive.h"
 
-struct Measurement {
-    Clock::time_point time;
-    double value;
-};
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
+using Clock = std::chrono::system_clock;
+
+// Транзакции записи всех соединений процесса (обработчиков и очистки) идут по очереди
+// под этим мьютексом: SQLite допускает одного писателя, а ожидание на мьютексе дешевле
+// опроса блокировки файла через busy handler
 std::mutex db_mutex;
 
-Clock::time_point parseTime(const std::string& s) {
-    std::tm tm{};
-    std::istringstream ss(s);
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return Clock::from_time_t(std::mktime(&tm));
+// Остановка чтения из разделяемой памяти по SIGINT/SIGTERM (у stdin есть EOF)
+std::atomic<bool> running{true};
+
+void handleStopSignal(int) {
+    running = false;
 }
 
-std::string timeToIso(const Clock::time_point& tp) {
-    std::time_t t = Clock::to_time_t(tp);
-    std::tm tm{};
-#ifdef _WIN32
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
-    return std::string(buf);
+// Измерение одного датчика; tm - локальное время epoch (для границ окон агрегации)
+struct Sample {
+    int sensor;
+    std::time_t epoch;
+    double value;
+    std::tm tm;
+};
+
+// Строка симулятора "YYYY-MM-DDTHH:MM:SS temperature [sensor]"; строки без номера
+// датчика (прежний формат) относятся к датчику по умолчанию
+bool parseLine(timestamp::Parser& parser, const std::string& line, Sample& sample) {
+    if (!parser.parse(line.data(), line.size(), sample.epoch, &sample.tm)) return false;
+    const char* begin = line.c_str() + 19;
+    char* end;
+    sample.value = std::strtod(begin, &end);
+    if (end == begin) return false;
+    char* sensorEnd;
+    long sensor = std::strtol(end, &sensorEnd, 10);
+    sample.sensor = sensorEnd != end ? static_cast<int>(sensor) : storage::DEFAULT_SENSOR;
+    return true;
 }
 
 std::tm toTM(const Clock::time_point& tp) {
@@ -48,202 +76,672 @@ std::tm toTM(const Clock::time_point& tp) {
     return tm;
 }
 
-void initDatabase(sqlite3* db) {
-    const char* sql = R"(
-        CREATE TABLE IF NOT EXISTS measurements (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp TEXT UNIQUE,
-            temperature REAL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-        );
-        
-        CREATE TABLE IF NOT EXISTS hourly_avg (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            date_hour TEXT UNIQUE,
-            average REAL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-        );
-        
-        CREATE TABLE IF NOT EXISTS daily_avg (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            date TEXT UNIQUE,
-            average REAL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-        );
-    )";
-    
-    char* errMsg = nullptr;
-    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
-    
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-    }
-}
-
-bool addMeasurement(sqlite3* db, const std::string& timestamp, double temperature) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string sql = "INSERT OR REPLACE INTO measurements (timestamp, temperature) VALUES (?, ?)";
+// Выгрузка секции в архив (archive.h): измерения каждого датчика дописываются в его файл
+// в каталоге dir. Секция читается без db_mutex (WAL: чтение не мешает записи).
+// true - все измерения записаны и сброшены на диск, секцию можно удалять.
+bool archivePartition(sqlite3* db, const storage::Partition& p, const std::string& dir) {
     sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
+    // Порядок первичного ключа: датчик за датчиком, внутри датчика по времени
+    std::string sql = "SELECT sensor, epoch, temperature FROM " + p.name + " ORDER BY sensor, epoch";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Archive: cannot read " << p.name << ": " << sqlite3_errmsg(db) << std::endl;
         return false;
     }
-    
-    sqlite3_bind_text(stmt, 1, timestamp.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 2, temperature);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
-}
 
-bool addHourlyAverage(sqlite3* db, const std::string& dateHour, double average) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string sql = "INSERT OR REPLACE INTO hourly_avg (date_hour, average) VALUES (?, ?)";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
-    
-    sqlite3_bind_text(stmt, 1, dateHour.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 2, average);
-    
-    rc = sqlite3_step(stmt);
+    archive::Writer writer;
+    int sensor = 0;
+    bool ok = true;
+    int rc;
+    while (ok && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int rowSensor = sqlite3_column_int(stmt, 0);
+        if (!writer.isOpen() || rowSensor != sensor) {
+            ok = !writer.isOpen() || writer.sync();
+            sensor = rowSensor;
+            std::string path = archive::seriesPath(dir, sensor);
+            if (ok && !writer.open(path)) {
+                std::cerr << "Archive: cannot open " << path << std::endl;
+                ok = false;
+            }
+        }
+        ok = ok && writer.append(sqlite3_column_int64(stmt, 1), sqlite3_column_double(stmt, 2));
+    }
+    if (ok && rc != SQLITE_DONE) {
+        std::cerr << "Archive: failed to read " << p.name << ": " << sqlite3_errmsg(db) << std::endl;
+        ok = false;
+    }
     sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
+    return ok && (!writer.isOpen() || writer.sync());
 }
 
-bool addDailyAverage(sqlite3* db, const std::string& date, double average) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string sql = "INSERT OR REPLACE INTO daily_avg (date, average) VALUES (?, ?)";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) return false;
-    
-    sqlite3_bind_text(stmt, 1, date.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 2, average);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
-}
+// Очистка старых измерений по расписанию: раз в interval удаляет секции, целиком
+// лежащие раньше now - maxAge. Каждая секция удаляется отдельной короткой транзакцией
+// (DROP TABLE), стоимость не зависит от числа строк в ней. С archiveDir секция перед
+// удалением выгружается в архив; если выгрузка не удалась, секция остается до следующего прохода.
+class RetentionTask {
+public:
+    RetentionTask(sqlite3* db, std::chrono::hours maxAge, std::chrono::seconds interval,
+                  const std::string& archiveDir)
+        : db(db), maxAge(maxAge), interval(interval), archiveDir(archiveDir) {
+        worker = std::thread(&RetentionTask::loop, this);
+    }
 
-void cleanupOldMeasurements(sqlite3* db, const Clock::time_point& cutoffTime) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string iso = timeToIso(cutoffTime);
-    std::string sql = "DELETE FROM measurements WHERE timestamp < ?";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, iso.c_str(), -1, SQLITE_STATIC);
-        sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+    ~RetentionTask() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        worker.join();
     }
-}
 
-int main() {
-    // Инициализация БД
+    // Один проход очистки, возвращает число удаленных строк
+    long runOnce() {
+        std::time_t cutoff = Clock::to_time_t(Clock::now() - maxAge);
+        std::vector<storage::Partition> expired;
+        {
+            std::lock_guard<std::mutex> lock(db_mutex);
+            expired = storage::expiredPartitions(db, cutoff);
+        }
+
+        long removed = 0;
+        for (const auto& p : expired) {
+            if (isStopping()) break;
+
+            if (!archiveDir.empty() && !archivePartition(db, p, archiveDir)) {
+                std::cerr << "Retention: keeping " << p.name << " (archiving failed)" << std::endl;
+                continue;
+            }
+
+            long rows;
+            {
+                std::lock_guard<std::mutex> lock(db_mutex);
+                rows = storage::dropPartition(db, p);
+            }
+            if (rows < 0) {
+                std::cerr << "Retention: failed to drop " << p.name << std::endl;
+                continue;
+            }
+            std::cerr << "Retention: dropped " << p.name << " (" << rows << " measurements)" << std::endl;
+            removed += rows;
+        }
+
+        // Минутная статистика за месяц - около 43 тыс. строк, старые строки удаляются
+        {
+            std::lock_guard<std::mutex> lock(db_mutex);
+            storage::exec(db, "DELETE FROM minute_avg WHERE minute_epoch < " + std::to_string(cutoff));
+        }
+
+        std::cerr << "Retention: removed " << removed << " measurements in " << expired.size()
+                  << " partitions older than " << storage::formatTime(cutoff) << std::endl;
+        return removed;
+    }
+
+private:
     sqlite3* db;
-    int rc = sqlite3_open("measurements.db", &db);
-    
-    if (rc) {
-        std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
-        return 1;
+    std::chrono::hours maxAge;
+    std::chrono::seconds interval;
+    std::string archiveDir;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread worker;
+
+    bool isStopping() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stopping;
     }
-    
-    initDatabase(db);
-    std::cerr << "Logger started, database initialized" << std::endl;
-    
-    std::deque<Measurement> measurements;
-    std::vector<Measurement> hourBuffer;
-    std::vector<Measurement> dayBuffer;
 
-    int currentHour = -1;
-    int currentDay  = -1;
-    int currentYear = -1;
+    void loop() {
+        while (true) {
+            runOnce();
+            std::unique_lock<std::mutex> lock(mutex);
+            if (cv.wait_for(lock, interval, [this] { return stopping; })) {
+                return;
+            }
+        }
+    }
+};
 
-    std::string line;
+// Пакетная запись измерений: накапливает до batchSize измерений или до flushInterval
+// с момента первого неподтвержденного и записывает их одной транзакцией
+// через постоянные подготовленные запросы (один fsync на пакет, а не на измерение).
+// Измерение попадает в секцию своих суток, секция создается при первой записи.
+// Статистика окон, закрытых измерениями пакета, пишется в той же транзакции.
+class BatchWriter {
+public:
+    BatchWriter(sqlite3* db, size_t batchSize, std::chrono::milliseconds flushInterval)
+        : db(db), batchSize(batchSize), flushInterval(flushInterval) {
+        pending.reserve(batchSize);
+        flusher = std::thread(&BatchWriter::flusherLoop, this);
+    }
 
-    while (std::getline(std::cin, line)) {
-        std::istringstream ss(line);
-        std::string ts;
-        double temp;
+    ~BatchWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        flusher.join();
 
-        ss >> ts >> temp;
-        auto tp = parseTime(ts);
-        auto tm = toTM(tp);
+        // Остаток пакета: при ошибке несколько повторов, затем измерения теряются
+        std::unique_lock<std::mutex> lock(mutex);
+        for (int attempt = 1; !flushLocked(lock) && attempt < SHUTDOWN_ATTEMPTS; ++attempt) {
+            std::this_thread::sleep_for(retryDelay);
+        }
+        if (!pending.empty()) {
+            std::cerr << "Dropped " << pending.size() << " unsaved measurements" << std::endl;
+        }
+        std::lock_guard<std::mutex> dbLock(db_mutex);
+        clearStatements();
+        for (auto* stmt : windowInserts) {
+            if (stmt) sqlite3_finalize(stmt);
+        }
+    }
 
-        if (currentHour == -1) {
-            currentHour = tm.tm_hour;
-            currentDay  = tm.tm_mday;
-            currentYear = tm.tm_year;
+    // Измерение и окна, которые оно закрыло
+    void add(const Sample& sample, const std::vector<aggregate::Aggregator::Closed>& closed) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending.empty() && pendingWindows.empty()) {
+            firstPending = std::chrono::steady_clock::now();
+            cv.notify_one();  // запускаем отсчет срока сброса
+        }
+        for (const auto& w : closed) {
+            pendingWindows.push_back({sample.sensor, w});
+        }
+        pending.push_back({sample.sensor, sample.epoch, sample.value});
+        // После ошибки записи повтор делает поток сброса по retryAt
+        if (pending.size() >= batchSize && retryDelay.count() == 0) {
+            flushLocked(lock);
         }
+    }
+
+private:
+    struct Row {
+        int sensor;
+        std::time_t epoch;
+        double temperature;
+    };
+
+    struct WindowRow {
+        int sensor;
+        aggregate::Aggregator::Closed window;
+    };
 
-        // Добавляем в БД
-        addMeasurement(db, ts, temp);
-        measurements.push_back({tp, temp});
+    // Подготовленный INSERT для секции
+    struct PartitionWriter {
+        storage::Partition partition;
+        sqlite3_stmt* insert;
+    };
 
-        // Очистка измерений старше 24 часов
-        auto now = Clock::now();
-        while (!measurements.empty() &&
-               now - measurements.front().time > std::chrono::hours(24)) {
-            measurements.pop_front();
+    // Пауза между повторами неудавшейся записи растет до MAX_RETRY_DELAY
+    static constexpr std::chrono::milliseconds MAX_RETRY_DELAY{5000};
+    static const int SHUTDOWN_ATTEMPTS = 5;
+
+    sqlite3* db;
+    size_t batchSize;
+    std::chrono::milliseconds flushInterval;
+
+    // Под db_mutex: запросы используются только внутри транзакции записи
+    std::map<std::time_t, PartitionWriter> writers;  // по началу суток
+    sqlite3_stmt* windowInserts[4] = {};             // по aggregate::Window
+
+    std::mutex mutex;  // pending, pendingWindows, stopping, retryDelay, retryAt
+    std::vector<Row> pending;
+    std::vector<WindowRow> pendingWindows;
+    std::chrono::steady_clock::time_point firstPending;
+    std::chrono::milliseconds retryDelay{0};  // 0 - последняя запись прошла
+    std::chrono::steady_clock::time_point retryAt;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread flusher;
+
+    // Сброс пакета по сроку, даже если новых измерений нет
+    void flusherLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (pending.empty() && pendingWindows.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+            auto deadline = std::max(firstPending + flushInterval, retryAt);
+            if (std::chrono::steady_clock::now() >= deadline) {
+                flushLocked(lock);
+            } else {
+                cv.wait_until(lock, deadline);
+            }
         }
-        
-        // Очистка БД от данных старше месяца
-        auto cutoff = now - std::chrono::hours(24 * 30);
-        cleanupOldMeasurements(db, cutoff);
+    }
 
-        // При смене часа сохраняем среднее за прошлый час
-        if (tm.tm_hour != currentHour) {
-            if (!hourBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : hourBuffer) sum += m.value;
-                double avg = sum / hourBuffer.size();
+    void clearStatements() {
+        for (auto& entry : writers) {
+            sqlite3_finalize(entry.second.insert);
+        }
+        writers.clear();
+    }
 
-                std::tm oldTm = toTM(hourBuffer.front().time);
-                char dateHourBuf[32];
-                std::strftime(dateHourBuf, sizeof(dateHourBuf), "%Y-%m-%d %H", &oldTm);
-                
-                addHourlyAverage(db, std::string(dateHourBuf), avg);
+    // INSERT для секции, содержащей epoch (вызывается внутри транзакции)
+    sqlite3_stmt* insertFor(std::time_t epoch) {
+        if (!writers.empty()) {
+            auto it = writers.upper_bound(epoch);
+            if (it != writers.begin()) {
+                --it;
+                if (epoch < it->second.partition.end) return it->second.insert;
             }
+        }
+
+        // Ограничиваем кэш: старые секции могли быть удалены очисткой
+        if (writers.size() >= 8) clearStatements();
 
-            hourBuffer.clear();
-            currentHour = tm.tm_hour;
+        storage::Partition p;
+        if (!storage::ensurePartition(db, epoch, p)) return nullptr;
+        std::string sql = "INSERT OR REPLACE INTO " + p.name + " (sensor, epoch, temperature) VALUES (?, ?, ?)";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Failed to prepare insert: " << sqlite3_errmsg(db) << std::endl;
+            return nullptr;
         }
-        hourBuffer.push_back({tp, temp});
+        writers[p.start] = PartitionWriter{p, stmt};
+        return stmt;
+    }
+
+    // INSERT в таблицу статистики окна (storage::AGGREGATE_TABLES в порядке aggregate::Window)
+    sqlite3_stmt* insertFor(aggregate::Window window) {
+        sqlite3_stmt*& stmt = windowInserts[static_cast<int>(window)];
+        if (stmt) return stmt;
+
+        const storage::AggregateTable& t = storage::AGGREGATE_TABLES[static_cast<int>(window)];
+        std::string sql = std::string("INSERT OR REPLACE INTO ") + t.table + " (sensor, " + t.column +
+                          ", average, min, max, count, variance) VALUES (?, ?, ?, ?, ?, ?, ?)";
+        if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Failed to prepare insert: " << sqlite3_errmsg(db) << std::endl;
+            stmt = nullptr;
+        }
+        return stmt;
+    }
+
+    // Забирает пакет и записывает его без удержания mutex: add() не ждет записи на диск.
+    // Если транзакция не прошла (БД занята дольше busy timeout, нет места), пакет
+    // возвращается в начало очереди и повторяется через retryDelay, а не теряется.
+    bool flushLocked(std::unique_lock<std::mutex>& lock) {
+        if (pending.empty() && pendingWindows.empty()) return true;
+
+        std::vector<Row> rows;
+        std::vector<WindowRow> windows;
+        rows.swap(pending);
+        windows.swap(pendingWindows);
+        pending.reserve(batchSize);
 
-        // При смене дня сохраняем среднее за прошлый день
-        if (tm.tm_mday != currentDay) {
-            if (!dayBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : dayBuffer) sum += m.value;
-                double avg = sum / dayBuffer.size();
+        lock.unlock();
+        bool ok = write(rows, windows);
+        lock.lock();
 
-                std::tm oldTm = toTM(dayBuffer.front().time);
-                char dateBuf[32];
-                std::strftime(dateBuf, sizeof(dateBuf), "%Y-%m-%d", &oldTm);
-                
-                addDailyAverage(db, std::string(dateBuf), avg);
+        if (ok) {
+            retryDelay = std::chrono::milliseconds(0);
+            return true;
+        }
+        // Новые измерения, пришедшие во время записи, идут после возвращенных
+        rows.insert(rows.end(), pending.begin(), pending.end());
+        windows.insert(windows.end(), pendingWindows.begin(), pendingWindows.end());
+        pending.swap(rows);
+        pendingWindows.swap(windows);
+        retryDelay = std::min(MAX_RETRY_DELAY, std::max(flushInterval, retryDelay * 2));
+        retryAt = std::chrono::steady_clock::now() + retryDelay;
+        std::cerr << "Batch of " << pending.size() << " measurements kept, retrying in "
+                  << retryDelay.count() << " ms" << std::endl;
+        return false;
+    }
+
+    // Пакет целиком в одной транзакции; при любой ошибке транзакция откатывается
+    bool write(const std::vector<Row>& rows, const std::vector<WindowRow>& windows) {
+        std::lock_guard<std::mutex> dbLock(db_mutex);
+
+        // IMMEDIATE: блокировка записи берется сразу (другие процессы ждут busy timeout).
+        // Без транзакции вставки шли бы по одной в autocommit, поэтому при ошибке пакет не пишется
+        if (sqlite3_exec(db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "Cannot begin transaction: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+
+        bool ok = true;
+        for (const auto& m : rows) {
+            sqlite3_stmt* insertStmt = insertFor(m.epoch);
+            if (!insertStmt) {
+                ok = false;
+                break;
+            }
+            sqlite3_bind_int(insertStmt, 1, m.sensor);
+            sqlite3_bind_int64(insertStmt, 2, m.epoch);
+            sqlite3_bind_double(insertStmt, 3, m.temperature);
+            if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+                std::cerr << "Insert failed: " << sqlite3_errmsg(db) << std::endl;
+                ok = false;
             }
+            sqlite3_reset(insertStmt);
+            if (!ok) break;
+        }
 
-            dayBuffer.clear();
-            currentDay = tm.tm_mday;
+        for (size_t i = 0; ok && i < windows.size(); ++i) {
+            const auto& w = windows[i];
+            sqlite3_stmt* stmt = insertFor(w.window.window);
+            if (!stmt) {
+                ok = false;
+                break;
+            }
+            const aggregate::Stats& stats = w.window.stats;
+            sqlite3_bind_int(stmt, 1, w.sensor);
+            sqlite3_bind_int64(stmt, 2, w.window.start);
+            sqlite3_bind_double(stmt, 3, stats.average());
+            sqlite3_bind_double(stmt, 4, stats.minValue);
+            sqlite3_bind_double(stmt, 5, stats.maxValue);
+            sqlite3_bind_int64(stmt, 6, stats.count);
+            sqlite3_bind_double(stmt, 7, stats.variance());
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                std::cerr << "Failed to save aggregates: " << sqlite3_errmsg(db) << std::endl;
+                ok = false;
+            }
+            sqlite3_reset(stmt);
+        }
+
+        if (ok && sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            std::cerr << "Commit failed: " << sqlite3_errmsg(db) << std::endl;
+            ok = false;
+        }
+        if (!ok) {
+            // Транзакцию могла уже откатить сама SQLite (например, при SQLITE_FULL)
+            if (!sqlite3_get_autocommit(db)) {
+                sqlite3_exec(db, "ROLLBACK", nullptr, nullptr, nullptr);
+            }
+            // Секции, созданные в откаченной транзакции, не существуют: сбрасываем кэш запросов
+            clearStatements();
+        }
+        return ok;
+    }
+};
+
+// Обработчик группы датчиков: свое соединение с БД, своя пакетная запись и состояние
+// агрегатов своих датчиков. Датчик всегда попадает в один и тот же обработчик
+// (shardOf), поэтому измерения датчика обрабатываются по порядку и без блокировок
+// между обработчиками; общая у них только очередь транзакций (db_mutex).
+class IngestWorker {
+public:
+    // Предел очереди: читатель ввода ждет, если обработчик отстал
+    static const size_t MAX_QUEUED = 65536;
+
+    IngestWorker(sqlite3* db, const std::vector<aggregate::Window>& windows, size_t batchSize,
+                 std::chrono::milliseconds flushInterval)
+        : db(db), windows(windows), writer(std::make_unique<BatchWriter>(db, batchSize, flushInterval)) {
+        worker = std::thread(&IngestWorker::loop, this);
+    }
+
+    // Дорабатывает очередь и записывает остаток пакета
+    ~IngestWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join();
+        writer.reset();
+        sqlite3_close(db);
+    }
+
+    // Передает измерения обработчику (batch очищается)
+    void post(std::vector<Sample>& batch) {
+        if (batch.empty()) return;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] { return queue.size() < MAX_QUEUED; });
+            if (queue.empty()) {
+                queue.swap(batch);
+            } else {
+                queue.insert(queue.end(), batch.begin(), batch.end());
+            }
+        }
+        batch.clear();
+        ready.notify_one();
+    }
+
+private:
+    sqlite3* db;
+    std::vector<aggregate::Window> windows;
+    std::unique_ptr<BatchWriter> writer;
+    std::unordered_map<int, aggregate::Aggregator> aggregators;  // по датчику
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable notFull;
+    std::vector<Sample> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void loop() {
+        std::vector<Sample> batch;
+        std::vector<aggregate::Aggregator::Closed> closed;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;  // остановка, очередь разобрана
+                batch.swap(queue);
+            }
+            notFull.notify_one();
+
+            for (const auto& sample : batch) {
+                auto it = aggregators.find(sample.sensor);
+                if (it == aggregators.end()) {
+                    it = aggregators.emplace(sample.sensor, aggregate::Aggregator(windows)).first;
+                }
+                // При смене окна (минуты, часа, суток, недели) его статистика
+                // уходит в БД вместе с измерением
+                it->second.add(sample.tm, sample.value, closed);
+                writer->add(sample, closed);
+                closed.clear();
+            }
+            batch.clear();
         }
-        dayBuffer.push_back({tp, temp});
+    }
+};
+
+// Обработчик датчика: хэш номера, чтобы и несмежные номера распределялись равномерно
+size_t shardOf(int sensor, size_t workers) {
+    uint64_t h = static_cast<uint32_t>(sensor) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((h >> 32) % workers);
+}
+
+// Соединение для записи (nullptr при ошибке)
+sqlite3* openDatabase(const std::string& path) {
+    sqlite3* db;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    return db;
+}
+
+// Сколько измерений читатель ввода накапливает для обработчика, прежде чем передать
+const size_t DISPATCH_BATCH = 256;
+
+int main(int argc, char* argv[]) {
+    std::string dbPath = "measurements.db";
+    size_t batchSize = 100;
+    long flushMs = 1000;
+    long retentionIntervalSec = 3600;
+    std::string shmName;
+    std::string archiveDir;
+    std::vector<aggregate::Window> windows = {aggregate::Window::Hour, aggregate::Window::Day};
+    int workerCount = static_cast<int>(std::max(1u, std::min(4u, std::thread::hardware_concurrency())));
+
+    // Разбор аргументов командной строки
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--db" && i + 1 < argc) {
+            dbPath = argv[++i];
+        } else if (arg == "--batch-size" && i + 1 < argc) {
+            batchSize = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "--flush-ms" && i + 1 < argc) {
+            flushMs = std::max(0L, std::atol(argv[++i]));
+        } else if (arg == "--retention-interval" && i + 1 < argc) {
+            retentionIntervalSec = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "--shm" && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (arg == "--windows" && i + 1 < argc && aggregate::parseWindows(argv[i + 1], windows)) {
+            ++i;
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workerCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--archive" && i + 1 < argc) {
+            archiveDir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--db PATH] [--batch-size N] [--flush-ms MS]"
+                         " [--retention-interval SEC] [--shm NAME]"
+                         " [--windows minute,hour,day,week] [--workers N] [--archive DIR]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Каталог архива секций, удаляемых очисткой
+    if (!archiveDir.empty()) {
+#ifdef _WIN32
+        int rc = _mkdir(archiveDir.c_str());
+#else
+        int rc = mkdir(archiveDir.c_str(), 0755);
+#endif
+        if (rc != 0 && errno != EEXIST) {
+            std::cerr << "Cannot create archive directory " << archiveDir << ": "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+
+    // Инициализация БД
+    sqlite3* db = openDatabase(dbPath);
+    if (!db) {
+        return 1;
     }
     
+    if (!storage::initSchema(db)) {
+        std::cerr << "Cannot initialize database schema" << std::endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // Обработчики датчиков, у каждого свое соединение
+    std::vector<std::unique_ptr<IngestWorker>> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        sqlite3* workerDb = openDatabase(dbPath);
+        if (!workerDb) {
+            workers.clear();
+            sqlite3_close(db);
+            return 1;
+        }
+        workers.push_back(std::make_unique<IngestWorker>(workerDb, windows, batchSize,
+                                                         std::chrono::milliseconds(flushMs)));
+    }
+
+    std::cerr << "Logger started, database initialized (batch " << batchSize
+              << ", flush " << flushMs << " ms, " << workerCount << " workers, windows";
+    for (auto w : windows) std::cerr << " " << aggregate::windowName(w);
+    std::cerr << ")" << std::endl;
+
+    // Очистка БД от данных старше месяца (с --archive - с выгрузкой в архив)
+    auto retention = std::make_unique<RetentionTask>(db, std::chrono::hours(24 * 30),
+                                                     std::chrono::seconds(retentionIntervalSec), archiveDir);
+
+    // Измерения накапливаются для своего обработчика и передаются пачками
+    std::vector<std::vector<Sample>> batches(workers.size());
+    auto dispatch = [&](const Sample& sample) {
+        size_t shard = shardOf(sample.sensor, workers.size());
+        batches[shard].push_back(sample);
+        if (batches[shard].size() >= DISPATCH_BATCH) {
+            workers[shard]->post(batches[shard]);
+        }
+    };
+    auto dispatchAll = [&] {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->post(batches[i]);
+        }
+    };
+
+    if (shmName.empty()) {
+        // Собственный буфер cin: in_avail() показывает, есть ли уже прочитанный ввод
+        std::ios::sync_with_stdio(false);
+        timestamp::Parser parser;
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            Sample sample;
+            if (!parseLine(parser, line, sample)) {
+                std::cerr << "Skipping malformed line: " << line << std::endl;
+                continue;
+            }
+            dispatch(sample);
+            // Ввод кончился (симулятор пишет раз в несколько секунд): отдаем накопленное
+            // сразу, чтобы измерения не ждали заполнения пачки
+            if (std::cin.rdbuf()->in_avail() <= 0) {
+                dispatchAll();
+            }
+        }
+    } else {
+#ifndef _WIN32
+        // Двоичные записи из кольцевого буфера симулятора: без разбора текста.
+        // После перезапуска логгера дочитываются записи новее последней сохраненной
+        // (для каждого датчика)
+        std::signal(SIGINT, handleStopSignal);
+        std::signal(SIGTERM, handleStopSignal);
+        std::map<int, std::time_t> lastStored;
+        {
+            std::lock_guard<std::mutex> lock(db_mutex);
+            lastStored = storage::latestEpochs(db);
+        }
+
+        ring::Reader samples;
+        ring::Record records[256];
+        uint64_t reportedLost = 0;
+        bool waiting = false;
+        while (running) {
+            if (!samples.isOpen() || samples.stale()) {
+                if (!samples.open(shmName)) {
+                    if (!waiting) {
+                        std::cerr << "Waiting for shared memory " << shmName << ": "
+                                  << std::strerror(errno) << std::endl;
+                        waiting = true;
+                    }
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                    continue;
+                }
+                std::cerr << "Reading samples from shared memory " << shmName << std::endl;
+                waiting = false;
+            }
+
+            size_t count = samples.read(records, sizeof(records) / sizeof(records[0]));
+            for (size_t i = 0; i < count; ++i) {
+                std::time_t& last = lastStored[records[i].sensor];
+                if (records[i].epoch <= last) continue;
+                last = records[i].epoch;
+                dispatch({records[i].sensor, records[i].epoch, records[i].value,
+                          toTM(Clock::from_time_t(records[i].epoch))});
+            }
+            dispatchAll();
+            if (samples.lost() != reportedLost) {
+                std::cerr << "Shared memory: lost " << samples.lost() - reportedLost
+                          << " samples (reader fell behind)" << std::endl;
+                reportedLost = samples.lost();
+            }
+            if (count == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(ring::POLL_MS));
+            }
+        }
+#else
+        std::cerr << "--shm is not supported on Windows" << std::endl;
+#endif
+    }
+    dispatchAll();
+
+    // Деструкторы обработчиков записывают остаток пакетов, поэтому до закрытия БД
+    retention.reset();
+    workers.clear();
     sqlite3_close(db);
     return 0;
 }
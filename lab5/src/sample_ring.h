@@ -0,0 +1,276 @@
+#pragma once
+// Кольцевой буфер измерений в разделяемой памяти POSIX (shm_open/mmap): один писатель
+// (симулятор) и любое число читателей (логгер, сервер) в других процессах.
+//
+// Записи двоичные {epoch, value, sensor}, читателю не нужно разбирать текст. Писатель никогда
+// не ждет читателей и не знает о них: запись номер n кладется в ячейку n % capacity,
+// номер следующей записи (head) публикуется после записи ячейки. Каждый читатель хранит
+// свой номер следующей записи; отставший больше чем на capacity записей теряет самые
+// старые (счетчик lost) и продолжает с самой старой сохранившейся.
+//
+// Ячейка защищена счетчиком версии (seqlock): нечетная версия - идет запись, 2n + 2 -
+// в ячейке запись номер n. Читатель сравнивает версию до и после копирования и так
+// обнаруживает ячейку, перезаписанную писателем во время чтения.
+//
+// Сегмент не удаляется при выходе писателя: перезапущенный симулятор подключается
+// к нему и продолжает нумерацию, читатели перезапуска не замечают.
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <ctime>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ring {
+
+const char* const DEFAULT_NAME = "/lab5_samples";
+const uint64_t DEFAULT_CAPACITY = 65536;
+// Интервал опроса читателями при пустом буфере
+const int POLL_MS = 10;
+
+struct Record {
+    std::time_t epoch;
+    double value;
+    int sensor;
+};
+
+struct Slot {
+    std::atomic<uint64_t> version;
+    std::atomic<int64_t> epoch;
+    std::atomic<double> value;
+    std::atomic<int64_t> sensor;
+};
+
+const uint32_t MAGIC = 0x4c354253;  // "L5BS"
+
+struct Header {
+    std::atomic<uint32_t> magic;
+    std::atomic<uint64_t> capacity;
+    // Номер следующей записи; в отдельной строке кэша, которую пишет только писатель
+    alignas(64) std::atomic<uint64_t> head;
+};
+
+inline size_t segmentSize(uint64_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Slot);
+}
+
+inline Slot* slotsOf(void* base) {
+    return reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(Header));
+}
+
+#ifndef _WIN32
+
+class Writer {
+public:
+    Writer() = default;
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    ~Writer() {
+        if (base) munmap(base, size);
+    }
+
+    // Создает сегмент name или подключается к существующему с тем же числом ячеек.
+    // При ошибке возвращает false, причина - в errno
+    bool open(const std::string& name, uint64_t capacity) {
+        if (capacity == 0) {
+            errno = EINVAL;
+            return false;
+        }
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+        if (fd < 0) return false;
+
+        struct stat st;
+        size = segmentSize(capacity);
+        bool reuse = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size;
+        if (!reuse && ftruncate(fd, size) != 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return false;
+        }
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            return false;
+        }
+
+        header = static_cast<Header*>(base);
+        slots = slotsOf(base);
+        cap = capacity;
+        if (reuse && header->magic.load(std::memory_order_acquire) == MAGIC &&
+            header->capacity.load(std::memory_order_relaxed) == capacity) {
+            return true;
+        }
+
+        // Новый сегмент (или другого размера): нумерация с нуля, magic - последним
+        header->magic.store(0, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < capacity; ++i) {
+            slots[i].version.store(0, std::memory_order_relaxed);
+        }
+        header->capacity.store(capacity, std::memory_order_relaxed);
+        header->head.store(0, std::memory_order_relaxed);
+        header->magic.store(MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    void push(std::time_t epoch, double value, int sensor = 0) {
+        uint64_t n = header->head.load(std::memory_order_relaxed);
+        Slot& slot = slots[n % cap];
+        slot.version.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.epoch.store(epoch, std::memory_order_relaxed);
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.sensor.store(sensor, std::memory_order_relaxed);
+        slot.version.store(2 * n + 2, std::memory_order_release);
+        header->head.store(n + 1, std::memory_order_release);
+    }
+
+private:
+    void* base = nullptr;
+    size_t size = 0;
+    Header* header = nullptr;
+    Slot* slots = nullptr;
+    uint64_t cap = 0;
+};
+
+class Reader {
+public:
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader() {
+        unmap();
+    }
+
+    // Подключение к сегменту писателя только для чтения. false, если сегмента еще нет
+    // (errno = ENOENT) или он еще не инициализирован (errno = EAGAIN)
+    bool open(const std::string& name) {
+        unmap();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            close(fd);
+            errno = EAGAIN;
+            return false;
+        }
+        size = st.st_size;
+        base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            return false;
+        }
+
+        header = static_cast<const Header*>(base);
+        cap = header->capacity.load(std::memory_order_relaxed);
+        if (header->magic.load(std::memory_order_acquire) != MAGIC || cap == 0 ||
+            segmentSize(cap) != size) {
+            unmap();
+            errno = EAGAIN;
+            return false;
+        }
+        slots = slotsOf(base);
+        next = oldest(header->head.load(std::memory_order_acquire));
+        return true;
+    }
+
+    bool isOpen() const {
+        return base != nullptr;
+    }
+
+    // Сегмент переинициализирован писателем с другим размером: нужно открыть заново
+    bool stale() const {
+        return header->magic.load(std::memory_order_acquire) != MAGIC ||
+               header->capacity.load(std::memory_order_relaxed) != cap;
+    }
+
+    // Пропустить сохранившиеся записи, читать только новые
+    void seekHead() {
+        next = header->head.load(std::memory_order_acquire);
+    }
+
+    // Копирует в out до max записей начиная с текущей позиции, возвращает их число
+    size_t read(Record* out, size_t max) {
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (next > head) {
+            next = oldest(head);  // сегмент переинициализирован, нумерация с нуля
+        }
+        skipTo(oldest(head));
+
+        size_t count = 0;
+        while (count < max && next < head) {
+            const Slot& slot = slots[next % cap];
+            uint64_t expected = 2 * next + 2;
+            uint64_t before = slot.version.load(std::memory_order_acquire);
+            Record record{static_cast<std::time_t>(slot.epoch.load(std::memory_order_relaxed)),
+                          slot.value.load(std::memory_order_relaxed),
+                          static_cast<int>(slot.sensor.load(std::memory_order_relaxed))};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = slot.version.load(std::memory_order_relaxed);
+
+            if (before != expected || after != expected) {
+                // Писатель обогнал на круг: догоняем с самой старой сохранившейся записи
+                head = header->head.load(std::memory_order_acquire);
+                if (next >= oldest(head)) break;
+                skipTo(oldest(head));
+                continue;
+            }
+            out[count++] = record;
+            ++next;
+        }
+        return count;
+    }
+
+    // Номер следующей читаемой записи
+    uint64_t position() const {
+        return next;
+    }
+
+    // Число записей, перезаписанных до того, как читатель успел их прочитать
+    uint64_t lost() const {
+        return lostCount;
+    }
+
+private:
+    void* base = nullptr;
+    size_t size = 0;
+    const Header* header = nullptr;
+    const Slot* slots = nullptr;
+    uint64_t cap = 0;
+    uint64_t next = 0;
+    uint64_t lostCount = 0;
+
+    uint64_t oldest(uint64_t head) const {
+        return head > cap ? head - cap : 0;
+    }
+
+    void skipTo(uint64_t position) {
+        if (next < position) {
+            lostCount += position - next;
+            next = position;
+        }
+    }
+
+    void unmap() {
+        if (base) munmap(base, size);
+        base = nullptr;
+        header = nullptr;
+        slots = nullptr;
+    }
+};
+
+#endif
+
+}  // namespace ring
@@ -1,6 +1,10 @@
 // API URL
 const API_URL = 'http://localhost:8080';
 let temperatureChart = null;
+// Предельное число точек графика: при большем числе измерений сервер прореживает данные
+const MAX_CHART_POINTS = 500;
+// Появились ли новые измерения с последней загрузки статистики
+let hasNewSamples = false;
 
 // Функция для плавной навигации
 function scrollToSection(sectionId) {
@@ -25,11 +29,18 @@ document.addEventListener('DOMContentLoaded', function() {
     loadCurrentTemperature();
     loadStatistics();
     
-    // Обновляем текущую температуру каждые 5 секунд
-    setInterval(loadCurrentTemperature, 5000);
+    // Новые измерения приходят с сервера по мере записи (Server-Sent Events),
+    // без поддержки EventSource - опрашиваем текущую температуру каждые 5 секунд
+    if (window.EventSource) {
+        subscribeToStream();
+    } else {
+        setInterval(loadCurrentTemperature, 5000);
+    }
     
-    // Обновляем статистику каждые 30 секунд
-    setInterval(loadStatistics, 30000);
+    // Обновляем статистику каждые 30 секунд, если были новые измерения
+    setInterval(() => {
+        if (hasNewSamples) loadStatistics();
+    }, 30000);
     
     // Слушатели для кнопок
     document.getElementById('applyFilters').addEventListener('click', loadStatistics);
@@ -65,24 +76,44 @@ function formatISO8601(date) {
     return `${year}-${month}-${day}T${hours}:${minutes}:${seconds}`;
 }
 
+function updateCurrentTemperature(data) {
+    if (data.temperature !== undefined) {
+        document.getElementById('tempValue').textContent = data.temperature.toFixed(2);
+        const date = new Date(data.timestamp);
+        document.getElementById('tempTime').textContent = 
+            `Обновлено: ${date.toLocaleString('ru-RU')}`;
+        document.getElementById('apiStatus').className = 'status-dot online';
+        hasNewSamples = true;
+    }
+}
+
 function loadCurrentTemperature() {
     fetch(`${API_URL}/api/current`)
         .then(response => response.json())
-        .then(data => {
-            if (data.temperature !== undefined) {
-                document.getElementById('tempValue').textContent = data.temperature.toFixed(2);
-                const date = new Date(data.timestamp);
-                document.getElementById('tempTime').textContent = 
-                    `Обновлено: ${date.toLocaleString('ru-RU')}`;
-                document.getElementById('apiStatus').className = 'status-dot online';
-            }
-        })
+        .then(updateCurrentTemperature)
         .catch(error => {
             console.error('Error loading current temperature:', error);
             document.getElementById('apiStatus').className = 'status-dot offline';
         });
 }
 
+// Подписка на /api/stream: событие на каждое новое измерение.
+// При обрыве EventSource переподключается сам и передает Last-Event-ID,
+// так что пропущенные измерения сервер досылает
+function subscribeToStream() {
+    const source = new EventSource(`${API_URL}/api/stream`);
+    source.onmessage = event => {
+        try {
+            updateCurrentTemperature(JSON.parse(event.data));
+        } catch (error) {
+            console.error('Error parsing stream event:', error);
+        }
+    };
+    source.onerror = () => {
+        document.getElementById('apiStatus').className = 'status-dot offline';
+    };
+}
+
 function loadStatistics() {
     const startDateInput = document.getElementById('startDate').value;
     const endDateInput = document.getElementById('endDate').value;
@@ -99,12 +130,14 @@ function loadStatistics() {
     const startISO = formatISO8601(startDate);
     const endISO = formatISO8601(endDate);
     
-    const url = `${API_URL}/api/stats?start=${encodeURIComponent(startISO)}&end=${encodeURIComponent(endISO)}`;
+    const url = `${API_URL}/api/stats?start=${encodeURIComponent(startISO)}&end=${encodeURIComponent(endISO)}` +
+        `&max_points=${MAX_CHART_POINTS}`;
     
     fetch(url)
         .then(response => response.json())
         .then(data => {
             if (data.data && data.summary) {
+                hasNewSamples = false;
                 updateStatistics(data.summary);
                 updateChart(data.data);
                 updateTable(data.data);
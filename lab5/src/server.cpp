@@ -11,6 +11,20 @@
 #include <fstream>
 #include <signal.h>
 #include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <climits>
+#include <cerrno>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <atomic>
+#include <shared_mutex>
+#include <condition_variable>
+#include <sys/stat.h>
 
 // Кроссплатформенная поддержка сокетов
 #ifdef _WIN32
@@ -23,16 +37,37 @@
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
     #include <unistd.h>
+    #include <fcntl.h>
+    #include <cerrno>
+    #include <sys/uio.h>
 #endif
 
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/inotify.h>
+    #include <sys/eventfd.h>
+    #include <poll.h>
+#endif
+
+// Сжатие статических файлов (флаги задает build.sh, если библиотеки найдены)
+#ifdef HAVE_ZLIB
+    #include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+    #include <brotli/encode.h>
+#endif
+
+#include "storage.h"
+#include "json_writer.h"
+#include "sample_ring.h"
+#include "archive.h"
+
 // Глобальная переменная для завершения сервера
 volatile bool running = true;
 
-// Мьютекс для синхронизации доступа к БД
-std::mutex db_mutex;
-
 // Кроссплатформенная функция для преобразования времени
 std::string getCurrentTime() {
     std::time_t t = std::time(nullptr);
@@ -49,313 +84,2466 @@ std::string getCurrentTime() {
 
 // Структура для измерения
 struct Measurement {
-    std::string timestamp;
+    std::time_t epoch;
     double temperature;
 };
 
-// Инициализация базы данных
-void initDatabase(sqlite3* db) {
-    const char* sql = R"(
-        CREATE TABLE IF NOT EXISTS measurements (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp TEXT UNIQUE,
-            temperature REAL,
-            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
-        );
-    )";
-    
-    char* errMsg = nullptr;
-    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
-    
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
+// Путь к файлу БД
+std::string dbPath = "measurements.db";
+
+// Соединение с БД только для чтения с кэшем подготовленных запросов.
+// Запрос компилируется один раз, при повторном использовании только сбрасывается
+// (sqlite3_reset) и заново связывается с параметрами.
+class DbConnection {
+public:
+    explicit DbConnection(const std::string& path) {
+        // Соединение используется одним потоком, внутренний мьютекс SQLite не нужен
+        int rc = sqlite3_open_v2(path.c_str(), &db,
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Cannot open read connection: " << sqlite3_errmsg(db) << std::endl;
+        }
+        sqlite3_busy_timeout(db, 1000);
+    }
+
+    ~DbConnection() {
+        clear();
+        sqlite3_close(db);
+    }
+
+    DbConnection(const DbConnection&) = delete;
+    DbConnection& operator=(const DbConnection&) = delete;
+
+    // Подготовленный запрос из кэша (nullptr при ошибке).
+    // После чтения результатов вызывающий обязан выполнить sqlite3_reset,
+    // чтобы завершить транзакцию чтения.
+    sqlite3_stmt* prepare(const char* sql) {
+        auto it = statements.find(sql);
+        if (it != statements.end()) {
+            sqlite3_reset(it->second);
+            sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+
+        // Запросы к секциям зависят от имени таблицы: ограничиваем кэш,
+        // чтобы не копить запросы к удаленным секциям
+        if (statements.size() >= MAX_CACHED_STATEMENTS) {
+            clear();
+        }
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+            return nullptr;
+        }
+        statements.emplace(sql, stmt);
+        return stmt;
+    }
+
+    sqlite3_stmt* prepare(const std::string& sql) {
+        return prepare(sql.c_str());
+    }
+
+    // Соединение SQLite для запросов вне кэша (курсоры потоковых ответов)
+    sqlite3* handle() const {
+        return db;
+    }
+
+private:
+    static const size_t MAX_CACHED_STATEMENTS = 256;
+
+    sqlite3* db = nullptr;
+    std::unordered_map<std::string, sqlite3_stmt*> statements;
+
+    void clear() {
+        for (auto& entry : statements) {
+            sqlite3_finalize(entry.second);
+        }
+        statements.clear();
+    }
+};
+
+// Пул соединений только для чтения: каждый цикл событий держит свое соединение
+// все время работы, поток модели "поток на соединение" берет его на время обслуживания клиента
+class DbPool {
+public:
+    explicit DbPool(const std::string& path) : path(path) {}
+
+    std::unique_ptr<DbConnection> acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                auto conn = std::move(idle.back());
+                idle.pop_back();
+                return conn;
+            }
+        }
+        return std::make_unique<DbConnection>(path);
+    }
+
+    void release(std::unique_ptr<DbConnection> conn) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(conn));
+    }
+
+private:
+    std::string path;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<DbConnection>> idle;
+};
+
+// Архив измерений, выгруженных логгером из удаленных секций (--archive): файл на датчик.
+// Файлы открываются при первом запросе и отображаются в память; дописанный логгером
+// файл (изменились размер или время изменения) открывается заново. Запрос держит
+// shared_ptr на свое отображение, поэтому повторное открытие не мешает идущим запросам.
+class ArchiveSet {
+public:
+    void setDirectory(const std::string& path) {
+        dir = path;
+    }
+
+    bool enabled() const {
+        return !dir.empty();
+    }
+
+    // Архив датчика (nullptr, если его нет)
+    std::shared_ptr<const archive::Reader> get(int sensor) {
+        if (dir.empty()) {
+            return nullptr;
+        }
+        std::string path = archive::seriesPath(dir, sensor);
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = series[sensor];
+        if (entry.reader && entry.size == st.st_size && entry.mtime == st.st_mtime) {
+            return entry.reader;
+        }
+        auto reader = std::make_shared<archive::Reader>();
+        if (!reader->open(path)) {
+            std::cerr << "Cannot open archive " << path << std::endl;
+            return nullptr;
+        }
+        entry = {reader, st.st_size, st.st_mtime};
+        return entry.reader;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const archive::Reader> reader;
+        off_t size;
+        std::time_t mtime;
+    };
+
+    std::string dir;
+    std::mutex mutex;
+    std::unordered_map<int, Entry> series;
+};
+
+ArchiveSet archives;
+
+// Начало самой старой секции: более ранние измерения есть только в архиве
+// (max, если секций нет)
+std::time_t oldestPartitionStart(DbConnection& db) {
+    std::time_t start = std::numeric_limits<std::time_t>::max();
+    sqlite3_stmt* stmt = db.prepare("SELECT MIN(start_epoch) FROM measurement_partitions");
+    if (!stmt) {
+        return start;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        start = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    return start;
+}
+
+// Имена секций от новых к старым
+std::vector<std::string> newestPartitions(DbConnection& db) {
+    std::vector<std::string> names;
+    sqlite3_stmt* partitions = db.prepare(
+        "SELECT name FROM measurement_partitions ORDER BY start_epoch DESC");
+    if (!partitions) {
+        return names;
+    }
+    while (sqlite3_step(partitions) == SQLITE_ROW) {
+        names.push_back(reinterpret_cast<const char*>(sqlite3_column_text(partitions, 0)));
+    }
+    sqlite3_reset(partitions);
+    return names;
+}
+
+// Получение последней температуры датчика (самое позднее измерение в самой новой
+// секции, где он есть)
+bool getLastTemperature(DbConnection& db, int sensor, std::time_t& epoch, double& temperature) {
+    for (const auto& partition : newestPartitions(db)) {
+        sqlite3_stmt* stmt = db.prepare(
+            "SELECT epoch, temperature FROM " + partition + " WHERE sensor = ? ORDER BY epoch DESC LIMIT 1");
+        if (!stmt) {
+            continue;
+        }
+
+        sqlite3_bind_int(stmt, 1, sensor);
+        bool found = false;
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            epoch = sqlite3_column_int64(stmt, 0);
+            temperature = sqlite3_column_double(stmt, 1);
+            found = true;
+        }
+        sqlite3_reset(stmt);
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Датчики, измерения которых есть в самой новой непустой секции
+std::vector<int> getSensors(DbConnection& db) {
+    std::vector<int> sensors;
+    for (const auto& partition : newestPartitions(db)) {
+        sqlite3_stmt* stmt = db.prepare("SELECT DISTINCT sensor FROM " + partition + " ORDER BY sensor");
+        if (!stmt) {
+            continue;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            sensors.push_back(sqlite3_column_int(stmt, 0));
+        }
+        sqlite3_reset(stmt);
+        if (!sensors.empty()) {
+            break;
+        }
+    }
+    return sensors;
+}
+
+// Обход измерений датчика за период по возрастанию времени: читаются только секции,
+// пересекающиеся с периодом, visit(epoch, temperature) вызывается для каждой строки.
+// Часть периода раньше самой старой секции читается из архива.
+template <typename Visitor>
+void forEachMeasurement(DbConnection& db, int sensor, std::time_t startTime, std::time_t endTime,
+                        Visitor&& visit) {
+    if (auto series = archives.get(sensor)) {
+        std::time_t oldest = oldestPartitionStart(db);
+        series->scan(startTime, std::min(endTime, oldest - 1), visit);
+    }
+
+    sqlite3_stmt* partitionsStmt = db.prepare(storage::PARTITIONS_IN_RANGE_SQL);
+    if (!partitionsStmt) {
+        return;
+    }
+
+    for (const auto& partition : storage::partitionsInRange(partitionsStmt, startTime, endTime)) {
+        sqlite3_stmt* stmt = db.prepare(
+            "SELECT epoch, temperature FROM " + partition.name +
+            " WHERE sensor = ? AND epoch >= ? AND epoch <= ? ORDER BY epoch");
+        if (!stmt) {
+            continue;
+        }
+
+        sqlite3_bind_int(stmt, 1, sensor);
+        sqlite3_bind_int64(stmt, 2, startTime);
+        sqlite3_bind_int64(stmt, 3, endTime);
+        
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            visit(static_cast<std::time_t>(sqlite3_column_int64(stmt, 0)), sqlite3_column_double(stmt, 1));
+        }
+        
+        sqlite3_reset(stmt);
+    }
+}
+
+// Получение измерений датчика за период
+std::vector<Measurement> getStatistics(DbConnection& db, int sensor, std::time_t startTime, std::time_t endTime) {
+    std::vector<Measurement> results;
+    forEachMeasurement(db, sensor, startTime, endTime, [&](std::time_t epoch, double temperature) {
+        results.push_back({epoch, temperature});
+    });
+    return results;
+}
+
+// Последние измерения датчика по умолчанию в памяти (кольцевой буфер). Заполняется потоком tailRecentSamples,
+// который дочитывает новые строки из БД; /api/current и запросы /api/stats за период,
+// целиком попадающий в буфер, обслуживаются без обращения к SQLite.
+// Измерения хранятся по возрастанию времени: буфер содержит все измерения начиная
+// с самого старого из них (минус еще не дочитанные, не старше одного интервала опроса).
+class RecentSamples {
+public:
+    void setCapacity(size_t n) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        ring.assign(n, Measurement{0, 0});
+        head = 0;
+        count = 0;
+    }
+
+    bool enabled() const {
+        return !ring.empty();
+    }
+
+    void push(std::time_t epoch, double temperature) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (ring.empty()) return;
+        ring[(head + count) % ring.size()] = {epoch, temperature};
+        if (count < ring.size()) {
+            count++;
+        } else {
+            head = (head + 1) % ring.size();
+        }
+    }
+
+    // Покрывает ли буфер период, начинающийся с startTime
+    bool covers(std::time_t startTime) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return count > 0 && startTime >= at(0).epoch;
+    }
+
+    // Самое позднее измерение
+    bool last(std::time_t& epoch, double& temperature) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (count == 0) return false;
+        const Measurement& m = at(count - 1);
+        epoch = m.epoch;
+        temperature = m.temperature;
+        return true;
+    }
+
+    // Обход всех измерений новее after
+    template <typename Visitor>
+    void forEachAfter(std::time_t after, Visitor&& visit) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        for (size_t i = lowerBound(after + 1); i < count; ++i) {
+            visit(at(i).epoch, at(i).temperature);
+        }
+    }
+
+    // Обход измерений периода, если буфер покрывает его начало (иначе false и период
+    // читается из БД). visit вызывается под блокировкой чтения.
+    template <typename Visitor>
+    bool forEach(std::time_t startTime, std::time_t endTime, Visitor&& visit) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (count == 0 || startTime < at(0).epoch) return false;
+
+        for (size_t i = lowerBound(startTime); i < count && at(i).epoch <= endTime; ++i) {
+            visit(at(i).epoch, at(i).temperature);
+        }
+        return true;
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    std::vector<Measurement> ring;
+    size_t head = 0;   // индекс самого старого измерения
+    size_t count = 0;
+
+    const Measurement& at(size_t i) const {
+        return ring[(head + i) % ring.size()];
+    }
+
+    // Логический индекс первого измерения не раньше t (двоичный поиск)
+    size_t lowerBound(std::time_t t) const {
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (at(mid).epoch < t) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+};
+
+RecentSamples recentSamples;
+
+// Оповещение о новых измерениях в буфере: циклы событий получают сигнал через eventfd,
+// потоки модели "поток на соединение" ждут на condition_variable
+class SampleHub {
+public:
+    void addListener(int fd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        listeners.push_back(fd);
+    }
+
+    void removeListener(int fd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), fd), listeners.end());
+    }
+
+    void publish(std::time_t newest) {
+        std::lock_guard<std::mutex> lock(mutex);
+        newestEpoch = newest;
+        changed.notify_all();
+#ifdef __linux__
+        uint64_t one = 1;
+        for (int fd : listeners) {
+            ssize_t rc = write(fd, &one, sizeof(one));
+            (void)rc;  // счетчик eventfd уже ненулевой - цикл и так проснется
+        }
+#endif
+    }
+
+    // Ожидание измерения новее after не дольше deadline; true, если оно появилось
+    bool wait(std::time_t after, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (newestEpoch <= after && running) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+            // Флаг running проверяется не реже раза в секунду
+            changed.wait_until(lock, std::min(deadline, now + std::chrono::seconds(1)));
+        }
+        return newestEpoch > after;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<int> listeners;
+    std::time_t newestEpoch = 0;
+};
+
+SampleHub sampleHub;
+
+// Интервал опроса БД потоком tailRecentSamples, мс
+int hotPollMs = 250;
+
+// Начальное заполнение буфера: последние capacity измерений датчика по умолчанию,
+// секции от новых к старым
+std::time_t loadRecentSamples(DbConnection& db, size_t capacity) {
+    std::vector<Measurement> newest;  // от новых к старым
+    for (const auto& name : newestPartitions(db)) {
+        if (newest.size() >= capacity) break;
+        sqlite3_stmt* stmt = db.prepare(
+            "SELECT epoch, temperature FROM " + name + " WHERE sensor = ? ORDER BY epoch DESC LIMIT ?");
+        if (!stmt) continue;
+        sqlite3_bind_int(stmt, 1, storage::DEFAULT_SENSOR);
+        sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(capacity - newest.size()));
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            newest.push_back({static_cast<std::time_t>(sqlite3_column_int64(stmt, 0)),
+                              sqlite3_column_double(stmt, 1)});
+        }
+        sqlite3_reset(stmt);
+    }
+
+    for (auto it = newest.rbegin(); it != newest.rend(); ++it) {
+        recentSamples.push(it->epoch, it->temperature);
+    }
+    return newest.empty() ? 0 : newest.front().epoch;
+}
+
+// Поток, дочитывающий в буфер измерения новее последнего прочитанного
+void tailRecentSamples(DbPool& pool, size_t capacity) {
+    auto db = pool.acquire();
+    std::time_t lastEpoch = loadRecentSamples(*db, capacity);
+    sampleHub.publish(lastEpoch);
+
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(hotPollMs));
+        std::time_t previous = lastEpoch;
+        forEachMeasurement(*db, storage::DEFAULT_SENSOR, lastEpoch + 1, std::numeric_limits<std::time_t>::max(),
+                           [&](std::time_t epoch, double temperature) {
+            recentSamples.push(epoch, temperature);
+            lastEpoch = epoch;
+        });
+        // Один сигнал на пачку измерений, подписчики получат ее одной записью
+        if (lastEpoch != previous) {
+            sampleHub.publish(lastEpoch);
+        }
+    }
+    pool.release(std::move(db));
+}
+
+#ifndef _WIN32
+// Поток, заполняющий буфер из кольцевого буфера симулятора в разделяемой памяти (--shm)
+// вместо опроса БД: измерение попадает в буфер сразу после публикации, не дожидаясь
+// записи логгером. Начальное заполнение - из БД, из сегмента берутся записи новее
+void followSampleRing(DbPool& pool, size_t capacity, std::string name) {
+    std::time_t lastEpoch;
+    {
+        auto db = pool.acquire();
+        lastEpoch = loadRecentSamples(*db, capacity);
+        pool.release(std::move(db));
+    }
+    sampleHub.publish(lastEpoch);
+
+    ring::Reader samples;
+    ring::Record records[256];
+    bool waiting = false;
+    while (running) {
+        if (!samples.isOpen() || samples.stale()) {
+            if (!samples.open(name)) {
+                if (!waiting) {
+                    std::cerr << "Waiting for shared memory " << name << ": "
+                              << std::strerror(errno) << std::endl;
+                    waiting = true;
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+            std::cout << "Reading samples from shared memory " << name << std::endl;
+            waiting = false;
+        }
+
+        size_t count = samples.read(records, sizeof(records) / sizeof(records[0]));
+        std::time_t previous = lastEpoch;
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].sensor != storage::DEFAULT_SENSOR || records[i].epoch <= lastEpoch) continue;
+            recentSamples.push(records[i].epoch, records[i].value);
+            lastEpoch = records[i].epoch;
+        }
+        if (lastEpoch != previous) {
+            sampleHub.publish(lastEpoch);
+        }
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ring::POLL_MS));
+        }
+    }
+}
+#endif
+
+// Интервал (корзина) прореживания: агрегаты по всем измерениям, попавшим в интервал
+struct Bucket {
+    std::time_t start;
+    double minValue;
+    double maxValue;
+    double sum;
+    long count;
+};
+
+// Добавление корзины. Корзины приходят по возрастанию start; корзина на границе
+// секций/таблиц/блоков архива сливается с предыдущей
+void appendBucket(std::vector<Bucket>& buckets, const Bucket& b) {
+    if (b.count <= 0) {
+        return;
+    }
+
+    if (!buckets.empty() && buckets.back().start == b.start) {
+        Bucket& last = buckets.back();
+        last.minValue = std::min(last.minValue, b.minValue);
+        last.maxValue = std::max(last.maxValue, b.maxValue);
+        last.sum += b.sum;
+        last.count += b.count;
+    } else {
+        buckets.push_back(b);
+    }
+}
+
+// Корзина из строки запроса (start, min, max, sum, count)
+void appendBucket(std::vector<Bucket>& buckets, sqlite3_stmt* stmt) {
+    Bucket b;
+    b.start = sqlite3_column_int64(stmt, 0);
+    b.minValue = sqlite3_column_double(stmt, 1);
+    b.maxValue = sqlite3_column_double(stmt, 2);
+    b.sum = sqlite3_column_double(stmt, 3);
+    b.count = sqlite3_column_int64(stmt, 4);
+    appendBucket(buckets, b);
+}
+
+// Первое и последнее измерение датчика в периоде [from, to]: MIN/MAX(epoch) по секциям,
+// пересекающимся с периодом (по первичному ключу (sensor, epoch) - без просмотра строк),
+// и границы архива, ограниченные периодом
+bool getDataBounds(DbConnection& db, int sensor, std::time_t from, std::time_t to,
+                   std::time_t& first, std::time_t& last) {
+    bool found = false;
+    sqlite3_stmt* partitionsStmt = db.prepare(storage::PARTITIONS_IN_RANGE_SQL);
+    if (partitionsStmt) {
+        for (const auto& partition : storage::partitionsInRange(partitionsStmt, from, to)) {
+            sqlite3_stmt* stmt = db.prepare(
+                "SELECT MIN(epoch), MAX(epoch) FROM " + partition.name +
+                " WHERE sensor = ?1 AND epoch >= ?2 AND epoch <= ?3");
+            if (!stmt) {
+                continue;
+            }
+            sqlite3_bind_int(stmt, 1, sensor);
+            sqlite3_bind_int64(stmt, 2, from);
+            sqlite3_bind_int64(stmt, 3, to);
+            if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+                std::time_t lo = sqlite3_column_int64(stmt, 0);
+                std::time_t hi = sqlite3_column_int64(stmt, 1);
+                first = found ? std::min(first, lo) : lo;
+                last = found ? std::max(last, hi) : hi;
+                found = true;
+            }
+            sqlite3_reset(stmt);
+        }
+    }
+
+    auto series = archives.get(sensor);
+    if (series && !series->empty() && series->firstTime() <= to && series->lastTime() >= from) {
+        std::time_t lo = std::max(from, series->firstTime());
+        std::time_t hi = std::min(to, series->lastTime());
+        first = found ? std::min(first, lo) : lo;
+        last = found ? std::max(last, hi) : hi;
+        found = true;
+    }
+    return found;
+}
+
+// Выражение номера корзины: начало корзины размера ?4 со сдвигом ?3 (смещение от UTC),
+// чтобы часовые и суточные корзины совпадали с локальными часами и сутками
+#define BUCKET_START_SQL(column) "((" column " + ?3) / ?4) * ?4 - ?3"
+
+// Агрегация сырых измерений датчика по корзинам, GROUP BY внутри каждой секции
+void aggregateRaw(DbConnection& db, int sensor, std::time_t from, std::time_t to,
+                  long bucket, long offset, std::vector<Bucket>& buckets) {
+    sqlite3_stmt* partitionsStmt = db.prepare(storage::PARTITIONS_IN_RANGE_SQL);
+    if (!partitionsStmt || from > to) {
+        return;
+    }
+
+    for (const auto& partition : storage::partitionsInRange(partitionsStmt, from, to)) {
+        sqlite3_stmt* stmt = db.prepare(
+            "SELECT " BUCKET_START_SQL("epoch") " AS bucket, MIN(temperature), MAX(temperature), "
+            "SUM(temperature), COUNT(*) FROM " + partition.name +
+            " WHERE sensor = ?5 AND epoch >= ?1 AND epoch <= ?2 GROUP BY bucket ORDER BY bucket");
+        if (!stmt) {
+            continue;
+        }
+
+        sqlite3_bind_int64(stmt, 1, from);
+        sqlite3_bind_int64(stmt, 2, to);
+        sqlite3_bind_int64(stmt, 3, offset);
+        sqlite3_bind_int64(stmt, 4, bucket);
+        sqlite3_bind_int(stmt, 5, sensor);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            appendBucket(buckets, stmt);
+        }
+        sqlite3_reset(stmt);
+    }
+}
+
+// Агрегация архива датчика по корзинам (то же начало корзины, что и BUCKET_START_SQL).
+// Блок, целиком лежащий в периоде и в одной корзине, учитывается по агрегатам из его
+// заголовка без распаковки, остальные пересекающиеся с периодом блоки распаковываются.
+void aggregateArchive(const archive::Reader& series, std::time_t from, std::time_t to,
+                      long bucket, long offset, std::vector<Bucket>& buckets) {
+    auto bucketOf = [bucket, offset](std::time_t t) { return ((t + offset) / bucket) * bucket - offset; };
+    const auto& blocks = series.blocks();
+    std::time_t times[archive::BLOCK_SAMPLES];
+    double values[archive::BLOCK_SAMPLES];
+    for (size_t i = series.firstBlock(from); i < blocks.size() && blocks[i].firstTime <= to; ++i) {
+        const archive::Block& block = blocks[i];
+        std::time_t start = bucketOf(block.firstTime);
+        if (block.firstTime >= from && block.lastTime <= to && bucketOf(block.lastTime) == start) {
+            appendBucket(buckets, {start, block.minValue, block.maxValue, block.sum, static_cast<long>(block.count)});
+            continue;
+        }
+        if (!archive::decodeBlock(block, times, values)) {
+            continue;
+        }
+        for (uint32_t j = 0; j < block.count; ++j) {
+            if (times[j] < from || times[j] > to) continue;
+            appendBucket(buckets, {bucketOf(times[j]), values[j], values[j], values[j], 1});
+        }
+    }
+}
+
+// Агрегация по таблице средних (hourly_avg / daily_avg). Возвращает начало последнего
+// агрегированного интервала таблицы (или -1, если таблица пуста): все, что позже,
+// логгер еще не усреднил, и хвост периода берется из сырых измерений.
+// Строки старой схемы без min/max/count считаются одним измерением со значением average.
+std::time_t aggregateSummary(DbConnection& db, int sensor, const std::string& table, const std::string& column,
+                             std::time_t from, std::time_t to,
+                             long bucket, long offset, std::vector<Bucket>& buckets) {
+    sqlite3_stmt* lastStmt = db.prepare("SELECT MAX(" + column + ") FROM " + table + " WHERE sensor = ?");
+    if (!lastStmt) {
+        return -1;
+    }
+    sqlite3_bind_int(lastStmt, 1, sensor);
+    std::time_t last = -1;
+    if (sqlite3_step(lastStmt) == SQLITE_ROW && sqlite3_column_type(lastStmt, 0) != SQLITE_NULL) {
+        last = sqlite3_column_int64(lastStmt, 0);
+    }
+    sqlite3_reset(lastStmt);
+    if (last < 0) {
+        return -1;
+    }
+
+    sqlite3_stmt* stmt = db.prepare(
+        "SELECT " BUCKET_START_SQL("c") " AS bucket, MIN(lo), MAX(hi), SUM(average * n), SUM(n) "
+        "FROM (SELECT " + column + " AS c, average, COALESCE(min, average) AS lo, "
+        "COALESCE(max, average) AS hi, COALESCE(count, 1) AS n FROM " + table +
+        " WHERE sensor = ?5 AND " + column + " >= ?1 AND " + column + " <= ?2) GROUP BY bucket ORDER BY bucket");
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    sqlite3_bind_int64(stmt, 3, offset);
+    sqlite3_bind_int64(stmt, 4, bucket);
+    sqlite3_bind_int(stmt, 5, sensor);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        appendBucket(buckets, stmt);
+    }
+    sqlite3_reset(stmt);
+    return last;
+}
+
+// Часовые корзины, на которые делятся сутки: такие корзины не пересекают границы суток
+const long HOUR_BUCKETS[] = {3600, 7200, 10800, 14400, 21600, 28800, 43200, 86400};
+
+// Размер корзины для max_points: не меньше range / maxPoints, крупные корзины
+// округляются вверх до делителя суток из целых часов или до целых суток, чтобы читать
+// готовые средние. Корзины выравниваются по местному времени (getBuckets), поэтому период
+// может задеть на одну корзину больше: размер увеличивается, пока корзин не больше maxPoints.
+long chooseBucket(std::time_t from, std::time_t to, long maxPoints) {
+    long range = static_cast<long>(to - from) + 1;
+    long bucket = std::max(1L, (range + maxPoints - 1) / maxPoints);
+    long fromOffset = storage::utcOffset(from);
+    long toOffset = storage::utcOffset(to);
+    while (true) {
+        if (bucket > 86400) {
+            bucket = (bucket + 86399) / 86400 * 86400;
+        } else if (bucket > 3600) {
+            bucket = *std::lower_bound(std::begin(HOUR_BUCKETS), std::end(HOUR_BUCKETS), bucket);
+        }
+        // Корзины из целых часов следуют местным часам и после перехода на летнее время,
+        // остальные идут с одним смещением (getBuckets)
+        std::time_t firstStart = ((from + fromOffset) / bucket) * bucket;
+        std::time_t lastStart = ((to + (bucket % 3600 == 0 ? toOffset : fromOffset)) / bucket) * bucket;
+        long count = static_cast<long>((lastStart - firstStart) / bucket) + 1;
+        if (count <= maxPoints) {
+            return bucket;
+        }
+        long span = static_cast<long>(lastStart + bucket - firstStart);
+        bucket = std::max(bucket + 1, (span + maxPoints - 1) / maxPoints);
+    }
+}
+
+// Участок периода с постоянным смещением от UTC
+struct OffsetSpan {
+    std::time_t from;
+    std::time_t to;
+    long offset;
+};
+
+// Разбиение [from, to] на участки между переходами на летнее/зимнее время: смещение
+// проверяется раз в неделю (переходы бывают реже), момент перехода ищется делением пополам
+std::vector<OffsetSpan> offsetSpans(std::time_t from, std::time_t to) {
+    const std::time_t STEP = 7 * 86400;
+    std::vector<OffsetSpan> spans;
+    OffsetSpan span{from, to, storage::utcOffset(from)};
+    std::time_t t = from;
+    while (t < to) {
+        std::time_t probe = to - t > STEP ? t + STEP : to;
+        if (storage::utcOffset(probe) == span.offset) {
+            t = probe;
+            continue;
+        }
+        // Первая секунда с новым смещением в (t, probe]
+        std::time_t lo = t, hi = probe;
+        while (hi - lo > 1) {
+            std::time_t mid = lo + (hi - lo) / 2;
+            if (storage::utcOffset(mid) == span.offset) lo = mid;
+            else hi = mid;
+        }
+        span.to = hi - 1;
+        spans.push_back(span);
+        span = {hi, to, storage::utcOffset(hi)};
+        t = hi;
+    }
+    spans.push_back(span);
+    return spans;
+}
+
+// Измерения периода, не покрытые таблицей средних: архив раньше самой старой секции
+// и сырые измерения секций
+void aggregateDetail(DbConnection& db, int sensor, std::time_t from, std::time_t to,
+                     long bucket, long offset, std::vector<Bucket>& buckets) {
+    if (from > to) {
+        return;
+    }
+    if (auto series = archives.get(sensor)) {
+        std::time_t oldest = oldestPartitionStart(db);
+        if (from < oldest) {
+            aggregateArchive(*series, from, std::min(to, oldest - 1), bucket, offset, buckets);
+            from = oldest;
+        }
+    }
+    aggregateRaw(db, sensor, from, to, bucket, offset, buckets);
+}
+
+// Корзины из целых часов на участке [from, to] с постоянным смещением offset. Корзины,
+// кратные суткам, читаются из daily_avg, кратные часу - из hourly_avg. Из таблицы средних
+// берутся только интервалы, целиком лежащие в [from, to]; неполные час/сутки на краях
+// участка агрегируются по сырым измерениям. Начала корзин - со смещением участка.
+void aggregateHours(DbConnection& db, int sensor, std::time_t from, std::time_t to,
+                    long bucket, long offset, std::string& source, std::vector<Bucket>& buckets) {
+    // Интервалы таблицы средних внутри периода: [summaryFrom, summaryTo] - начала
+    // первого и последнего целого часа/суток
+    bool daily = bucket % 86400 == 0;
+    auto next = [daily](std::time_t t) { return daily ? storage::nextDayStart(t) : t + 3600; };
+    std::time_t summaryFrom = daily ? storage::dayStart(from) : storage::hourStart(from);
+    if (summaryFrom < from) {
+        summaryFrom = next(summaryFrom);
+    }
+    std::time_t summaryTo = daily ? storage::dayStart(to) : storage::hourStart(to);
+    if (next(summaryTo) - 1 > to) {
+        summaryTo = daily ? storage::dayStart(summaryTo - 1) : summaryTo - 3600;
+    }
+    if (summaryFrom > summaryTo) {
+        aggregateDetail(db, sensor, from, to, bucket, offset, buckets);
+        return;
+    }
+
+    // Корзины приходят по возрастанию: неполный интервал в начале, средние, хвост
+    std::vector<Bucket> summary;
+    std::time_t last = daily
+        ? aggregateSummary(db, sensor, "daily_avg", "day_epoch", summaryFrom, summaryTo, bucket, offset, summary)
+        : aggregateSummary(db, sensor, "hourly_avg", "hour_epoch", summaryFrom, summaryTo, bucket, offset, summary);
+    if (last < 0) {
+        aggregateDetail(db, sensor, from, to, bucket, offset, buckets);
+        return;
+    }
+    source = daily ? "daily" : "hourly";
+
+    // Все, что позже последнего усредненного интервала, логгер еще не усреднил
+    std::time_t tailFrom = std::max(summaryFrom, std::min(next(summaryTo), next(last)));
+    aggregateDetail(db, sensor, from, summaryFrom - 1, bucket, offset, buckets);
+    for (const auto& b : summary) {
+        appendBucket(buckets, b);
+    }
+    aggregateDetail(db, sensor, tailFrom, to, bucket, offset, buckets);
+}
+
+// Прореживание периода по корзинам размера bucket секунд. Корзины из целых часов
+// выравниваются по местным часам и суткам и после перехода на летнее/зимнее время: период
+// делится на участки с постоянным смещением, а начало корзины переводится из местного
+// времени с тем смещением, что действует в ее начале (сутки перехода - 23 или 25 часов).
+// Остальные корзины агрегируются по сырым измерениям с одним смещением от начала периода.
+// source получает имя основного источника ("raw", "hourly", "daily").
+std::vector<Bucket> getBuckets(DbConnection& db, int sensor, std::time_t from, std::time_t to,
+                               long bucket, std::string& source) {
+    std::vector<Bucket> buckets;
+    source = "raw";
+
+    if (bucket % 3600 != 0) {
+        aggregateDetail(db, sensor, from, to, bucket, storage::utcOffset(from), buckets);
+        return buckets;
+    }
+
+    std::vector<Bucket> part;
+    for (const auto& span : offsetSpans(from, to)) {
+        part.clear();
+        aggregateHours(db, sensor, span.from, span.to, bucket, span.offset, source, part);
+        for (Bucket b : part) {
+            // Корзина, начавшаяся до перехода, начинается по прежнему смещению
+            if (storage::utcOffset(b.start) != span.offset) {
+                b.start = storage::localToEpoch(b.start + span.offset);
+            }
+            appendBucket(buckets, b);
+        }
+    }
+    return buckets;
+}
+
+// Прореживание Largest-Triangle-Three-Buckets: сохраняет форму графика, оставляя
+// из каждого интервала точку с наибольшей площадью треугольника с соседями
+std::vector<Measurement> downsampleLttb(const std::vector<Measurement>& data, size_t threshold) {
+    if (threshold < 3 || data.size() <= threshold) {
+        return data;
+    }
+
+    std::vector<Measurement> sampled;
+    sampled.reserve(threshold);
+    sampled.push_back(data.front());
+
+    double every = static_cast<double>(data.size() - 2) / (threshold - 2);
+    size_t a = 0;
+    for (size_t i = 0; i < threshold - 2; ++i) {
+        // Среднее следующего интервала - третья вершина треугольника
+        size_t nextStart = static_cast<size_t>((i + 1) * every) + 1;
+        size_t nextEnd = std::min(static_cast<size_t>((i + 2) * every) + 1, data.size());
+        double avgX = 0, avgY = 0;
+        for (size_t j = nextStart; j < nextEnd; ++j) {
+            avgX += static_cast<double>(data[j].epoch);
+            avgY += data[j].temperature;
+        }
+        size_t nextCount = nextEnd > nextStart ? nextEnd - nextStart : 1;
+        avgX /= nextCount;
+        avgY /= nextCount;
+
+        size_t rangeStart = static_cast<size_t>(i * every) + 1;
+        size_t rangeEnd = static_cast<size_t>((i + 1) * every) + 1;
+        double ax = static_cast<double>(data[a].epoch);
+        double ay = data[a].temperature;
+        double maxArea = -1;
+        size_t chosen = rangeStart;
+        for (size_t j = rangeStart; j < rangeEnd; ++j) {
+            double area = std::abs((ax - avgX) * (data[j].temperature - ay) -
+                                   (ax - static_cast<double>(data[j].epoch)) * (avgY - ay));
+            if (area > maxArea) {
+                maxArea = area;
+                chosen = j;
+            }
+        }
+        sampled.push_back(data[chosen]);
+        a = chosen;
+    }
+
+    sampled.push_back(data.back());
+    return sampled;
+}
+
+// Генерирование JSON ответа
+std::string generateJsonResponse(const std::string& data) {
+    return data;
+}
+
+// Чтение статического файла
+std::string readStaticFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return "";
+    }
+    
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string getContentType(const std::string& filename) {
+    if (filename.find(".html") != std::string::npos) return "text/html";
+    if (filename.find(".css") != std::string::npos) return "text/css";
+    if (filename.find(".js") != std::string::npos) return "application/javascript";
+    if (filename.find(".json") != std::string::npos) return "application/json";
+    if (filename.find(".png") != std::string::npos) return "image/png";
+    if (filename.find(".jpg") != std::string::npos) return "image/jpeg";
+    if (filename.find(".gif") != std::string::npos) return "image/gif";
+    if (filename.find(".svg") != std::string::npos) return "image/svg+xml";
+    return "text/plain";
+}
+
+// Парсинг HTTP запроса и получение пути с параметрами
+std::pair<std::string, std::string> parseHttpRequest(const std::string& request) {
+    std::istringstream iss(request);
+    std::string method, path, version;
+    iss >> method >> path >> version;
+    
+    // Отделяем путь от query string
+    size_t queryPos = path.find('?');
+    std::string queryString = (queryPos != std::string::npos) ? path.substr(queryPos + 1) : "";
+    std::string cleanPath = (queryPos != std::string::npos) ? path.substr(0, queryPos) : path;
+    
+    return {cleanPath, queryString};
+}
+
+// Декодирование %XX и '+' в параметрах запроса
+std::string urlDecode(const std::string& s) {
+    std::string result;
+    result.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size() &&
+            std::isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+            result += static_cast<char>(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else if (s[i] == '+') {
+            result += ' ';
+        } else {
+            result += s[i];
+        }
+    }
+    return result;
+}
+
+// Значение параметра name из query string (пустая строка, если параметра нет)
+std::string getQueryParam(const std::string& query, const std::string& name) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+
+        size_t eq = query.find('=', pos);
+        if (eq != std::string::npos && eq < end && query.compare(pos, eq - pos, name) == 0) {
+            return urlDecode(query.substr(eq + 1, end - eq - 1));
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+// Период запроса /api/stats: параметры start и end, по умолчанию без ограничений
+void parseStatsRange(const std::string& queryString, std::time_t& startTime, std::time_t& endTime) {
+    startTime = 0;
+    endTime = std::numeric_limits<std::time_t>::max();
+
+    std::string startParam = getQueryParam(queryString, "start");
+    std::string endParam = getQueryParam(queryString, "end");
+    if (!startParam.empty()) storage::parseTime(startParam, startTime);
+    if (!endParam.empty()) storage::parseTime(endParam, endTime);
+}
+
+// Датчик запроса: параметр sensor (целое число), без него - датчик по умолчанию
+bool parseSensor(const std::string& queryString, int& sensor) {
+    sensor = storage::DEFAULT_SENSOR;
+    std::string param = getQueryParam(queryString, "sensor");
+    if (param.empty()) return true;
+    char* end;
+    errno = 0;
+    long value = std::strtol(param.c_str(), &end, 10);
+    if (*end != '\0' || errno != 0 || value < INT_MIN || value > INT_MAX) return false;
+    sensor = static_cast<int>(value);
+    return true;
+}
+
+// Обработчик HTTP запроса
+std::string handleHttpRequest(DbConnection& db, const std::string& request) {
+    auto [path, queryString] = parseHttpRequest(request);
+    
+    std::string response;
+
+    // Буфер последних измерений хранит только датчик по умолчанию
+    int sensor;
+    if (!parseSensor(queryString, sensor)) {
+        return "{\"error\":\"Invalid sensor\"}";
+    }
+    bool hot = sensor == storage::DEFAULT_SENSOR;
+    
+    if (path.find("/api/current") != std::string::npos) {
+        // API: текущая температура
+        std::time_t timestamp;
+        double temperature;
+        
+        if ((hot && recentSamples.last(timestamp, temperature)) ||
+            getLastTemperature(db, sensor, timestamp, temperature)) {
+            json::Writer w(response);
+            json::writeMeasurement(w, timestamp, temperature);
+        } else {
+            response = "{\"error\":\"No data\"}";
+        }
+    }
+    else if (path.find("/api/sensors") != std::string::npos) {
+        // API: номера датчиков с измерениями за последние сутки
+        json::Writer w(response);
+        w.raw("{\"sensors\":[");
+        auto sensors = getSensors(db);
+        for (size_t i = 0; i < sensors.size(); ++i) {
+            if (i > 0) w.raw(',');
+            w.integer(sensors[i]);
+        }
+        w.raw("]}");
+    }
+    else if (path.find("/api/stats") != std::string::npos) {
+        // API: статистика за период
+        std::time_t startTime, endTime;
+        parseStatsRange(queryString, startTime, endTime);
+        
+        // Прореживание: bucket - размер интервала в секундах, max_points - предельное
+        // число точек (размер интервала подбирается), mode=lttb - отбор точек LTTB
+        long bucket = std::atol(getQueryParam(queryString, "bucket").c_str());
+        long maxPoints = std::atol(getQueryParam(queryString, "max_points").c_str());
+        std::string mode = getQueryParam(queryString, "mode");
+
+        if (mode != "lttb" && (bucket > 0 || maxPoints > 0)) {
+            // Период сужается до первого и последнего измерения датчика в нем, иначе размер
+            // интервала для max_points считался бы от начала эпохи или по целым суткам секций
+            std::time_t first = 0, last = 0;
+            bool hasData = startTime <= endTime && getDataBounds(db, sensor, startTime, endTime, first, last);
+            if (hasData) {
+                startTime = first;
+                endTime = last;
+            } else {
+                endTime = startTime;
+            }
+            if (bucket <= 0) {
+                bucket = chooseBucket(startTime, endTime, maxPoints);
+            }
+
+            std::string source = "raw";
+            std::vector<Bucket> buckets;
+            if (hasData && startTime <= endTime) {
+                buckets = getBuckets(db, sensor, startTime, endTime, bucket, source);
+            }
+
+            json::Writer w(response);
+            json::Summary summary;
+            w.raw("{\"bucket\":");
+            w.integer(bucket);
+            w.raw(",\"source\":\"");
+            w.raw(source.c_str());
+            w.raw("\",\"data\":[");
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                const Bucket& b = buckets[i];
+                if (i > 0) w.raw(',');
+                // Первая корзина может начинаться раньше периода: метка не раньше его начала
+                w.raw("{\"timestamp\":\"");
+                w.time(std::max(b.start, startTime));
+                w.raw("\",\"temperature\":");
+                w.number(b.sum / b.count);
+                w.raw(",\"min\":");
+                w.number(b.minValue);
+                w.raw(",\"max\":");
+                w.number(b.maxValue);
+                w.raw(",\"count\":");
+                w.integer(b.count);
+                w.raw('}');
+                summary.add(b.minValue, b.maxValue, b.sum, b.count);
+            }
+            w.raw("],");
+            summary.write(w);
+            w.raw('}');
+            return response;
+        }
+
+        json::Writer w(response);
+        json::Summary summary;
+        w.raw("{\"data\":[");
+        if (mode == "lttb") {
+            // Для LTTB сводка считается по всем измерениям, а в ответ идут только отобранные точки
+            auto stats = getStatistics(db, sensor, startTime, endTime);
+            auto points = downsampleLttb(stats, maxPoints > 0 ? maxPoints : 1000);
+            for (size_t i = 0; i < points.size(); ++i) {
+                if (i > 0) w.raw(',');
+                json::writeMeasurement(w, points[i].epoch, points[i].temperature);
+            }
+            for (const auto& m : stats) {
+                summary.add(m.temperature);
+            }
+        } else {
+            // Строки сериализуются прямо из буфера последних измерений или курсора,
+            // сводка - в том же проходе
+            auto visit = [&](std::time_t epoch, double temperature) {
+                if (summary.count > 0) w.raw(',');
+                json::writeMeasurement(w, epoch, temperature);
+                summary.add(temperature);
+            };
+            if (!hot || !recentSamples.forEach(startTime, endTime, visit)) {
+                forEachMeasurement(db, sensor, startTime, endTime, visit);
+            }
+        }
+        w.raw("],");
+        summary.write(w);
+        w.raw('}');
+    }
+    else {
+        response = "{\"error\":\"Not found\"}";
+    }
+    
+    return response;
+}
+
+
+// Таймаут простоя keep-alive соединения, секунды
+int idleTimeoutSec = 15;
+
+// Максимальный размер запроса (заголовки + тело)
+const size_t MAX_REQUEST_SIZE = 64 * 1024;
+
+// Сравнение без учета регистра (имена заголовков HTTP)
+bool equalsIgnoreCase(const std::string& a, size_t pos, const char* b) {
+    size_t len = std::strlen(b);
+    if (pos + len > a.size()) return false;
+    for (size_t i = 0; i < len; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[pos + i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Значение заголовка запроса, расположенного в buffer с позиции start
+// (пустая строка, если заголовка нет)
+std::string getHeader(const std::string& buffer, size_t start, size_t headersEnd, const char* name) {
+    size_t nameLen = std::strlen(name);
+    size_t pos = buffer.find("\r\n", start);
+    while (pos != std::string::npos && pos < headersEnd) {
+        size_t lineStart = pos + 2;
+        size_t lineEnd = buffer.find("\r\n", lineStart);
+        if (lineEnd == std::string::npos || lineEnd > headersEnd) lineEnd = headersEnd;
+
+        if (equalsIgnoreCase(buffer, lineStart, name) &&
+            lineStart + nameLen < lineEnd && buffer[lineStart + nameLen] == ':') {
+            size_t valueStart = lineStart + nameLen + 1;
+            while (valueStart < lineEnd && buffer[valueStart] == ' ') valueStart++;
+            return buffer.substr(valueStart, lineEnd - valueStart);
+        }
+        pos = lineEnd;
+    }
+    return "";
+}
+
+// Разбиение входного потока на запросы: заголовки до \r\n\r\n плюс тело длиной Content-Length.
+// Возвращает длину полного запроса, начинающегося с позиции start, 0 если запрос еще
+// не получен целиком, std::string::npos если запрос некорректен или слишком велик.
+size_t frameHttpRequest(const std::string& buffer, size_t start) {
+    size_t headersEnd = buffer.find("\r\n\r\n", start);
+    if (headersEnd == std::string::npos) {
+        return buffer.size() - start > MAX_REQUEST_SIZE ? std::string::npos : 0;
+    }
+
+    size_t bodyLength = 0;
+    std::string contentLength = getHeader(buffer, start, headersEnd, "Content-Length");
+    if (!contentLength.empty()) {
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(contentLength.c_str(), &end, 10);
+        if (end == contentLength.c_str() || value > MAX_REQUEST_SIZE) {
+            return std::string::npos;
+        }
+        bodyLength = static_cast<size_t>(value);
+    }
+
+    size_t total = headersEnd + 4 + bodyLength - start;
+    if (total > MAX_REQUEST_SIZE) return std::string::npos;
+    return buffer.size() - start >= total ? total : 0;
+}
+
+// Запрос по протоколу HTTP/1.1 (строка запроса содержит версию)
+bool isHttp11(const std::string& request) {
+    size_t lineEnd = request.find("\r\n");
+    return request.substr(0, lineEnd).find("HTTP/1.1") != std::string::npos;
+}
+
+// Нужно ли сохранить соединение после ответа на запрос
+bool wantsKeepAlive(const std::string& request) {
+    size_t headersEnd = request.find("\r\n\r\n");
+    if (headersEnd == std::string::npos) return false;
+
+    bool http11 = isHttp11(request);
+
+    std::string connection = getHeader(request, 0, headersEnd, "Connection");
+    if (equalsIgnoreCase(connection, 0, "close")) return false;
+    if (equalsIgnoreCase(connection, 0, "keep-alive")) return true;
+    // HTTP/1.1 по умолчанию держит соединение, HTTP/1.0 - нет
+    return http11;
+}
+
+// Заголовки HTTP ответа; fields - дополнительные строки заголовка, каждая с \r\n
+// (Content-Length или Transfer-Encoding, ETag и т.п.)
+std::string buildHttpHeaders(const std::string& contentType, bool keepAlive, const std::string& fields,
+                             const char* status = "200 OK") {
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\n"
+             << "Content-Type: " << contentType << "; charset=utf-8\r\n"
+             << fields
+             << "Access-Control-Allow-Origin: *\r\n"
+             << "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+             << "Access-Control-Allow-Headers: Content-Type\r\n";
+    if (keepAlive) {
+        response << "Connection: keep-alive\r\n"
+                 << "Keep-Alive: timeout=" << idleTimeoutSec << "\r\n";
+    } else {
+        response << "Connection: close\r\n";
+    }
+    response << "\r\n";
+    return response.str();
+}
+
+// Формирование полного HTTP ответа
+std::string buildHttpResponse(const std::string& body, const std::string& contentType = "application/json",
+                              bool keepAlive = false) {
+    return buildHttpHeaders(contentType, keepAlive,
+                            "Content-Length: " + std::to_string(body.length()) + "\r\n") + body;
+}
+
+// Обработка запроса к API
+std::string processRequest(DbConnection& db, const std::string& request, bool keepAlive) {
+    return buildHttpResponse(handleHttpRequest(db, request), "application/json", keepAlive);
+}
+
+// Кэш статических файлов. Файлы читаются один раз при запуске (и заново при изменении
+// каталога, см. watchAssets); для каждого заранее готовы ETag, сжатые варианты тела
+// (gzip, brotli) и заголовки ответов. Снимок кэша неизменяем: обработчик берет
+// shared_ptr на текущий снимок и ставит в очередь отправки ссылки на его данные без
+// копирования, перезагрузка атомарно подменяет снимок целиком.
+
+// Тело файла в одной кодировке с готовыми заголовками ответа 200
+struct AssetVariant {
+    std::string encoding;    // "" - без сжатия, "gzip", "br"
+    std::string body;
+    std::string headers[2];  // [0] - Connection: close, [1] - keep-alive
+};
+
+struct Asset {
+    std::string etag;
+    std::vector<AssetVariant> variants;  // в порядке предпочтения, последний - без сжатия
+    std::string notModified[2];          // ответ 304 на совпавший If-None-Match
+};
+
+struct AssetSnapshot {
+    std::unordered_map<std::string, Asset> files;  // по имени файла
+};
+
+// Отдаваемые файлы: путь запроса -> имя файла в каталоге статики
+const std::pair<const char*, const char*> STATIC_FILES[] = {
+    {"/", "index.html"},
+    {"/index.html", "index.html"},
+    {"/style.css", "style.css"},
+    {"/script.js", "script.js"},
+};
+
+// Каталог статических файлов
+std::string staticDir = ".";
+
+// Текущий снимок кэша (читается и подменяется через std::atomic_load/atomic_store)
+std::shared_ptr<const AssetSnapshot> assetSnapshot = std::make_shared<AssetSnapshot>();
+
+// ETag: хеш FNV-1a содержимого
+std::string makeEtag(const std::string& content) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+#ifdef HAVE_ZLIB
+std::string gzipCompress(const std::string& data) {
+    z_stream zs{};
+    // 15 + 16: окно 32 КБ и заголовок gzip вместо zlib
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+    std::string out(deflateBound(&zs, data.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : "";
+}
+#endif
+
+#ifdef HAVE_BROTLI
+std::string brotliCompress(const std::string& data) {
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    if (size == 0) return "";
+    std::string out(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &size, reinterpret_cast<uint8_t*>(&out[0]))) {
+        return "";
+    }
+    out.resize(size);
+    return out;
+}
+#endif
+
+// Сборка записи кэша: сжатые варианты добавляются, только если они меньше исходного
+Asset buildAsset(const std::string& filename, const std::string& content) {
+    Asset asset;
+    asset.etag = makeEtag(content);
+    std::string contentType = getContentType(filename);
+    std::string cacheFields = "ETag: " + asset.etag + "\r\n"
+                              "Cache-Control: no-cache\r\n"
+                              "Vary: Accept-Encoding\r\n";
+
+    std::vector<std::pair<std::string, std::string>> bodies;
+#ifdef HAVE_BROTLI
+    bodies.emplace_back("br", brotliCompress(content));
+#endif
+#ifdef HAVE_ZLIB
+    bodies.emplace_back("gzip", gzipCompress(content));
+#endif
+    bodies.emplace_back("", content);
+
+    for (auto& entry : bodies) {
+        bool identity = entry.first.empty();
+        if (!identity && (entry.second.empty() || entry.second.size() >= content.size())) {
+            continue;
+        }
+        AssetVariant variant;
+        variant.encoding = entry.first;
+        variant.body = std::move(entry.second);
+        std::string fields = "Content-Length: " + std::to_string(variant.body.size()) + "\r\n" + cacheFields;
+        if (!identity) {
+            fields += "Content-Encoding: " + variant.encoding + "\r\n";
+        }
+        for (int keepAlive = 0; keepAlive < 2; ++keepAlive) {
+            variant.headers[keepAlive] = buildHttpHeaders(contentType, keepAlive, fields);
+        }
+        asset.variants.push_back(std::move(variant));
+    }
+
+    for (int keepAlive = 0; keepAlive < 2; ++keepAlive) {
+        asset.notModified[keepAlive] = buildHttpHeaders(contentType, keepAlive,
+                                                        "Content-Length: 0\r\n" + cacheFields,
+                                                        "304 Not Modified");
+    }
+    return asset;
+}
+
+// Чтение файлов каталога статики в новый снимок и его публикация
+void reloadAssets() {
+    auto snapshot = std::make_shared<AssetSnapshot>();
+    size_t total = 0;
+    std::vector<std::string> seen;  // один файл может отдаваться по нескольким путям
+    for (const auto& entry : STATIC_FILES) {
+        std::string filename = entry.second;
+        if (std::find(seen.begin(), seen.end(), filename) != seen.end()) continue;
+        seen.push_back(filename);
+
+        std::string content = readStaticFile(staticDir + "/" + filename);
+        if (content.empty()) {
+            std::cerr << "Static file not found: " << staticDir << "/" << filename << std::endl;
+            continue;
+        }
+        total += content.size();
+        snapshot->files.emplace(filename, buildAsset(filename, content));
+    }
+    std::atomic_store(&assetSnapshot, std::shared_ptr<const AssetSnapshot>(std::move(snapshot)));
+    std::cout << "Static files loaded from " << staticDir << " (" << total << " bytes)" << std::endl;
+}
+
+// Является ли имя файлом из списка статики
+bool isStaticFile(const char* filename) {
+    for (const auto& entry : STATIC_FILES) {
+        if (std::strcmp(entry.second, filename) == 0) return true;
+    }
+    return false;
+}
+
+#ifdef __linux__
+// Перезагрузка кэша при изменении файлов каталога статики (inotify).
+// Редакторы часто сохраняют через временный файл и переименование, поэтому кроме
+// IN_CLOSE_WRITE отслеживается IN_MOVED_TO.
+void watchAssets() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+    if (inotify_add_watch(fd, staticDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+        std::cerr << "inotify: cannot watch " << staticDir << std::endl;
+        close(fd);
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (running) {
+        pollfd pfd{fd, POLLIN, 0};
+        // Таймаут нужен, чтобы проверять флаг running
+        if (poll(&pfd, 1, 1000) <= 0) continue;
+
+        bool changed = false;
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + n;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0 && isStaticFile(event->name)) {
+                    changed = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            reloadAssets();
+        }
+    }
+    close(fd);
+}
+#endif
+
+// Принимает ли клиент кодировку: есть в Accept-Encoding и не отключена через q=0
+bool acceptsEncoding(const std::string& header, const std::string& encoding) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) end = header.size();
+        size_t tokenStart = header.find_first_not_of(" \t", pos);
+        if (tokenStart < end) {
+            size_t tokenEnd = std::min(header.find(';', tokenStart), end);
+            while (tokenEnd > tokenStart && (header[tokenEnd - 1] == ' ' || header[tokenEnd - 1] == '\t')) {
+                tokenEnd--;
+            }
+            if (tokenEnd - tokenStart == encoding.size() &&
+                equalsIgnoreCase(header, tokenStart, encoding.c_str())) {
+                size_t q = header.find("q=", tokenEnd);
+                return q >= end || std::strtod(header.c_str() + q + 2, nullptr) > 0;
+            }
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// Потоковый ответ /api/stats (Transfer-Encoding: chunked). Курсор SQLite читается
+// порциями: строки сериализуются в буфер фрагмента фиксированного размера, и следующий
+// фрагмент формируется только после отправки предыдущего, поэтому память не зависит
+// от размера периода. Сводка считается в том же проходе и дописывается в конце.
+// Архив (если есть) читается перед секциями, в памяти - один распакованный блок.
+class StatsStream {
+public:
+    // Размер полезной нагрузки одного фрагмента
+    static const size_t CHUNK_SIZE = 16 * 1024;
+
+    StatsStream(DbConnection& db, int sensor, std::time_t startTime, std::time_t endTime, bool keepAlive)
+        : db(db.handle()), sensor(sensor), startTime(startTime), endTime(endTime), keepAlive(keepAlive),
+          writer(chunk) {
+        sqlite3_stmt* partitionsStmt = db.prepare(storage::PARTITIONS_IN_RANGE_SQL);
+        if (partitionsStmt) {
+            partitions = storage::partitionsInRange(partitionsStmt, startTime, endTime);
+        }
+        // Начало периода раньше самой старой секции читается из архива, по блоку за раз
+        series = archives.get(sensor);
+        if (series) {
+            archiveEnd = std::min(endTime, oldestPartitionStart(db) - 1);
+            blockIndex = series->firstBlock(startTime);
+        }
+        chunk.reserve(CHUNK_SIZE + 256);
+    }
+
+    ~StatsStream() {
+        if (stmt) sqlite3_finalize(stmt);
+    }
+
+    StatsStream(const StatsStream&) = delete;
+    StatsStream& operator=(const StatsStream&) = delete;
+
+    // Дописывает в out очередной фрагмент ответа (первый вызов - вместе с заголовками).
+    // Возвращает false, когда ответ сформирован полностью, включая завершающий фрагмент.
+    bool next(std::string& out) {
+        if (!headersSent) {
+            out += buildHttpHeaders("application/json", keepAlive, "Transfer-Encoding: chunked\r\n");
+            chunk = "{\"data\":[";
+            headersSent = true;
+        }
+
+        while (chunk.size() < CHUNK_SIZE) {
+            if (archivePos < archiveCount) {
+                if (archiveTimes[archivePos] >= startTime && archiveTimes[archivePos] <= archiveEnd) {
+                    appendRow(archiveTimes[archivePos], archiveValues[archivePos]);
+                }
+                archivePos++;
+                continue;
+            }
+            if (series && decodeNextBlock()) {
+                continue;
+            }
+            if (!stmt && !openNextPartition()) {
+                appendSummary();
+                appendChunk(out);
+                out += "0\r\n\r\n";
+                return false;
+            }
+            if (sqlite3_step(stmt) != SQLITE_ROW) {
+                sqlite3_finalize(stmt);
+                stmt = nullptr;
+                continue;
+            }
+            appendRow(sqlite3_column_int64(stmt, 0), sqlite3_column_double(stmt, 1));
+        }
+
+        appendChunk(out);
+        return true;
+    }
+
+private:
+    sqlite3* db;
+    int sensor;
+    std::time_t startTime;
+    std::time_t endTime;
+    bool keepAlive;
+    std::vector<storage::Partition> partitions;
+    size_t partitionIndex = 0;
+    std::shared_ptr<const archive::Reader> series;
+    std::time_t archiveEnd = 0;
+    size_t blockIndex = 0;
+    std::vector<std::time_t> archiveTimes = std::vector<std::time_t>(archive::BLOCK_SAMPLES);
+    std::vector<double> archiveValues = std::vector<double>(archive::BLOCK_SAMPLES);
+    size_t archivePos = 0;
+    size_t archiveCount = 0;
+    // Собственный курсор, а не запрос из кэша: соединение цикла событий
+    // обслуживает другие запросы, пока этот ответ отправляется
+    sqlite3_stmt* stmt = nullptr;
+    std::string chunk;
+    json::Writer writer;  // пишет в chunk
+    json::Summary summary;
+    bool headersSent = false;
+
+    // Распаковка следующего блока архива, пересекающегося с периодом
+    bool decodeNextBlock() {
+        const auto& blocks = series->blocks();
+        while (blockIndex < blocks.size() && blocks[blockIndex].firstTime <= archiveEnd) {
+            const archive::Block& block = blocks[blockIndex++];
+            if (archive::decodeBlock(block, archiveTimes.data(), archiveValues.data())) {
+                archivePos = 0;
+                archiveCount = block.count;
+                return true;
+            }
+        }
+        series.reset();
+        return false;
+    }
+
+    bool openNextPartition() {
+        while (partitionIndex < partitions.size()) {
+            std::string sql = "SELECT epoch, temperature FROM " + partitions[partitionIndex++].name +
+                              " WHERE sensor = ? AND epoch >= ? AND epoch <= ? ORDER BY epoch";
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+                stmt = nullptr;
+                continue;
+            }
+            sqlite3_bind_int(stmt, 1, sensor);
+            sqlite3_bind_int64(stmt, 2, startTime);
+            sqlite3_bind_int64(stmt, 3, endTime);
+            return true;
+        }
+        return false;
+    }
+
+    void appendRow(std::time_t epoch, double temperature) {
+        if (summary.count > 0) writer.raw(',');
+        json::writeMeasurement(writer, epoch, temperature);
+        summary.add(temperature);
+    }
+
+    void appendSummary() {
+        writer.raw("],");
+        summary.write(writer);
+        writer.raw('}');
+    }
+
+    // Оформление накопленных данных как фрагмента chunked: размер в hex, данные, CRLF
+    void appendChunk(std::string& out) {
+        if (chunk.empty()) return;
+        char size[16];
+        auto result = std::to_chars(size, size + sizeof(size), chunk.size(), 16);
+        out.append(size, result.ptr - size);
+        out += "\r\n";
+        out += chunk;
+        out += "\r\n";
+        chunk.clear();
+    }
+};
+
+// Потоковый ответ для запроса сырых данных /api/stats (nullptr - ответ формируется целиком).
+// Прореженные ответы и периоды из буфера последних измерений малы, а HTTP/1.0
+// не поддерживает chunked.
+std::unique_ptr<StatsStream> openStatsStream(DbConnection& db, const std::string& request, bool keepAlive) {
+    if (!isHttp11(request)) return nullptr;
+
+    auto [path, queryString] = parseHttpRequest(request);
+    if (path.find("/api/stats") == std::string::npos) return nullptr;
+    if (!getQueryParam(queryString, "bucket").empty() ||
+        !getQueryParam(queryString, "max_points").empty() ||
+        !getQueryParam(queryString, "mode").empty()) {
+        return nullptr;
+    }
+
+    int sensor;
+    if (!parseSensor(queryString, sensor)) return nullptr;
+    std::time_t startTime, endTime;
+    parseStatsRange(queryString, startTime, endTime);
+    if (sensor == storage::DEFAULT_SENSOR && recentSamples.covers(startTime)) return nullptr;
+    return std::make_unique<StatsStream>(db, sensor, startTime, endTime, keepAlive);
+}
+
+// Очередь исходящих данных соединения. Динамические ответы дописываются в собственный
+// буфер (buffer()), статические файлы - ссылками на данные снимка кэша (appendRef):
+// снимок удерживается, пока фрагмент не отправлен. Отправка - одним writev по
+// нескольким фрагментам (заголовки и тело уходят без склейки в один буфер).
+class OutputQueue {
+public:
+    // Строка для дописывания данных в конец очереди
+    std::string& buffer() {
+        if (segments.empty() || segments.back().owner) {
+            segments.emplace_back();
+        }
+        return segments.back().owned;
+    }
+
+    // Ссылка на неизменяемые данные, которые живут, пока жив owner
+    void appendRef(const std::string& data, const std::shared_ptr<const void>& owner) {
+        if (data.empty()) return;
+        Segment segment;
+        segment.data = data.data();
+        segment.size = data.size();
+        segment.owner = owner;
+        segments.push_back(std::move(segment));
+    }
+
+    bool empty() const {
+        for (size_t i = 0; i < segments.size(); ++i) {
+            if (segments[i].length() > (i == 0 ? offset : 0)) return false;
+        }
+        return true;
+    }
+
+    // Одна попытка отправки: число отправленных байт или -1 (причина в errno)
+    ssize_t writeTo(int fd) {
+#ifdef _WIN32
+        while (!segments.empty() && segments.front().length() == offset) {
+            segments.pop_front();
+            offset = 0;
+        }
+        if (segments.empty()) return 0;
+        const Segment& front = segments.front();
+        ssize_t n = ::send(fd, front.begin() + offset, static_cast<int>(front.length() - offset), 0);
+#else
+        iovec iov[MAX_IOV];
+        int count = 0;
+        for (size_t i = 0; i < segments.size() && count < MAX_IOV; ++i) {
+            size_t skip = i == 0 ? offset : 0;
+            if (segments[i].length() == skip) continue;
+            iov[count].iov_base = const_cast<char*>(segments[i].begin() + skip);
+            iov[count].iov_len = segments[i].length() - skip;
+            count++;
+        }
+        if (count == 0) {
+            segments.clear();
+            offset = 0;
+            return 0;
+        }
+        ssize_t n = writev(fd, iov, count);
+#endif
+        if (n > 0) consume(n);
+        return n;
+    }
+
+private:
+    static const int MAX_IOV = 16;
+
+    struct Segment {
+        std::string owned;
+        const char* data = nullptr;
+        size_t size = 0;
+        std::shared_ptr<const void> owner;  // nullptr - данные в owned
+
+        const char* begin() const { return owner ? data : owned.data(); }
+        size_t length() const { return owner ? size : owned.size(); }
+    };
+
+    std::deque<Segment> segments;
+    size_t offset = 0;  // отправленная часть первого фрагмента
+
+    void consume(size_t n) {
+        while (!segments.empty()) {
+            size_t left = segments.front().length() - offset;
+            if (n < left) {
+                offset += n;
+                return;
+            }
+            n -= left;
+            offset = 0;
+            segments.pop_front();
+        }
+    }
+};
+
+// Ответ из кэша статики: 304 при совпадении If-None-Match, иначе лучший из
+// принимаемых клиентом вариантов. Возвращает false, если путь не статический.
+bool serveAsset(const std::string& request, bool keepAlive, OutputQueue& out) {
+    std::string path = parseHttpRequest(request).first;
+    const char* filename = nullptr;
+    for (const auto& entry : STATIC_FILES) {
+        if (path == entry.first) filename = entry.second;
+    }
+    if (!filename) return false;
+
+    std::shared_ptr<const AssetSnapshot> snapshot = std::atomic_load(&assetSnapshot);
+    auto it = snapshot->files.find(filename);
+    if (it == snapshot->files.end()) return false;
+    const Asset& asset = it->second;
+
+    size_t headersEnd = request.find("\r\n\r\n");
+    std::string ifNoneMatch = getHeader(request, 0, headersEnd, "If-None-Match");
+    if (!ifNoneMatch.empty() &&
+        (ifNoneMatch.find(asset.etag) != std::string::npos || ifNoneMatch == "*")) {
+        out.appendRef(asset.notModified[keepAlive], snapshot);
+        return true;
+    }
+
+    std::string acceptEncoding = getHeader(request, 0, headersEnd, "Accept-Encoding");
+    for (const auto& variant : asset.variants) {
+        if (variant.encoding.empty() || acceptsEncoding(acceptEncoding, variant.encoding)) {
+            out.appendRef(variant.headers[keepAlive], snapshot);
+            out.appendRef(variant.body, snapshot);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Подписка соединения на новые измерения (/api/stream)
+struct Subscription {
+    enum Mode { None, Events, LongPoll };
+    Mode mode = None;
+    std::time_t lastEpoch = 0;  // последнее измерение, уже отправленное клиенту
+    bool keepAlive = false;     // long-poll: сохранить соединение после ответа
+    std::chrono::steady_clock::time_point deadline;  // long-poll: пустой ответ по истечении
+};
+
+// Время ожидания long-poll запроса без новых данных, секунды
+const int LONG_POLL_TIMEOUT_SEC = 25;
+
+// Период комментария-пинга в потоке SSE без новых данных, секунды
+const int SSE_HEARTBEAT_SEC = 15;
+
+// События SSE для измерений новее after. Возвращает время последнего добавленного
+// измерения (after, если новых нет). id события - epoch, браузер вернет его при
+// переподключении в Last-Event-ID.
+std::time_t appendSampleEvents(std::string& out, std::time_t after) {
+    json::Writer w(out);
+    std::time_t last = after;
+    recentSamples.forEachAfter(after, [&](std::time_t epoch, double temperature) {
+        w.raw("id: ");
+        w.integer(epoch);
+        w.raw("\ndata: ");
+        json::writeMeasurement(w, epoch, temperature);
+        w.raw("\n\n");
+        last = epoch;
+    });
+    return last;
+}
+
+// Ответ long-poll: {"data":[...]} с измерениями новее after (пустой список по таймауту)
+std::string longPollResponse(std::time_t after, bool keepAlive) {
+    std::string body;
+    json::Writer w(body);
+    w.raw("{\"data\":[");
+    bool first = true;
+    recentSamples.forEachAfter(after, [&](std::time_t epoch, double temperature) {
+        if (!first) w.raw(',');
+        json::writeMeasurement(w, epoch, temperature);
+        first = false;
+    });
+    w.raw("]}");
+    return buildHttpResponse(body, "application/json", keepAlive);
+}
+
+// Запрос /api/stream. Без параметров - поток SSE (с измерений после Last-Event-ID
+// или с последнего измерения), с since=YYYY-MM-DDTHH:MM:SS - long-poll: ответ сразу,
+// если есть измерения новее since, иначе при появлении первого из них или по таймауту.
+// Возвращает false, если запрос к другому пути.
+bool openSubscription(const std::string& request, bool keepAlive, OutputQueue& out,
+                      Subscription& subscription) {
+    auto [path, queryString] = parseHttpRequest(request);
+    if (path.find("/api/stream") == std::string::npos) return false;
+
+    if (!recentSamples.enabled()) {
+        out.buffer() += buildHttpResponse("{\"error\":\"Stream disabled\"}", "application/json", keepAlive);
+        return true;
+    }
+    // Поток - из буфера последних измерений, а в нем только датчик по умолчанию
+    int sensor;
+    if (!parseSensor(queryString, sensor) || sensor != storage::DEFAULT_SENSOR) {
+        out.buffer() += buildHttpResponse("{\"error\":\"Stream is available for the default sensor only\"}",
+                                          "application/json", keepAlive);
+        return true;
+    }
+
+    std::time_t newest = 0;
+    double temperature;
+    bool hasData = recentSamples.last(newest, temperature);
+
+    std::string since = getQueryParam(queryString, "since");
+    if (!since.empty()) {
+        std::time_t after = 0;
+        storage::parseTime(since, after);
+        if (hasData && newest > after) {
+            out.buffer() += longPollResponse(after, keepAlive);
+            return true;
+        }
+        subscription.mode = Subscription::LongPoll;
+        subscription.lastEpoch = after;
+        subscription.keepAlive = keepAlive;
+        subscription.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(LONG_POLL_TIMEOUT_SEC);
+        return true;
+    }
+
+    // Поток SSE занимает соединение до его закрытия, длина тела не указывается
+    std::string& buffer = out.buffer();
+    buffer += buildHttpHeaders("text/event-stream", false, "Cache-Control: no-cache\r\n");
+    buffer += "retry: 3000\n\n";
+
+    size_t headersEnd = request.find("\r\n\r\n");
+    std::string lastEventId = getHeader(request, 0, headersEnd, "Last-Event-ID");
+    std::time_t after = 0;
+    if (!lastEventId.empty()) {
+        after = static_cast<std::time_t>(std::atoll(lastEventId.c_str()));
+    } else if (hasData) {
+        after = newest - 1;
+    }
+    subscription.mode = Subscription::Events;
+    subscription.lastEpoch = appendSampleEvents(buffer, after);
+    return true;
+}
+
+// Ответ на запрос с некорректным или слишком большим заголовком
+const char* BAD_REQUEST_RESPONSE =
+    "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+// Обработка всех полных запросов из буфера (конвейерная обработка, pipelining).
+// Ответы дописываются в out в порядке поступления запросов, обработанные байты
+// удаляются из in. Возвращает false, если после ответа соединение нужно закрыть.
+// На запросе с потоковым ответом обработка останавливается: ответ отдается через stream,
+// а следующие запросы обрабатываются повторным вызовом после его завершения.
+// Так же останавливается на подписке (/api/stream): поток SSE занимает соединение,
+// а запросы после long-poll ждут его ответа.
+bool processPipelined(DbConnection& db, std::string& in, OutputQueue& out,
+                      std::unique_ptr<StatsStream>& stream, Subscription& subscription) {
+    size_t consumed = 0;
+    bool keepOpen = true;
+
+    while (keepOpen) {
+        size_t length = frameHttpRequest(in, consumed);
+        if (length == std::string::npos) {
+            out.buffer() += BAD_REQUEST_RESPONSE;
+            keepOpen = false;
+            break;
+        }
+        if (length == 0) break;
+
+        std::string request = in.substr(consumed, length);
+        keepOpen = wantsKeepAlive(request);
+        consumed += length;
+
+        if (serveAsset(request, keepOpen, out)) continue;
+        if (openSubscription(request, keepOpen, out, subscription)) {
+            if (subscription.mode != Subscription::None) break;
+            continue;
+        }
+        stream = openStatsStream(db, request, keepOpen);
+        if (stream) break;
+        out.buffer() += processRequest(db, request, keepOpen);
     }
+
+    in.erase(0, consumed);
+    return keepOpen;
 }
 
-// Добавление измерения в БД
-bool addMeasurement(sqlite3* db, const std::string& timestamp, double temperature) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string sql = "INSERT OR REPLACE INTO measurements (timestamp, temperature) VALUES (?, ?)";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement" << std::endl;
-        return false;
+// Отправка всей очереди на блокирующий сокет
+bool sendHttpResponse(int client_socket, OutputQueue& out) {
+    while (!out.empty()) {
+        if (out.writeTo(client_socket) < 0) return false;
     }
-    
-    sqlite3_bind_text(stmt, 1, timestamp.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(stmt, 2, temperature);
-    
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    
-    return rc == SQLITE_DONE;
+    return true;
 }
 
-// Получение последней температуры
-bool getLastTemperature(sqlite3* db, std::string& timestamp, double& temperature) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::string sql = "SELECT timestamp, temperature FROM measurements ORDER BY created_at DESC LIMIT 1";
-    sqlite3_stmt* stmt;
-    
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return false;
-    }
-    
-    bool found = false;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        temperature = sqlite3_column_double(stmt, 1);
-        found = true;
+// Обработчик клиента (модель "поток на соединение")
+void handleClient(int client_socket, DbPool* pool) {
+    // Таймаут простоя: recv вернет ошибку, если клиент молчит дольше idleTimeoutSec
+#ifdef _WIN32
+    DWORD timeout = idleTimeoutSec * 1000;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = idleTimeoutSec;
+    timeout.tv_usec = 0;
+#endif
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    auto db = pool->acquire();
+    std::string in;
+    OutputQueue out;
+    std::unique_ptr<StatsStream> stream;
+    Subscription subscription;
+    char buffer[8192];
+    bool keepOpen = true;
+    bool failed = false;
+
+    while (keepOpen && !failed) {
+        ssize_t bytesRead = recv(client_socket, buffer, sizeof(buffer), 0);
+        if (bytesRead <= 0) break;
+        in.append(buffer, bytesRead);
+
+        while (!failed) {
+            keepOpen = processPipelined(*db, in, out, stream, subscription);
+            if (!sendHttpResponse(client_socket, out)) failed = true;
+
+            if (subscription.mode == Subscription::Events) {
+                // Поток SSE до разрыва соединения: пачка новых измерений или пинг
+                while (!failed && running) {
+                    auto heartbeat = std::chrono::steady_clock::now() + std::chrono::seconds(SSE_HEARTBEAT_SEC);
+                    if (sampleHub.wait(subscription.lastEpoch, heartbeat)) {
+                        subscription.lastEpoch = appendSampleEvents(out.buffer(), subscription.lastEpoch);
+                    } else {
+                        out.buffer() += ": ping\n\n";
+                    }
+                    if (!sendHttpResponse(client_socket, out)) failed = true;
+                }
+                failed = true;
+                break;
+            }
+            if (subscription.mode == Subscription::LongPoll) {
+                sampleHub.wait(subscription.lastEpoch, subscription.deadline);
+                out.buffer() += longPollResponse(subscription.lastEpoch, subscription.keepAlive);
+                subscription.mode = Subscription::None;
+                if (!sendHttpResponse(client_socket, out)) failed = true;
+                keepOpen = subscription.keepAlive;
+                if (!keepOpen) break;
+                continue;
+            }
+            if (!stream) break;
+
+            // Потоковый ответ: в буфере не больше одного фрагмента
+            while (stream && !failed) {
+                if (!stream->next(out.buffer())) stream.reset();
+                if (!sendHttpResponse(client_socket, out)) failed = true;
+            }
+            stream.reset();
+            if (!keepOpen) break;
+            // Запросы, пришедшие следом за потоковым, уже могут быть в буфере
+        }
     }
     
-    sqlite3_finalize(stmt);
-    return found;
+    pool->release(std::move(db));
+    close(client_socket);
 }
 
-// Получение статистики за период
-std::vector<Measurement> getStatistics(sqlite3* db, const std::string& startTime, const std::string& endTime) {
-    std::lock_guard<std::mutex> lock(db_mutex);
-    
-    std::vector<Measurement> results;
-    std::string sql = R"(
-        SELECT timestamp, temperature FROM measurements 
-        WHERE timestamp >= ? AND timestamp <= ? 
-        ORDER BY timestamp ASC
-    )";
+// Создание слушающего сокета
+int createListenSocket(int port, bool reusePort) {
+    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_socket < 0) {
+        std::cerr << "Socket creation error" << std::endl;
+        return -1;
+    }
     
-    sqlite3_stmt* stmt;
-    int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        return results;
+    // Разрешение переиспользования адреса
+    int opt = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+#ifdef SO_REUSEPORT
+    // Каждый поток-обработчик получает свой сокет, ядро распределяет соединения между ними
+    if (reusePort) {
+        setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, (const char*)&opt, sizeof(opt));
     }
+#endif
     
-    sqlite3_bind_text(stmt, 1, startTime.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(stmt, 2, endTime.c_str(), -1, SQLITE_STATIC);
+    // Привязка сокета
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
     
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Measurement m;
-        m.timestamp = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        m.temperature = sqlite3_column_double(stmt, 1);
-        results.push_back(m);
+    if (bind(server_socket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        std::cerr << "Bind failed" << std::endl;
+        close(server_socket);
+        return -1;
     }
     
-    sqlite3_finalize(stmt);
-    return results;
+    // Прослушивание
+    listen(server_socket, SOMAXCONN);
+    return server_socket;
 }
 
-// Генерирование JSON ответа
-std::string generateJsonResponse(const std::string& data) {
-    return data;
+// Основной цикл модели "поток на соединение"
+void runThreadPerConnection(int server_socket, DbPool& pool) {
+    while (running) {
+        struct sockaddr_in client_addr;
+        socklen_t addrlen = sizeof(client_addr);
+        
+        int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &addrlen);
+        if (client_socket < 0) {
+            if (!running) break;
+            std::cerr << "Accept failed" << std::endl;
+            continue;
+        }
+        
+        // Обработка клиента в отдельном потоке
+        std::thread(&handleClient, client_socket, &pool).detach();
+    }
 }
 
-// Чтение статического файла
-std::string readStaticFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        return "";
+#ifdef __linux__
+// Состояние соединения в цикле событий
+struct Connection {
+    std::string in;       // принятые, еще не обработанные байты
+    OutputQueue out;      // неотправленная часть ответов
+    std::unique_ptr<StatsStream> stream;  // незавершенный потоковый ответ
+    Subscription subscription;            // подписка на новые измерения (/api/stream)
+    bool closeAfterWrite = false;
+    std::chrono::steady_clock::time_point lastActive;
+};
+
+// Цикл событий на epoll (edge-triggered): один поток, свой слушающий сокет
+class EventLoop {
+public:
+    EventLoop(int listenFd, DbPool& pool) : listenFd(listenFd), pool(pool), db(pool.acquire()) {}
+
+    ~EventLoop() {
+        for (auto& entry : connections) {
+            close(entry.first);
+        }
+        // Курсоры потоковых ответов закрываются до возврата соединения с БД в пул
+        connections.clear();
+        if (eventFd >= 0) {
+            sampleHub.removeListener(eventFd);
+            close(eventFd);
+        }
+        if (epollFd >= 0) close(epollFd);
+        if (reserveFd >= 0) close(reserveFd);
+        close(listenFd);
+        pool.release(std::move(db));
     }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
 
-std::string getContentType(const std::string& filename) {
-    if (filename.find(".html") != std::string::npos) return "text/html";
-    if (filename.find(".css") != std::string::npos) return "text/css";
-    if (filename.find(".js") != std::string::npos) return "application/javascript";
-    if (filename.find(".json") != std::string::npos) return "application/json";
-    if (filename.find(".png") != std::string::npos) return "image/png";
-    if (filename.find(".jpg") != std::string::npos) return "image/jpeg";
-    if (filename.find(".gif") != std::string::npos) return "image/gif";
-    if (filename.find(".svg") != std::string::npos) return "image/svg+xml";
-    return "text/plain";
-}
+    void run() {
+        epollFd = epoll_create1(0);
+        if (epollFd < 0) {
+            std::cerr << "epoll_create1 failed" << std::endl;
+            return;
+        }
 
-// Парсинг HTTP запроса и получение пути с параметрами
-std::pair<std::string, std::string> parseHttpRequest(const std::string& request) {
-    std::istringstream iss(request);
-    std::string method, path, version;
-    iss >> method >> path >> version;
-    
-    // Отделяем путь от query string
-    size_t queryPos = path.find('?');
-    std::string queryString = (queryPos != std::string::npos) ? path.substr(queryPos + 1) : "";
-    std::string cleanPath = (queryPos != std::string::npos) ? path.substr(0, queryPos) : path;
-    
-    return {cleanPath, queryString};
-}
+        setNonBlocking(listenFd);
+        reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
 
-// Обработчик HTTP запроса
-std::string handleHttpRequest(sqlite3* db, const std::string& request) {
-    auto [path, queryString] = parseHttpRequest(request);
-    
-    std::string response;
-    
-    if (path.find("/api/current") != std::string::npos) {
-        // API: текущая температура
-        std::string timestamp;
-        double temperature;
-        
-        if (getLastTemperature(db, timestamp, temperature)) {
-            std::ostringstream json;
-            json << std::fixed << std::setprecision(2);
-            json << "{"
-                 << "\"timestamp\":\"" << timestamp << "\","
-                 << "\"temperature\":" << temperature
-                 << "}";
-            response = json.str();
-        } else {
-            response = "{\"error\":\"No data\"}";
+        // Сигнал о новых измерениях для подписчиков /api/stream
+        eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (eventFd >= 0) {
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.fd = eventFd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &ev);
+            sampleHub.addListener(eventFd);
+        }
+
+        epoll_event events[256];
+        auto lastSweep = std::chrono::steady_clock::now();
+        while (running) {
+            // Таймаут нужен, чтобы периодически проверять флаг running и простаивающие соединения
+            int n = epoll_wait(epollFd, events, 256, 1000);
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptAll();
+                    continue;
+                }
+                if (fd == eventFd) {
+                    onSamples();
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(fd);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    onReadable(fd);
+                }
+                if ((events[i].events & EPOLLOUT) && connections.count(fd)) {
+                    onWritable(fd);
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastSweep >= std::chrono::seconds(1)) {
+                closeIdle(now);
+                if (fdExhausted) {
+                    if (reserveFd < 0) reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    acceptAll();
+                }
+                lastSweep = now;
+            }
         }
     }
-    else if (path.find("/api/stats") != std::string::npos) {
-        // API: статистика за период
-        std::string startTime = "2000-01-01T00:00:00";
-        std::string endTime = "2100-01-01T00:00:00";
-        
-        // Парсим параметры (упрощенный парсер)
-        size_t startPos = queryString.find("start=");
-        size_t endPos = queryString.find("end=");
-        
-        if (startPos != std::string::npos) {
-            startTime = queryString.substr(startPos + 6, 19);
+
+private:
+    int listenFd;
+    int epollFd = -1;
+    int eventFd = -1;
+    int reserveFd = -1;             // запасной дескриптор на случай EMFILE в accept
+    bool fdExhausted = false;       // accept упирался в EMFILE/ENFILE
+    DbPool& pool;
+    std::unique_ptr<DbConnection> db;  // соединение этого цикла, без блокировок
+    std::unordered_map<int, Connection> connections;
+
+    static void setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    void acceptAll() {
+        while (true) {
+            int client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (client < 0) {
+                // EAGAIN: очередь принятых соединений исчерпана
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                // Клиент отключился до accept или сигнал: очередь еще не пуста
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EMFILE || errno == ENFILE) {
+                    // Нет свободных дескрипторов: соединение остается в очереди, а нового
+                    // события edge-triggered не будет. Освобождаем запасной дескриптор,
+                    // принимаем соединение и сразу закрываем, чтобы клиент не ждал впустую;
+                    // остаток очереди разбирается при ежесекундном обходе (run)
+                    if (!fdExhausted) {
+                        std::cerr << "accept: " << std::strerror(errno)
+                                  << ", dropping connections until descriptors are freed" << std::endl;
+                        fdExhausted = true;
+                    }
+                    if (reserveFd < 0) return;
+                    close(reserveFd);
+                    client = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+                    int error = errno;
+                    if (client >= 0) close(client);
+                    reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    if (client >= 0 || error == EINTR || error == ECONNABORTED) continue;
+                    return;
+                }
+                std::cerr << "accept: " << std::strerror(errno) << std::endl;
+                return;
+            }
+            fdExhausted = false;
+            int opt = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = client;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &ev) < 0) {
+                close(client);
+                continue;
+            }
+            Connection conn;
+            conn.lastActive = std::chrono::steady_clock::now();
+            connections[client] = std::move(conn);
         }
-        if (endPos != std::string::npos) {
-            endPos = queryString.find("&", endPos);
-            if (endPos == std::string::npos) {
-                endTime = queryString.substr(queryString.find("end=") + 4, 19);
-            } else {
-                endTime = queryString.substr(queryString.find("end=") + 4, endPos - (queryString.find("end=") + 4));
+    }
+
+    void onReadable(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+        conn.lastActive = std::chrono::steady_clock::now();
+
+        char buffer[8192];
+        bool peerClosed = false;
+        // В режиме edge-triggered читаем до EAGAIN
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                conn.in.append(buffer, n);
+                continue;
             }
+            if (n == 0) {
+                peerClosed = true;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                peerClosed = true;
+            }
+            break;
         }
-        
-        auto stats = getStatistics(db, startTime, endTime);
-        
-        std::ostringstream json;
-        json << std::fixed << std::setprecision(2);
-        json << "{\"data\":[";
-        
-        for (size_t i = 0; i < stats.size(); ++i) {
-            if (i > 0) json << ",";
-            json << "{"
-                 << "\"timestamp\":\"" << stats[i].timestamp << "\","
-                 << "\"temperature\":" << stats[i].temperature
-                 << "}";
+
+        if (conn.subscription.mode != Subscription::None && peerClosed) {
+            closeConnection(fd);
+            return;
         }
-        
-        // Вычисляем статистику
-        if (!stats.empty()) {
-            double sum = 0, minT = stats[0].temperature, maxT = stats[0].temperature;
-            for (const auto& m : stats) {
-                sum += m.temperature;
-                minT = std::min(minT, m.temperature);
-                maxT = std::max(maxT, m.temperature);
-            }
-            double avg = sum / stats.size();
-            
-            json << "],\"summary\":{"
-                 << "\"count\":" << stats.size() << ","
-                 << "\"average\":" << avg << ","
-                 << "\"min\":" << minT << ","
-                 << "\"max\":" << maxT
-                 << "}}";
-        } else {
-            json << "],\"summary\":{\"count\":0}}";
+        if (conn.subscription.mode == Subscription::Events) {
+            // Соединение занято потоком SSE, входящие данные не обрабатываются
+            conn.in.clear();
+            return;
         }
-        
-        response = json.str();
+
+        // После Connection: close новые запросы не обрабатываем, а во время потокового
+        // ответа или long-poll они ждут в буфере (их обработает onWritable после ответа)
+        if (!conn.closeAfterWrite && !conn.stream && conn.subscription.mode == Subscription::None &&
+            !conn.in.empty()) {
+            processInput(conn);
+        }
+
+        if (peerClosed) {
+            // Клиент закрыл свою сторону: дописываем ответы и закрываем
+            conn.closeAfterWrite = true;
+        }
+        onWritable(fd);
     }
-    else if (path == "/" || path == "/index.html") {
-        // Главная страница
-        std::string content = readStaticFile("index.html");
-        if (!content.empty()) {
-            return "HTML:" + content; // Используем префикс для обозначения HTML
+
+    void onWritable(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = it->second;
+
+        while (true) {
+            while (!conn.out.empty()) {
+                // SIGPIPE игнорируется (main), разрыв соединения вернет EPIPE
+                ssize_t n = conn.out.writeTo(fd);
+                if (n < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return;  // дождемся EPOLLOUT
+                    closeConnection(fd);
+                    return;
+                }
+                conn.lastActive = std::chrono::steady_clock::now();
+            }
+
+            // Следующий фрагмент потокового ответа формируется только после отправки предыдущего
+            if (conn.stream) {
+                if (!conn.stream->next(conn.out.buffer())) conn.stream.reset();
+                continue;
+            }
+
+            // Поток завершен: обрабатываем запросы, накопившиеся за время его отправки
+            if (!conn.closeAfterWrite && conn.subscription.mode == Subscription::None &&
+                !conn.in.empty()) {
+                processInput(conn);
+                if (!conn.out.empty() || conn.stream) continue;
+            }
+            break;
+        }
+
+        // Соединение с ожидающим long-poll закрывается только после ответа
+        if (conn.closeAfterWrite && conn.subscription.mode != Subscription::LongPoll) {
+            closeConnection(fd);
         }
-        response = "<!DOCTYPE html><html><body><h1>Not Found</h1></body></html>";
     }
-    else if (path == "/style.css") {
-        std::string content = readStaticFile("style.css");
-        if (!content.empty()) {
-            return "CSS:" + content;
+
+    void processInput(Connection& conn) {
+        bool keepOpen = processPipelined(*db, conn.in, conn.out, conn.stream, conn.subscription);
+        // Поток SSE держит соединение независимо от Connection: close
+        if (!keepOpen && conn.subscription.mode != Subscription::Events) {
+            conn.closeAfterWrite = true;
         }
-        response = "";
     }
-    else if (path == "/script.js") {
-        std::string content = readStaticFile("script.js");
-        if (!content.empty()) {
-            return "JS:" + content;
+
+    // Новые измерения в буфере: пачка событий каждому подписчику SSE одной записью
+    // и ответы на ожидающие long-poll запросы
+    void onSamples() {
+        uint64_t value;
+        while (read(eventFd, &value, sizeof(value)) > 0) {
+        }
+
+        // Подписчики, получившие измерения до одного и того же момента (обычно все),
+        // получают одну общую строку событий - ссылкой, без копирования на каждого
+        std::shared_ptr<std::string> shared;
+        std::time_t sharedFrom = -1;
+        std::time_t sharedLast = 0;
+        std::vector<int> ready;
+        for (auto& entry : connections) {
+            Connection& conn = entry.second;
+            Subscription& subscription = conn.subscription;
+            if (subscription.mode == Subscription::Events) {
+                if (!shared || sharedFrom != subscription.lastEpoch) {
+                    shared = std::make_shared<std::string>();
+                    sharedFrom = subscription.lastEpoch;
+                    sharedLast = appendSampleEvents(*shared, subscription.lastEpoch);
+                }
+                if (sharedLast == subscription.lastEpoch) continue;
+                conn.out.appendRef(*shared, shared);
+                subscription.lastEpoch = sharedLast;
+                ready.push_back(entry.first);
+            } else if (subscription.mode == Subscription::LongPoll) {
+                std::time_t newest;
+                double temperature;
+                if (recentSamples.last(newest, temperature) && newest > subscription.lastEpoch) {
+                    answerLongPoll(conn);
+                    ready.push_back(entry.first);
+                }
+            }
+        }
+        for (int fd : ready) {
+            onWritable(fd);
         }
-        response = "";
     }
-    else {
-        response = "{\"error\":\"Not found\"}";
+
+    void answerLongPoll(Connection& conn) {
+        conn.out.buffer() += longPollResponse(conn.subscription.lastEpoch, conn.subscription.keepAlive);
+        conn.subscription.mode = Subscription::None;
     }
-    
-    return response;
-}
 
-// Отправка HTTP ответа
-void sendHttpResponse(int client_socket, const std::string& body, const std::string& contentType = "application/json") {
-    std::ostringstream response;
-    response << "HTTP/1.1 200 OK\r\n"
-             << "Content-Type: " << contentType << "; charset=utf-8\r\n"
-             << "Content-Length: " << body.length() << "\r\n"
-             << "Access-Control-Allow-Origin: *\r\n"
-             << "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-             << "Access-Control-Allow-Headers: Content-Type\r\n"
-             << "Connection: close\r\n"
-             << "\r\n"
-             << body;
-    
-    std::string resp = response.str();
-    int bytesSent = 0;
-    int totalBytes = resp.length();
-    while (bytesSent < totalBytes) {
-        int ret = send(client_socket, resp.c_str() + bytesSent, totalBytes - bytesSent, 0);
-        if (ret < 0) break;
-        bytesSent += ret;
+    // Раз в секунду: закрытие keep-alive соединений, простаивающих дольше idleTimeoutSec,
+    // пинг потоков SSE без новых данных, пустые ответы на long-poll с истекшим ожиданием
+    void closeIdle(std::chrono::steady_clock::time_point now) {
+        std::vector<int> expired;
+        std::vector<int> ready;
+        for (auto& entry : connections) {
+            Connection& conn = entry.second;
+            switch (conn.subscription.mode) {
+            case Subscription::Events:
+                if (now - conn.lastActive >= std::chrono::seconds(SSE_HEARTBEAT_SEC)) {
+                    conn.out.buffer() += ": ping\n\n";
+                    conn.lastActive = now;
+                    ready.push_back(entry.first);
+                }
+                break;
+            case Subscription::LongPoll:
+                if (now >= conn.subscription.deadline) {
+                    answerLongPoll(conn);
+                    ready.push_back(entry.first);
+                }
+                break;
+            case Subscription::None:
+                if (now - conn.lastActive > std::chrono::seconds(idleTimeoutSec)) {
+                    expired.push_back(entry.first);
+                }
+                break;
+            }
+        }
+        for (int fd : expired) {
+            closeConnection(fd);
+        }
+        for (int fd : ready) {
+            onWritable(fd);
+        }
     }
-}
 
-// Обработчик клиента
-void handleClient(int client_socket, sqlite3* db) {
-    char buffer[8192] = {0};
-    ssize_t bytesRead = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytesRead > 0) {
-        std::string request(buffer);
-        std::string response = handleHttpRequest(db, request);
-        
-        // Проверяем тип ответа по префиксу
-        if (response.substr(0, 5) == "HTML:") {
-            std::string content = response.substr(5);
-            sendHttpResponse(client_socket, content, "text/html");
-        } else if (response.substr(0, 4) == "CSS:") {
-            std::string content = response.substr(4);
-            sendHttpResponse(client_socket, content, "text/css");
-        } else if (response.substr(0, 3) == "JS:") {
-            std::string content = response.substr(3);
-            sendHttpResponse(client_socket, content, "application/javascript");
-        } else {
-            sendHttpResponse(client_socket, response, "application/json");
+    void closeConnection(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+    }
+};
+
+// Запуск пула циклов событий: по одному на ядро, соединения шардируются через SO_REUSEPORT
+bool runEventLoops(int port, int workers, DbPool& pool) {
+    std::vector<int> sockets;
+    for (int i = 0; i < workers; ++i) {
+        int fd = createListenSocket(port, true);
+        if (fd < 0) {
+            for (int s : sockets) close(s);
+            return false;
         }
+        sockets.push_back(fd);
     }
-    
-    close(client_socket);
+
+    std::vector<std::thread> threads;
+    for (int fd : sockets) {
+        threads.emplace_back([fd, &pool]() {
+            EventLoop loop(fd, pool);
+            loop.run();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return true;
 }
+#endif
 
 void signalHandler(int sig) {
     running = false;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    int port = 8080;
+    bool threaded = false;
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    long hotSamples = 86400;
+    std::string shmName;
+    std::string archiveDir;
+
+    // Разбор аргументов командной строки
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--db" && i + 1 < argc) {
+            dbPath = argv[++i];
+        } else if (arg == "--idle-timeout" && i + 1 < argc) {
+            idleTimeoutSec = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--static" && i + 1 < argc) {
+            staticDir = argv[++i];
+        } else if (arg == "--hot-samples" && i + 1 < argc) {
+            hotSamples = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--hot-poll-ms" && i + 1 < argc) {
+            hotPollMs = std::max(10, std::atoi(argv[++i]));
+        } else if (arg == "--shm" && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (arg == "--archive" && i + 1 < argc) {
+            archiveDir = argv[++i];
+        } else if (arg == "--threaded") {
+            threaded = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--port N] [--db PATH] [--static DIR] [--workers N] [--idle-timeout SEC]"
+                      << " [--hot-samples N] [--hot-poll-ms MS] [--shm NAME] [--archive DIR] [--threaded]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
     // Инициализация Winsock для Windows
 #ifdef _WIN32
     WSADATA wsaData;
@@ -365,9 +2553,9 @@ int main() {
     }
 #endif
 
-    // Инициализация БД
+    // Инициализация БД (соединение на запись нужно только для создания схемы)
     sqlite3* db;
-    int rc = sqlite3_open("measurements.db", &db);
+    int rc = sqlite3_open(dbPath.c_str(), &db);
     
     if (rc) {
         std::cerr << "Cannot open database: " << sqlite3_errmsg(db) << std::endl;
@@ -377,65 +2565,76 @@ int main() {
         return 1;
     }
     
-    initDatabase(db);
-    std::cout << "Database initialized" << std::endl;
-    
-    // Создание сокета
-    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket < 0) {
-        std::cerr << "Socket creation error" << std::endl;
-        sqlite3_close(db);
+    bool schemaOk = storage::initSchema(db);
+    sqlite3_close(db);
+    if (!schemaOk) {
+        std::cerr << "Cannot initialize database schema" << std::endl;
 #ifdef _WIN32
         WSACleanup();
 #endif
         return 1;
     }
+    std::cout << "Database initialized" << std::endl;
+
+    DbPool pool(dbPath);
+    archives.setDirectory(archiveDir);
+    reloadAssets();
     
-    // Разрешение переиспользования адреса
-    int opt = 1;
-    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-    
-    // Привязка сокета
-    struct sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(8080);
-    
-    if (bind(server_socket, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        std::cerr << "Bind failed" << std::endl;
+    // Обработчик сигнала для корректного завершения
+    signal(SIGINT, signalHandler);
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    // Фоновые потоки: буфер последних измерений и перезагрузка статических файлов
+    std::vector<std::thread> background;
+    if (hotSamples > 0) {
+        recentSamples.setCapacity(hotSamples);
+#ifndef _WIN32
+        if (!shmName.empty()) {
+            background.emplace_back(followSampleRing, std::ref(pool), static_cast<size_t>(hotSamples), shmName);
+        } else
+#endif
+        {
+            background.emplace_back(tailRecentSamples, std::ref(pool), static_cast<size_t>(hotSamples));
+        }
+    } else if (!shmName.empty()) {
+        std::cerr << "--shm requires the hot sample buffer (--hot-samples > 0)" << std::endl;
+    }
+#ifdef __linux__
+    background.emplace_back(watchAssets);
+#endif
+    auto stopBackground = [&background]() {
+        running = false;
+        for (auto& t : background) t.join();
+    };
+
+#ifdef __linux__
+    if (!threaded) {
+        std::cout << "Server listening on port " << port
+                  << " (epoll, " << workers << " workers)" << std::endl;
+        bool ok = runEventLoops(port, workers, pool);
+        stopBackground();
+        if (!ok) return 1;
+        std::cout << "Server stopped" << std::endl;
+        return 0;
+    }
+#endif
+
+    int server_socket = createListenSocket(port, false);
+    if (server_socket >= 0) {
+        std::cout << "Server listening on port " << port << " (thread per connection)" << std::endl;
+        runThreadPerConnection(server_socket, pool);
         close(server_socket);
-        sqlite3_close(db);
+    }
+
+    stopBackground();
+    if (server_socket < 0) {
 #ifdef _WIN32
         WSACleanup();
 #endif
         return 1;
     }
-    
-    // Прослушивание
-    listen(server_socket, 5);
-    std::cout << "Server listening on port 8080" << std::endl;
-    
-    // Обработчик сигнала для корректного завершения
-    signal(SIGINT, signalHandler);
-    
-    // Основной цикл сервера
-    while (running) {
-        struct sockaddr_in client_addr;
-        socklen_t addrlen = sizeof(client_addr);
-        
-        int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &addrlen);
-        if (client_socket < 0) {
-            if (!running) break;
-            std::cerr << "Accept failed" << std::endl;
-            continue;
-        }
-        
-        // Обработка клиента в отдельном потоке
-        std::thread(&handleClient, client_socket, db).detach();
-    }
-    
-    close(server_socket);
-    sqlite3_close(db);
     std::cout << "Server stopped" << std::endl;
     
 #ifdef _WIN32
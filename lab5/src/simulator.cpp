@@ -1,32 +1,81 @@
 #include <iostream>
-#include <chrono>
-#include <thread>
-#include <random>
-#include <iomanip>
 #include <ctime>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
-std::string isoTime() {
-    std::time_t t = std::time(nullptr);
-    std::tm tm{};
-#ifdef _WIN32
-    localtime_s(&tm, &t);
+#include "sample_ring.h"
+#include "load_gen.h"
+
+int main(int argc, char* argv[]) {
+    std::string shmName;
+    uint64_t shmCapacity = ring::DEFAULT_CAPACITY;
+    int sensors = 1;
+    loadgen::Options load;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (arg == "--shm-capacity" && i + 1 < argc) {
+            shmCapacity = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--sensors" && i + 1 < argc) {
+            sensors = std::max(1, std::atoi(argv[++i]));
+        } else if (!load.parse(i, argc, argv)) {
+            std::cerr << "Usage: " << argv[0] << " [--shm NAME] [--shm-capacity N] [--sensors N]"
+                      << loadgen::Options::usage() << std::endl;
+            return 1;
+        }
+    }
+
+    // С метками текущего времени БД хранит одно измерение на датчик в секунду (load_gen.h).
+    // Число датчиков не подбирается само: от него зависят номера датчиков в БД и то,
+    // за каким датчиком следят /api/current и /api/stream
+    int needed = load.wallClockSensors();
+    if (needed > sensors) {
+        std::cerr << "Warning: --rate " << load.rate << " with " << sensors << " sensors stamps up to "
+                  << static_cast<long>(std::ceil(load.peakRate() / sensors))
+                  << " samples per sensor with the same second; the database keeps one of them."
+                  << " Use --sensors " << needed << " or --step" << std::endl;
+    }
+
+#ifndef _WIN32
+    // С --shm измерения публикуются в кольцевой буфер в разделяемой памяти вместо stdout
+    ring::Writer samples;
+    if (!shmName.empty() && !samples.open(shmName, shmCapacity)) {
+        std::cerr << "Cannot open shared memory " << shmName << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
 #else
-    localtime_r(&t, &tm);
+    if (!shmName.empty()) {
+        std::cerr << "--shm is not supported on Windows" << std::endl;
+        return 1;
+    }
 #endif
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
-    return buf;
-}
 
-int main() {
-    std::default_random_engine gen(std::random_device{}());
-    std::normal_distribution<double> temp(22.0, 2.0);
-
-    while (true) {
-        std::cout << isoTime() << " "
-                  << std::fixed << std::setprecision(2)
-                  << temp(gen) << std::endl;
+    // Датчики 0..sensors-1, строка "YYYY-MM-DDTHH:MM:SS temperature sensor"
+    loadgen::TextOutput out(true);
+    auto emit = [&](std::time_t epoch, double value, int sensor) {
+#ifndef _WIN32
+        if (!shmName.empty()) {
+            // Та же точность, что и в текстовом выводе
+            samples.push(epoch, std::round(value * 100.0) / 100.0, sensor);
+            return;
+        }
+#endif
+        out.append(epoch, value, sensor);
+    };
+    auto flush = [&] { return out.flush(); };
 
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+    if (!load.replay.empty()) {
+        if (loadgen::replay(load, emit, flush) < 0) {
+            std::cerr << "Cannot open " << load.replay << std::endl;
+            return 1;
+        }
+        return 0;
     }
+    loadgen::generate(load, sensors, emit, flush);
+    return 0;
 }
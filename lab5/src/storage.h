@@ -0,0 +1,414 @@
+#pragma once
+// Схема хранения измерений, общая для логгера и сервера.
+//
+// Измерения разбиты на секции по локальным суткам: таблица measurements_YYYYMMDD
+// с ключом (sensor, epoch) (номер датчика, секунды Unix; WITHOUT ROWID - строки одного
+// датчика лежат подряд по времени), список секций с их границами - в таблице
+// measurement_partitions. Запрос за период читает только пересекающиеся
+// с ним секции, очистка старых данных удаляет секции целиком (DROP TABLE).
+// Статистика по окнам (minute_avg, hourly_avg, daily_avg, weekly_avg) невелика и хранится
+// одной таблицей на окно, ключ - начало минуты/часа/суток/недели в секундах Unix; кроме
+// среднего в них хранятся min, max, число измерений и выборочная дисперсия, чтобы сервер
+// мог строить по ним прореженные графики.
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+
+namespace storage {
+
+// Датчик строк без номера (старые данные, вывод симулятора с одним датчиком) и запросов
+// API без параметра sensor
+const int DEFAULT_SENSOR = 0;
+
+// Столбцы секции измерений
+const char* const PARTITION_COLUMNS =
+    " (sensor INTEGER NOT NULL DEFAULT 0, epoch INTEGER NOT NULL, temperature REAL, "
+    "PRIMARY KEY (sensor, epoch)) WITHOUT ROWID";
+
+// Таблицы статистики по окнам: имя и столбец начала окна
+struct AggregateTable {
+    const char* table;
+    const char* column;
+};
+
+const AggregateTable AGGREGATE_TABLES[] = {
+    {"minute_avg", "minute_epoch"},
+    {"hourly_avg", "hour_epoch"},
+    {"daily_avg", "day_epoch"},
+    {"weekly_avg", "week_epoch"},
+};
+
+inline std::string aggregateTableSql(const AggregateTable& t) {
+    return std::string("CREATE TABLE IF NOT EXISTS ") + t.table + " (sensor INTEGER NOT NULL DEFAULT 0, " +
+           t.column + " INTEGER NOT NULL, average REAL, min REAL, max REAL, count INTEGER, "
+           "variance REAL, PRIMARY KEY (sensor, " + t.column + "))";
+}
+
+struct Partition {
+    std::string name;
+    std::time_t start;  // начало локальных суток (включительно)
+    std::time_t end;    // начало следующих суток (не включительно)
+};
+
+inline std::tm toLocalTm(std::time_t t) {
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    return tm;
+}
+
+// Начало часа, содержащего t
+inline std::time_t hourStart(std::time_t t) {
+    std::tm tm = toLocalTm(t);
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    return std::mktime(&tm);
+}
+
+// Начало локальных суток, содержащих t
+inline std::time_t dayStart(std::time_t t) {
+    std::tm tm = toLocalTm(t);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+// Начало следующих суток (с учетом перехода на летнее время сутки не всегда 86400 с)
+inline std::time_t nextDayStart(std::time_t dayBegin) {
+    std::tm tm = toLocalTm(dayBegin);
+    tm.tm_mday += 1;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+// Смещение локального времени от UTC в момент t, секунды
+inline long utcOffset(std::time_t t) {
+    std::tm local = toLocalTm(t);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &t);
+#else
+    gmtime_r(&t, &utc);
+#endif
+    utc.tm_isdst = local.tm_isdst;
+    return static_cast<long>(t - std::mktime(&utc));
+}
+
+// Момент, когда локальные часы показывают local (локальное время в секундах от эпохи,
+// как если бы это было UTC). Несуществующее при переходе на летнее время время сдвигается
+// вперед, повторяющееся при переходе на зимнее - выбирает mktime
+inline std::time_t localToEpoch(std::time_t local) {
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &local);
+#else
+    gmtime_r(&local, &tm);
+#endif
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+// YYYY-MM-DDTHH:MM:SS в локальном времени
+inline std::string formatTime(std::time_t t) {
+    std::tm tm = toLocalTm(t);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return std::string(buf);
+}
+
+// Разбор YYYY-MM-DDTHH:MM:SS (локальное время)
+inline bool parseTime(const std::string& s, std::time_t& out) {
+    std::tm tm{};
+    std::istringstream ss(s);
+    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if (ss.fail()) return false;
+    tm.tm_isdst = -1;
+    out = std::mktime(&tm);
+    return true;
+}
+
+inline std::string partitionName(std::time_t dayBegin) {
+    std::tm tm = toLocalTm(dayBegin);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "measurements_%Y%m%d", &tm);
+    return std::string(buf);
+}
+
+inline bool exec(sqlite3* db, const std::string& sql) {
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (errMsg ? errMsg : sqlite3_errmsg(db)) << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Создание секции для суток, содержащих t (если ее еще нет). Вызывается внутри транзакции:
+// при ошибке секция может быть создана без записи в каталоге, поэтому вызывающий откатывает транзакцию.
+inline bool ensurePartition(sqlite3* db, std::time_t t, Partition& p) {
+    p.start = dayStart(t);
+    p.end = nextDayStart(p.start);
+    p.name = partitionName(p.start);
+
+    if (!exec(db, "CREATE TABLE IF NOT EXISTS " + p.name + PARTITION_COLUMNS)) return false;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+            "INSERT OR IGNORE INTO measurement_partitions (name, start_epoch, end_epoch) VALUES (?, ?, ?)",
+            -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot register partition " << p.name << ": " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, p.name.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, p.start);
+    sqlite3_bind_int64(stmt, 3, p.end);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) {
+        std::cerr << "Cannot register partition " << p.name << ": " << sqlite3_errmsg(db) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// Есть ли в таблице столбец (для распознавания старой схемы)
+inline bool hasColumn(sqlite3* db, const std::string& table, const std::string& column) {
+    sqlite3_stmt* stmt;
+    std::string sql = "PRAGMA table_info(" + table + ")";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
+
+    bool found = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (column == reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1))) {
+            found = true;
+            break;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Перенос данных из старой схемы (одна таблица measurements с TEXT timestamp,
+// hourly_avg/daily_avg с TEXT ключом). Вызывается внутри транзакции после создания каталога
+// секций; false - перенос не удался и транзакцию нужно откатить, иначе старые данные будут потеряны.
+inline bool migrateLegacySchema(sqlite3* db) {
+    if (hasColumn(db, "measurements", "timestamp")) {
+        std::cerr << "Migrating measurements to daily partitions" << std::endl;
+
+        std::vector<std::string> days;
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT DISTINCT substr(timestamp, 1, 10) FROM measurements",
+                               -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                days.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+            }
+            sqlite3_finalize(stmt);
+        }
+
+        for (const auto& day : days) {
+            std::time_t t;
+            if (!parseTime(day + "T12:00:00", t)) continue;
+            Partition p;
+            if (!ensurePartition(db, t, p)) return false;
+            // Модификатор 'utc' переводит локальное время в UTC
+            if (!exec(db, "INSERT OR REPLACE INTO " + p.name + " (epoch, temperature) "
+                         "SELECT CAST(strftime('%s', timestamp, 'utc') AS INTEGER), temperature "
+                         "FROM measurements WHERE substr(timestamp, 1, 10) = '" + day + "'")) return false;
+        }
+        if (!exec(db, "DROP TABLE measurements")) return false;
+    }
+
+    if (hasColumn(db, "hourly_avg", "date_hour")) {
+        if (!exec(db, "ALTER TABLE hourly_avg RENAME TO hourly_avg_legacy")) return false;
+        if (!exec(db, "CREATE TABLE hourly_avg (hour_epoch INTEGER PRIMARY KEY, average REAL, "
+                     "min REAL, max REAL, count INTEGER)")) return false;
+        if (!exec(db, "INSERT OR REPLACE INTO hourly_avg (hour_epoch, average, min, max) "
+                     "SELECT CAST(strftime('%s', date_hour || ':00:00', 'utc') AS INTEGER), "
+                     "average, average, average "
+                     "FROM hourly_avg_legacy")) return false;
+        if (!exec(db, "DROP TABLE hourly_avg_legacy")) return false;
+    }
+
+    if (hasColumn(db, "daily_avg", "date")) {
+        if (!exec(db, "ALTER TABLE daily_avg RENAME TO daily_avg_legacy")) return false;
+        if (!exec(db, "CREATE TABLE daily_avg (day_epoch INTEGER PRIMARY KEY, average REAL, "
+                     "min REAL, max REAL, count INTEGER)")) return false;
+        if (!exec(db, "INSERT OR REPLACE INTO daily_avg (day_epoch, average, min, max) "
+                     "SELECT CAST(strftime('%s', date || ' 00:00:00', 'utc') AS INTEGER), "
+                     "average, average, average "
+                     "FROM daily_avg_legacy")) return false;
+        if (!exec(db, "DROP TABLE daily_avg_legacy")) return false;
+    }
+
+    // Средние без min/max/count: для старых строк min = max = average, count неизвестен
+    for (const char* table : {"hourly_avg", "daily_avg"}) {
+        if (hasColumn(db, table, "average") && !hasColumn(db, table, "count")) {
+            std::string name = table;
+            if (!exec(db, "ALTER TABLE " + name + " ADD COLUMN min REAL")) return false;
+            if (!exec(db, "ALTER TABLE " + name + " ADD COLUMN max REAL")) return false;
+            if (!exec(db, "ALTER TABLE " + name + " ADD COLUMN count INTEGER")) return false;
+            if (!exec(db, "UPDATE " + name + " SET min = average, max = average")) return false;
+        }
+        if (hasColumn(db, table, "count") && !hasColumn(db, table, "variance")) {
+            if (!exec(db, "ALTER TABLE " + std::string(table) + " ADD COLUMN variance REAL")) return false;
+        }
+    }
+
+    // Таблицы без номера датчика: ключ меняется, поэтому таблица пересоздается,
+    // все строки относятся к датчику по умолчанию
+    std::vector<std::string> partitions;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT name FROM measurement_partitions", -1, &stmt, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            partitions.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+    }
+    for (const auto& name : partitions) {
+        if (!hasColumn(db, name, "epoch") || hasColumn(db, name, "sensor")) continue;
+        std::cerr << "Migrating " << name << " to per-sensor keys" << std::endl;
+        if (!exec(db, "ALTER TABLE " + name + " RENAME TO " + name + "_legacy")) return false;
+        if (!exec(db, "CREATE TABLE " + name + PARTITION_COLUMNS)) return false;
+        if (!exec(db, "INSERT INTO " + name + " (sensor, epoch, temperature) "
+                     "SELECT " + std::to_string(DEFAULT_SENSOR) + ", epoch, temperature FROM " + name + "_legacy")) return false;
+        if (!exec(db, "DROP TABLE " + name + "_legacy")) return false;
+    }
+    for (const auto& t : AGGREGATE_TABLES) {
+        std::string name = t.table;
+        if (!hasColumn(db, name, t.column) || hasColumn(db, name, "sensor")) continue;
+        if (!exec(db, "ALTER TABLE " + name + " RENAME TO " + name + "_legacy")) return false;
+        if (!exec(db, aggregateTableSql(t))) return false;
+        if (!exec(db, "INSERT INTO " + name + " (sensor, " + t.column + ", average, min, max, count, variance) "
+                     "SELECT " + std::to_string(DEFAULT_SENSOR) + ", " + t.column +
+                     ", average, min, max, count, variance FROM " + name + "_legacy")) return false;
+        if (!exec(db, "DROP TABLE " + name + "_legacy")) return false;
+    }
+    return true;
+}
+
+// Создание схемы и перенос данных из старой схемы, если она обнаружена
+inline bool initSchema(sqlite3* db) {
+    // WAL: читатели не блокируют запись и друг друга
+    exec(db, "PRAGMA journal_mode=WAL");
+    sqlite3_busy_timeout(db, 5000);
+
+    // IMMEDIATE: логгер и сервер могут инициализировать схему одновременно
+    if (!exec(db, "BEGIN IMMEDIATE")) return false;
+
+    // Каталог секций нужен до переноса: перенос регистрирует в нем секции
+    bool ok = exec(db, R"(
+        CREATE TABLE IF NOT EXISTS measurement_partitions (
+            name TEXT PRIMARY KEY,
+            start_epoch INTEGER NOT NULL,
+            end_epoch INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_partitions_start ON measurement_partitions(start_epoch);
+    )") && migrateLegacySchema(db);
+    for (const auto& t : AGGREGATE_TABLES) {
+        ok = ok && exec(db, aggregateTableSql(t));
+    }
+
+    return exec(db, ok ? "COMMIT" : "ROLLBACK") && ok;
+}
+
+// Секции, пересекающиеся с [from, to], в порядке времени
+inline std::vector<Partition> partitionsInRange(sqlite3_stmt* stmt, std::time_t from, std::time_t to) {
+    std::vector<Partition> result;
+    sqlite3_bind_int64(stmt, 1, from);
+    sqlite3_bind_int64(stmt, 2, to);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Partition p;
+        p.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        p.start = sqlite3_column_int64(stmt, 1);
+        p.end = sqlite3_column_int64(stmt, 2);
+        result.push_back(p);
+    }
+    sqlite3_reset(stmt);
+    return result;
+}
+
+// Запрос для partitionsInRange: параметры - начало и конец периода
+const char* const PARTITIONS_IN_RANGE_SQL =
+    "SELECT name, start_epoch, end_epoch FROM measurement_partitions "
+    "WHERE end_epoch > ?1 AND start_epoch <= ?2 ORDER BY start_epoch";
+
+// Секции, целиком лежащие раньше cutoff
+inline std::vector<Partition> expiredPartitions(sqlite3* db, std::time_t cutoff) {
+    std::vector<Partition> result;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db,
+            "SELECT name, start_epoch, end_epoch FROM measurement_partitions "
+            "WHERE end_epoch <= ? ORDER BY start_epoch",
+            -1, &stmt, nullptr) != SQLITE_OK) {
+        return result;
+    }
+    sqlite3_bind_int64(stmt, 1, cutoff);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        Partition p;
+        p.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        p.start = sqlite3_column_int64(stmt, 1);
+        p.end = sqlite3_column_int64(stmt, 2);
+        result.push_back(p);
+    }
+    sqlite3_finalize(stmt);
+    return result;
+}
+
+// Время последнего сохраненного измерения каждого датчика в самой новой непустой секции
+inline std::map<int, std::time_t> latestEpochs(sqlite3* db) {
+    std::map<int, std::time_t> result;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT name FROM measurement_partitions ORDER BY start_epoch DESC",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return result;
+    }
+    std::vector<std::string> names;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        names.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+    }
+    sqlite3_finalize(stmt);
+
+    // Самая новая секция может быть пустой (создана, но запись не дошла)
+    for (const auto& name : names) {
+        std::string sql = "SELECT sensor, max(epoch) FROM " + name + " GROUP BY sensor";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) continue;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            result[sqlite3_column_int(stmt, 0)] = sqlite3_column_int64(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+        if (!result.empty()) break;
+    }
+    return result;
+}
+
+// Удаление секции целиком, возвращает число строк в ней (-1 при ошибке)
+inline long dropPartition(sqlite3* db, const Partition& p) {
+    long rows = 0;
+    sqlite3_stmt* stmt;
+    std::string countSql = "SELECT count(*) FROM " + p.name;
+    if (sqlite3_prepare_v2(db, countSql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) rows = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+
+    if (!exec(db, "BEGIN")) return -1;
+    bool ok = exec(db, "DROP TABLE IF EXISTS " + p.name) &&
+              exec(db, "DELETE FROM measurement_partitions WHERE name = '" + p.name + "'");
+    exec(db, ok ? "COMMIT" : "ROLLBACK");
+    return ok ? rows : -1;
+}
+
+}
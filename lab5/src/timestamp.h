@@ -0,0 +1,155 @@
+#pragma once
+// Разбор меток времени YYYY-MM-DDTHH:MM:SS (локальное время) без std::get_time и mktime
+// на каждую строку.
+//
+// Цифры разбираются напрямую из строки, проверка формата - одной маской без ветвлений
+// по символам. Начало и длина локальных суток кэшируются: mktime (который в glibc берет
+// глобальную блокировку часового пояса) вызывается один раз на новую дату, остальные
+// строки тех же суток считаются как начало суток + время от полуночи. Сутки перехода
+// на летнее/зимнее время (длина не 86400 с) разбираются через mktime, как раньше.
+// Результат совпадает с mktime при tm_isdst = -1.
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+
+namespace timestamp {
+
+class Parser {
+public:
+    // s - не меньше 19 символов YYYY-MM-DDTHH:MM:SS (после них может быть что угодно).
+    // fields, если передан, получает разобранные поля (как localtime для результата)
+    bool parse(const char* s, size_t len, std::time_t& out, std::tm* fields = nullptr) {
+        if (len < 19) return false;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+        unsigned d[14] = {
+            p[0] - 48u, p[1] - 48u, p[2] - 48u, p[3] - 48u,    // YYYY
+            p[5] - 48u, p[6] - 48u, p[8] - 48u, p[9] - 48u,    // MM DD
+            p[11] - 48u, p[12] - 48u, p[14] - 48u, p[15] - 48u, p[17] - 48u, p[18] - 48u,  // HH MM SS
+        };
+        unsigned bad = 0;
+        for (unsigned digit : d) bad |= digit > 9;
+        bad |= (p[4] ^ '-') | (p[7] ^ '-') | (p[10] ^ 'T') | (p[13] ^ ':') | (p[16] ^ ':');
+        if (bad) return false;
+
+        int year = static_cast<int>(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3]);
+        int month = static_cast<int>(d[4] * 10 + d[5]);
+        int day = static_cast<int>(d[6] * 10 + d[7]);
+        int hour = static_cast<int>(d[8] * 10 + d[9]);
+        int minute = static_cast<int>(d[10] * 10 + d[11]);
+        int second = static_cast<int>(d[12] * 10 + d[13]);
+        if (hour > 23 || minute > 59 || second > 60) return false;
+        return resolve(year, month, day, hour, minute, second, out, fields);
+    }
+
+    // YYYY-MM-DD и время суток отдельно (логи средних значений: дата + час)
+    bool parseDate(const char* s, size_t len, int hour, int minute, int second, std::time_t& out,
+                   std::tm* fields = nullptr) {
+        int year, month, day;
+        if (!parseCalendarDate(s, len, year, month, day) ||
+            hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60) {
+            return false;
+        }
+        return resolve(year, month, day, hour, minute, second, out, fields);
+    }
+
+    // Только поля даты YYYY-MM-DD, без перевода во время (и без mktime)
+    static bool parseCalendarDate(const char* s, size_t len, int& year, int& month, int& day) {
+        if (len < 10) return false;
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+        unsigned d[8] = {
+            p[0] - 48u, p[1] - 48u, p[2] - 48u, p[3] - 48u,
+            p[5] - 48u, p[6] - 48u, p[8] - 48u, p[9] - 48u,
+        };
+        unsigned bad = 0;
+        for (unsigned digit : d) bad |= digit > 9;
+        bad |= (p[4] ^ '-') | (p[7] ^ '-');
+        if (bad) return false;
+
+        year = static_cast<int>(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3]);
+        month = static_cast<int>(d[4] * 10 + d[5]);
+        day = static_cast<int>(d[6] * 10 + d[7]);
+        return validDate(year, month, day);
+    }
+
+private:
+    int32_t cachedDate = -1;  // YYYYMMDD закэшированных суток
+    std::time_t dayBegin = 0;
+    long dayLength = 0;
+    int weekday = 0;
+    int yearday = 0;
+    int isdst = 0;
+
+    static bool validDate(int year, int month, int day) {
+        static const int DAYS[12] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        if (month < 1 || month > 12 || day < 1 || day > DAYS[month - 1]) return false;
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        return month != 2 || day < 29 || leap;
+    }
+
+    bool resolve(int year, int month, int day, int hour, int minute, int second,
+                 std::time_t& out, std::tm* fields) {
+        int32_t date = year * 10000 + month * 100 + day;
+        if (date != cachedDate) {
+            if (!validDate(year, month, day) || !cacheDay(year, month, day)) return false;
+            cachedDate = date;
+        }
+
+        long seconds = hour * 3600L + minute * 60L + second;
+        if (dayLength == 86400) {
+            out = dayBegin + seconds;
+            if (fields) {
+                fields->tm_year = year - 1900;
+                fields->tm_mon = month - 1;
+                fields->tm_mday = day;
+                fields->tm_hour = hour;
+                fields->tm_min = minute;
+                fields->tm_sec = second;
+                fields->tm_wday = weekday;
+                fields->tm_yday = yearday;
+                fields->tm_isdst = isdst;
+            }
+            return true;
+        }
+
+        // Сутки перехода на летнее/зимнее время: время от полуночи не равно смещению
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_min = minute;
+        tm.tm_sec = second;
+        tm.tm_isdst = -1;
+        out = std::mktime(&tm);
+        if (fields) *fields = tm;
+        return out != static_cast<std::time_t>(-1);
+    }
+
+    bool cacheDay(int year, int month, int day) {
+        std::tm tm{};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_isdst = -1;
+        std::time_t begin = std::mktime(&tm);
+        if (begin == static_cast<std::time_t>(-1)) return false;
+        weekday = tm.tm_wday;
+        yearday = tm.tm_yday;
+        isdst = tm.tm_isdst;
+
+        std::tm next{};
+        next.tm_year = year - 1900;
+        next.tm_mon = month - 1;
+        next.tm_mday = day + 1;
+        next.tm_isdst = -1;
+        std::time_t end = std::mktime(&next);
+
+        // Полночь может не существовать (переход в 00:00): тогда сутки считаются особыми
+        bool midnight = tm.tm_hour == 0 && tm.tm_min == 0 && tm.tm_sec == 0;
+        dayBegin = begin;
+        dayLength = midnight ? static_cast<long>(end - begin) : 0;
+        return true;
+    }
+};
+
+}  // namespace timestamp
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Тесты lab5: каждый test/ИМЯ.cpp компилируется в test/ИМЯ и запускается на собранных
+# программах (src/logger, src/server) во временном каталоге
+#
+# Использование:
+#   ./test.sh [ИМЯ...]
+
+cd "$(dirname "$0")"
+
+COMPILER=${CXX:-clang++}
+PORT=${TEST_PORT:-18081}
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+if [ ! -f "src/server" ] || [ ! -f "src/logger" ]; then
+    echo -e "${RED}Сначала скомпилируйте программы: ./build.sh${NC}"
+    exit 1
+fi
+
+if [ $# -gt 0 ]; then
+    TESTS="$*"
+else
+    TESTS=$(cd test && ls *.cpp | sed 's/\.cpp$//')
+fi
+
+FAILED=0
+for name in $TESTS; do
+    if ! $COMPILER -std=c++17 -O2 -pthread -Isrc -o test/$name test/$name.cpp -lsqlite3; then
+        echo -e "${RED}Ошибка компиляции $name${NC}"
+        FAILED=$((FAILED + 1))
+        continue
+    fi
+    if test/$name --logger src/logger --server src/server --port $PORT > /dev/null; then
+        echo -e "${GREEN}$name: OK${NC}"
+    else
+        echo -e "${RED}$name: FAIL${NC}"
+        FAILED=$((FAILED + 1))
+    fi
+done
+
+exit $FAILED
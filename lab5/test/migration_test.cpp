@@ -0,0 +1,230 @@
+// Проверка переноса данных из старой схемы (storage::migrateLegacySchema).
+// Во временной БД создаются таблицы первой версии: measurements с TEXT timestamp
+// за двое суток, hourly_avg и daily_avg с TEXT ключом. Сервер при запуске переносит их,
+// после чего проверяется:
+//  - /api/stats возвращает все старые измерения;
+//  - в каталоге measurement_partitions есть секции обоих суток;
+//  - старой таблицы measurements больше нет, средние сохранены с номером датчика.
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <sqlite3.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+
+const long SAMPLES_PER_DAY = 100;
+const long STEP = 60;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+std::string formatTime(std::time_t t, const char* format) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), format, &tm);
+    return buf;
+}
+
+bool get(int port, const std::string& path, std::string& body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+    std::string response;
+    char buffer[16384];
+    ssize_t n;
+    while (ok && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, n);
+    }
+    close(fd);
+
+    size_t headersEnd = response.find("\r\n\r\n");
+    if (!ok || headersEnd == std::string::npos || response.compare(8, 5, " 200 ") != 0) return false;
+    body.assign(response, headersEnd + 4, std::string::npos);
+    return true;
+}
+
+// Сумма count по корзинам ответа /api/stats
+long totalCount(const std::string& body) {
+    static const char COUNT[] = "\"count\":";
+    long total = 0;
+    size_t end = body.find(']', body.find("\"data\":["));
+    size_t pos = 0;
+    while ((pos = body.find(COUNT, pos)) != std::string::npos && pos < end) {
+        pos += sizeof(COUNT) - 1;
+        total += std::atol(body.c_str() + pos);
+    }
+    return total;
+}
+
+// Первый столбец первой строки запроса (или -1)
+long queryLong(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* stmt;
+    long value = -1;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+bool createLegacyDb(const std::string& path, std::time_t days[2]) {
+    sqlite3* db;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) return false;
+    std::string sql = R"(
+        CREATE TABLE measurements (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            timestamp TEXT UNIQUE,
+            temperature REAL,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        );
+        CREATE TABLE hourly_avg (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            date_hour TEXT UNIQUE,
+            average REAL,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        );
+        CREATE TABLE daily_avg (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            date TEXT UNIQUE,
+            average REAL,
+            created_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        );
+        BEGIN;
+    )";
+    for (int d = 0; d < 2; ++d) {
+        for (long i = 0; i < SAMPLES_PER_DAY; ++i) {
+            sql += "INSERT INTO measurements (timestamp, temperature) VALUES ('" +
+                   formatTime(days[d] + i * STEP, "%Y-%m-%dT%H:%M:%S") + "', " + std::to_string(20 + i % 10) + ");\n";
+        }
+        sql += "INSERT INTO hourly_avg (date_hour, average) VALUES ('" +
+               formatTime(days[d], "%Y-%m-%d %H") + "', 24.5);\n";
+        sql += "INSERT INTO daily_avg (date, average) VALUES ('" + formatTime(days[d], "%Y-%m-%d") + "', 24.5);\n";
+    }
+    sql += "COMMIT;";
+
+    char* errMsg = nullptr;
+    bool ok = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) == SQLITE_OK;
+    if (!ok) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+    sqlite3_close(db);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::string server = "src/server";
+    int port = 18081;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--server" && i + 1 < argc) server = argv[++i];
+        else if (arg == "--logger" && i + 1 < argc) ++i;  // не нужен: схему переносит сервер
+        else if (arg == "--port" && i + 1 < argc) port = std::atoi(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--server PATH] [--port N]" << std::endl;
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/migration_testXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string db = std::string(dir) + "/measurements.db";
+
+    // Полдень вчера и позавчера: измерения каждых суток не переходят через полночь
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    tm.tm_hour = 12;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    std::time_t days[2];
+    for (int d = 0; d < 2; ++d) {
+        std::tm day = tm;
+        day.tm_mday -= 2 - d;
+        days[d] = std::mktime(&day);
+    }
+    if (!createLegacyDb(db, days)) return 1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::freopen("/dev/null", "w", stdout);
+        std::freopen("/dev/null", "w", stderr);
+        execl(server.c_str(), server.c_str(), "--port", std::to_string(port).c_str(), "--db", db.c_str(),
+              "--static", dir, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    std::string body;
+    for (int i = 0; i < 100 && !get(port, "/api/current", body); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    std::string path = "/api/stats?start=" + formatTime(days[0] - 3600, "%Y-%m-%dT%H:%M:%S") +
+                       "&end=" + formatTime(days[1] + 86400, "%Y-%m-%dT%H:%M:%S") + "&bucket=60";
+    if (get(port, path, body)) {
+        long total = totalCount(body);
+        check(total == 2 * SAMPLES_PER_DAY,
+              path + ": count " + std::to_string(total) + " != " + std::to_string(2 * SAMPLES_PER_DAY));
+    } else {
+        check(false, path + ": request failed");
+    }
+
+    kill(pid, SIGINT);
+    waitpid(pid, nullptr, 0);
+
+    sqlite3* conn;
+    if (sqlite3_open(db.c_str(), &conn) == SQLITE_OK) {
+        for (int d = 0; d < 2; ++d) {
+            std::string name = formatTime(days[d], "measurements_%Y%m%d");
+            check(queryLong(conn, "SELECT COUNT(*) FROM measurement_partitions WHERE name = '" + name + "'") == 1,
+                  name + " is not in measurement_partitions");
+            long rows = queryLong(conn, "SELECT COUNT(*) FROM " + name);
+            check(rows == SAMPLES_PER_DAY, name + ": " + std::to_string(rows) + " rows");
+        }
+        check(queryLong(conn, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'measurements'") == 0,
+              "legacy measurements table is still there");
+        check(queryLong(conn, "SELECT COUNT(*) FROM hourly_avg WHERE sensor = 0") == 2, "hourly_avg rows lost");
+        check(queryLong(conn, "SELECT COUNT(*) FROM daily_avg WHERE sensor = 0") == 2, "daily_avg rows lost");
+        sqlite3_close(conn);
+    } else {
+        check(false, "cannot open " + db);
+    }
+    std::system((std::string("rm -rf ") + dir).c_str());
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "migration_test: OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,309 @@
+// Проверка прореживания /api/stats (bucket, max_points).
+// Логгер записывает во временную БД 2 часа измерений одного датчика (по одному в 5 с,
+// заканчивая текущим моментом), сервер запускается на этой БД, и для нескольких окон,
+// не выровненных по часам, и разных max_points проверяется:
+//  - точек в ответе не больше max_points;
+//  - крупные корзины делят сутки (не пересекают границы суток);
+//  - сумма count по корзинам равна числу измерений в окне: часовые средние на краях окна
+//    не приносят измерения вне его;
+//  - метка первой корзины не раньше начала окна.
+// Тест идет в поясе Europe/Berlin: датчик 1 получает по измерению в минуту за трое суток
+// вокруг ближайшего перехода на летнее/зимнее время, и суточные корзины должны начинаться
+// в местную полночь и по обе стороны перехода.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+
+const long STEP = 5;
+const long SAMPLES = 2 * 3600 / STEP;
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+std::string isoTime(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+bool get(int port, const std::string& path, std::string& body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return false;
+    }
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    bool ok = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size());
+    std::string response;
+    char buffer[16384];
+    ssize_t n;
+    while (ok && (n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, n);
+    }
+    close(fd);
+
+    size_t headersEnd = response.find("\r\n\r\n");
+    if (!ok || headersEnd == std::string::npos || response.compare(8, 5, " 200 ") != 0) return false;
+    body.assign(response, headersEnd + 4, std::string::npos);
+    return true;
+}
+
+// Число точек и сумма count в ответе с корзинами
+void parseBuckets(const std::string& body, long& points, long& total) {
+    points = 0;
+    total = 0;
+    static const char COUNT[] = "\"count\":";
+    size_t data = body.find("\"data\":[");
+    size_t end = body.find(']', data);
+    size_t pos = data;
+    while ((pos = body.find(COUNT, pos)) != std::string::npos && pos < end) {
+        pos += sizeof(COUNT) - 1;
+        points++;
+        total += std::atol(body.c_str() + pos);
+    }
+}
+
+// Метки корзин (timestamp) в ответе
+std::vector<std::string> labelsOf(const std::string& body) {
+    static const char KEY[] = "\"timestamp\":\"";
+    std::vector<std::string> labels;
+    size_t pos = 0;
+    while ((pos = body.find(KEY, pos)) != std::string::npos) {
+        pos += sizeof(KEY) - 1;
+        labels.push_back(body.substr(pos, 19));
+    }
+    return labels;
+}
+
+long gmtOffset(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    return tm.tm_gmtoff;
+}
+
+std::time_t localMidnight(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+std::time_t addDays(std::time_t midnight, int days) {
+    std::tm tm{};
+    localtime_r(&midnight, &tm);
+    tm.tm_mday += days;
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
+}
+
+long bucketOf(const std::string& body) {
+    size_t pos = body.find("\"bucket\":");
+    return pos == std::string::npos ? -1 : std::atol(body.c_str() + pos + 9);
+}
+
+int main(int argc, char* argv[]) {
+    std::string logger = "src/logger";
+    std::string server = "src/server";
+    int port = 18081;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--logger" && i + 1 < argc) logger = argv[++i];
+        else if (arg == "--server" && i + 1 < argc) server = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) port = std::atoi(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--logger PATH] [--server PATH] [--port N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Пояс с переходами; логгер и сервер наследуют TZ
+    setenv("TZ", "Europe/Berlin", 1);
+    tzset();
+
+    char dir[] = "/tmp/stats_testXXXXXX";
+    if (!mkdtemp(dir)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string db = std::string(dir) + "/measurements.db";
+
+    std::time_t last = std::time(nullptr);
+    std::time_t first = last - (SAMPLES - 1) * STEP;
+    FILE* pipe = popen((logger + " --db " + db + " --batch-size 1000 > /dev/null 2>&1").c_str(), "w");
+    if (!pipe) {
+        std::perror("popen");
+        return 1;
+    }
+    for (long i = 0; i < SAMPLES; ++i) {
+        std::fprintf(pipe, "%s %.2f\n", isoTime(first + i * STEP).c_str(), 20.0 + (i % 50) / 10.0);
+    }
+
+    // Ближайший переход не раньше чем через 20 дней назад (БД хранит 30 дней): сутки до,
+    // сутки перехода и сутки после
+    std::time_t transition = last - 20 * 86400;
+    while (gmtOffset(transition) == gmtOffset(last - 20 * 86400) && transition < last + 400 * 86400) {
+        transition += 3600;
+    }
+    std::time_t dstFrom = addDays(localMidnight(transition), -1);
+    std::time_t dstTo = addDays(dstFrom, 3) - 1;
+    // Метки ввода - местное время без смещения, и повторяющийся при переходе на зимнее время
+    // час неотличим от первого: каждая метка выдается один раз
+    std::set<std::string> dstStamps[3];
+    for (std::time_t t = dstFrom; t <= dstTo; t += 60) {
+        std::string stamp = isoTime(t);
+        if (dstStamps[t < addDays(dstFrom, 1) ? 0 : t < addDays(dstFrom, 2) ? 1 : 2].insert(stamp).second) {
+            std::fprintf(pipe, "%s 21.00 1\n", stamp.c_str());
+        }
+    }
+    pclose(pipe);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::freopen("/dev/null", "w", stdout);
+        std::freopen("/dev/null", "w", stderr);
+        execl(server.c_str(), server.c_str(), "--port", std::to_string(port).c_str(), "--db", db.c_str(),
+              "--static", dir, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    std::string body;
+    for (int i = 0; i < 100 && !get(port, "/api/current", body); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    // Окна: все данные, 30 минут в середине, 7 минут на конце, 95 минут со сдвигом
+    struct Window {
+        std::time_t from;
+        std::time_t to;
+    };
+    std::vector<Window> windows = {
+        {first - 3600, last + 3600},
+        {first + 1800 + 13, first + 3600 + 13},
+        {last - 420, last},
+        {first + 7, first + 7 + 95 * 60},
+    };
+    for (const auto& w : windows) {
+        long expected = 0;
+        for (long i = 0; i < SAMPLES; ++i) {
+            std::time_t t = first + i * STEP;
+            if (t >= w.from && t <= w.to) expected++;
+        }
+        std::string range = "start=" + isoTime(w.from) + "&end=" + isoTime(w.to);
+
+        for (long maxPoints : {1L, 2L, 5L, 7L, 50L, 500L}) {
+            std::string path = "/api/stats?" + range + "&max_points=" + std::to_string(maxPoints);
+            std::string what = path;
+            if (!get(port, path, body)) {
+                check(false, what + ": request failed");
+                continue;
+            }
+            long points, total;
+            parseBuckets(body, points, total);
+            long bucket = bucketOf(body);
+            check(points >= 1 && points <= maxPoints,
+                  what + ": " + std::to_string(points) + " points");
+            check(total == expected,
+                  what + ": count " + std::to_string(total) + " != " + std::to_string(expected));
+            check(bucket < 3600 || (bucket % 3600 == 0 && (86400 % bucket == 0 || bucket % 86400 == 0)),
+                  what + ": bucket " + std::to_string(bucket));
+        }
+
+        for (long bucket : {60L, 3600L, 7200L}) {
+            std::string path = "/api/stats?" + range + "&bucket=" + std::to_string(bucket);
+            long points, total;
+            if (!get(port, path, body)) {
+                check(false, path + ": request failed");
+                continue;
+            }
+            parseBuckets(body, points, total);
+            check(total == expected,
+                  path + ": count " + std::to_string(total) + " != " + std::to_string(expected));
+        }
+    }
+
+    // Суточные корзины вокруг перехода: местная полночь, count - измерения местных суток
+    std::string dstRange = "start=" + isoTime(dstFrom) + "&end=" + isoTime(dstTo) + "&sensor=1";
+    std::string path = "/api/stats?" + dstRange + "&bucket=86400";
+    if (get(port, path, body)) {
+        std::vector<std::string> labels = labelsOf(body);
+        check(labels.size() == 3, path + ": " + std::to_string(labels.size()) + " buckets");
+        for (size_t i = 0; i < labels.size() && i < 3; ++i) {
+            std::time_t day = addDays(dstFrom, static_cast<int>(i));
+            check(labels[i] == isoTime(day), path + ": bucket " + labels[i] + " != " + isoTime(day));
+            size_t pos = body.find("\"count\":", body.find("\"timestamp\":\"" + labels[i]));
+            long count = pos == std::string::npos ? -1 : std::atol(body.c_str() + pos + 8);
+            check(count == static_cast<long>(dstStamps[i].size()),
+                  path + ": bucket " + labels[i] + " count " + std::to_string(count) + " != " +
+                  std::to_string(dstStamps[i].size()));
+        }
+    } else {
+        check(false, path + ": request failed");
+    }
+
+    long dstTotal = static_cast<long>(dstStamps[0].size() + dstStamps[1].size() + dstStamps[2].size());
+    for (std::string param : {"bucket=3600", "bucket=7200", "max_points=2", "max_points=5", "max_points=50"}) {
+        path = "/api/stats?" + dstRange + "&" + param;
+        long points, total;
+        if (!get(port, path, body)) {
+            check(false, path + ": request failed");
+            continue;
+        }
+        parseBuckets(body, points, total);
+        check(total == dstTotal, path + ": count " + std::to_string(total) + " != " + std::to_string(dstTotal));
+        if (param.compare(0, 11, "max_points=") == 0) {
+            check(points <= std::atol(param.c_str() + 11), path + ": " + std::to_string(points) + " points");
+        }
+    }
+
+    // Окно не с начала часа: метка первой корзины не раньше начала окна
+    std::time_t windowStart = addDays(dstFrom, 1) + 6 * 60 + 17;
+    path = "/api/stats?start=" + isoTime(windowStart) + "&end=" + isoTime(dstTo) + "&sensor=1&max_points=5";
+    if (get(port, path, body)) {
+        std::vector<std::string> labels = labelsOf(body);
+        check(!labels.empty() && labels[0] >= isoTime(windowStart),
+              path + ": first bucket " + (labels.empty() ? std::string("none") : labels[0]));
+    } else {
+        check(false, path + ": request failed");
+    }
+
+    kill(pid, SIGINT);
+    waitpid(pid, nullptr, 0);
+    std::system((std::string("rm -rf ") + dir).c_str());
+
+    if (failures > 0) {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "stats_test: OK" << std::endl;
+    return 0;
+}
@@ -4,11 +4,11 @@
 cd "$(dirname "$0")"
 
 if [ -f "temperature_gui.app/Contents/MacOS/temperature_gui" ]; then
-    open temperature_gui.app
+    open temperature_gui.app --args "$@"
 elif [ -f "build/temperature_gui" ]; then
-    ./build/temperature_gui
+    ./build/temperature_gui "$@"
 elif [ -f "./temperature_gui" ]; then
-    ./temperature_gui
+    ./temperature_gui "$@"
 else
     echo "Error: temperature_gui application not found"
     echo "Please run './build.sh' to build the application first"
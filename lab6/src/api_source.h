@@ -0,0 +1,201 @@
+#pragma once
+// Источник данных - HTTP API сервера lab5 (GET /api/stats, /api/current).
+//
+// Окно запрашивается целиком параметрами start/end, прореживание выполняет сервер:
+// если измерений в окне больше, чем точек на графике, передается max_points, и сервер
+// отдает средние по интервалам (для широких окон - из hourly_avg/daily_avg).
+// Запросы HTTP/1.0 без keep-alive: ответ читается до закрытия соединения.
+#include <cstring>
+#include <cstdlib>
+#include <string>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "Ws2_32.lib")
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netdb.h>
+    #include <unistd.h>
+#endif
+
+#include "data_source.h"
+
+namespace source {
+
+class ApiSource : public DataSource {
+public:
+    // url - http://host[:port]
+    ApiSource(const std::string& url, int sensor) : url(url), sensor(sensor) {
+        std::string rest = url.compare(0, 7, "http://") == 0 ? url.substr(7) : url;
+        rest = rest.substr(0, rest.find('/'));
+        size_t colon = rest.rfind(':');
+        host = colon == std::string::npos ? rest : rest.substr(0, colon);
+        port = colon == std::string::npos ? "8080" : rest.substr(colon + 1);
+#ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    }
+
+    ~ApiSource() override {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    std::string name() const override {
+        return "api " + url + " sensor " + std::to_string(sensor);
+    }
+
+    bool load(std::time_t from, std::time_t to, size_t columns) override {
+        std::string query = "?sensor=" + std::to_string(sensor) + "&start=" + formatTime(from) +
+                            "&end=" + formatTime(to);
+        // Около 5 с между измерениями: если их в окне больше, чем столбцов, прореживает сервер
+        if (columns > 0 && static_cast<size_t>((to - from) / 5) > columns) {
+            query += "&max_points=" + std::to_string(columns);
+        }
+
+        std::string body;
+        if (!get("/api/stats" + query, body)) {
+            return false;
+        }
+        data.clear();
+        forEachMeasurement(body, [this](std::time_t time, double temperature) {
+            data.append(static_cast<double>(time), temperature);
+        });
+
+        hasLatest = false;
+        if (get("/api/current?sensor=" + std::to_string(sensor), body)) {
+            forEachMeasurement(body, [this](std::time_t time, double temperature) {
+                hasLatest = true;
+                latestTime = static_cast<double>(time);
+                latestTemperature = temperature;
+            });
+        }
+        return true;
+    }
+
+    void forEachSeries(const std::function<void(const timeindex::Series&)>& visit) const override {
+        visit(data);
+    }
+
+    bool latest(double& time, double& temperature) const override {
+        if (!hasLatest) return false;
+        time = latestTime;
+        temperature = latestTemperature;
+        return true;
+    }
+
+private:
+    std::string url;
+    std::string host;
+    std::string port;
+    int sensor;
+    timestamp::Parser parser;
+
+    timeindex::Series data;
+    bool hasLatest = false;
+    double latestTime = 0.0;
+    double latestTemperature = 0.0;
+
+    static std::string formatTime(std::time_t t) {
+        std::tm tm{};
+#ifdef _WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+        return buf;
+    }
+
+    // Пары "timestamp":"YYYY-MM-DDTHH:MM:SS" ... "temperature":число в порядке ответа
+    template <typename Visit>
+    void forEachMeasurement(const std::string& body, Visit visit) {
+        static const char TIMESTAMP[] = "\"timestamp\":\"";
+        static const char TEMPERATURE[] = "\"temperature\":";
+        size_t pos = 0;
+        while ((pos = body.find(TIMESTAMP, pos)) != std::string::npos) {
+            pos += sizeof(TIMESTAMP) - 1;
+            std::time_t epoch;
+            bool ok = parser.parse(body.data() + pos, body.size() - pos, epoch);
+            size_t value = body.find(TEMPERATURE, pos);
+            if (value == std::string::npos) break;
+            pos = value + sizeof(TEMPERATURE) - 1;
+            const char* begin = body.c_str() + pos;
+            char* end;
+            double temperature = std::strtod(begin, &end);
+            if (ok && end != begin) {
+                visit(epoch, temperature);
+            }
+        }
+    }
+
+    // Тело ответа 200 на GET path
+    bool get(const std::string& path, std::string& body) {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+            std::cerr << "Cannot resolve " << host << std::endl;
+            return false;
+        }
+
+        int sock = -1;
+        for (addrinfo* a = addresses; a; a = a->ai_next) {
+            sock = static_cast<int>(socket(a->ai_family, a->ai_socktype, a->ai_protocol));
+            if (sock < 0) continue;
+            if (connect(sock, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) break;
+            closeSocket(sock);
+            sock = -1;
+        }
+        freeaddrinfo(addresses);
+        if (sock < 0) {
+            std::cerr << "Cannot connect to " << url << std::endl;
+            return false;
+        }
+
+        // Зависший сервер не должен держать загрузчик дольше нескольких секунд
+#ifdef _WIN32
+        DWORD timeout = 5000;
+#else
+        timeval timeout{5, 0};
+#endif
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+        std::string request = "GET " + path + " HTTP/1.0\r\nHost: " + host + "\r\n\r\n";
+        bool sent = send(sock, request.data(), static_cast<int>(request.size()), 0) ==
+                    static_cast<int>(request.size());
+
+        std::string response;
+        char buf[65536];
+        int n;
+        while (sent && (n = static_cast<int>(recv(sock, buf, sizeof(buf), 0))) > 0) {
+            response.append(buf, n);
+        }
+        closeSocket(sock);
+
+        size_t headersEnd = response.find("\r\n\r\n");
+        if (!sent || headersEnd == std::string::npos || response.compare(0, 7, "HTTP/1.") != 0 ||
+            response.compare(8, 5, " 200 ") != 0) {
+            std::cerr << "Request " << path << " to " << url << " failed" << std::endl;
+            return false;
+        }
+        body.assign(response, headersEnd + 4, std::string::npos);
+        return true;
+    }
+
+    static void closeSocket(int sock) {
+#ifdef _WIN32
+        closesocket(sock);
+#else
+        ::close(sock);
+#endif
+    }
+};
+
+}  // namespace source
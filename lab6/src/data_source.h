@@ -0,0 +1,314 @@
+#pragma once
+// Источники данных графика.
+//
+// DataSource загружает измерения для окна [from, to], которое показывает график, и отдает
+// их рядами, упорядоченными по времени (time_index.h). Реализации:
+//  - LogDirectorySource - журналы логгера lab6 (measurements.log, hourly_avg.log,
+//    daily_avg.log) и архив measurements.l5a или сегменты журналов логгера lab4
+//    (measurements/, hourly_avg/, daily_avg/) в одном каталоге;
+//  - ArchiveFileSource - файл архива (archive.h), например архив логгера lab5;
+//  - DatabaseSource - база lab5 measurements.db (db_source.h);
+//  - ApiSource - HTTP API сервера lab5 (api_source.h).
+// Источник сам решает, что перечитывать при повторном вызове load(): журналы дочитываются
+// с места остановки, база и API читают только окно.
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "timestamp.h"
+#include "archive.h"
+#include "log_tail.h"
+#include "time_index.h"
+
+namespace source {
+
+class DataSource {
+public:
+    virtual ~DataSource() = default;
+
+    // Описание для сообщений: тип и путь или адрес
+    virtual std::string name() const = 0;
+
+    // Загрузка данных окна [from, to] для графика шириной columns точек (источник может
+    // отдать средние за час/сутки, если измерений в окне намного больше). Возвращает true,
+    // если загруженные данные изменились.
+    virtual bool load(std::time_t from, std::time_t to, size_t columns) = 0;
+
+    // Загруженные ряды, каждый упорядочен по времени
+    virtual void forEachSeries(const std::function<void(const timeindex::Series&)>& visit) const = 0;
+
+    // Последнее измерение (время и температура), если источник его знает
+    virtual bool latest(double& time, double& temperature) const = 0;
+};
+
+// Файл архива: при каждом изменении файла или окна распаковываются только блоки окна
+class ArchiveFileSource : public DataSource {
+public:
+    explicit ArchiveFileSource(std::string path) : path(std::move(path)) {}
+
+    std::string name() const override {
+        return "archive " + path;
+    }
+
+    bool load(std::time_t from, std::time_t to, size_t) override {
+        logtail::FileStamp now = logtail::FileStamp::of(path);
+        if (loaded && now.sameContentStamp(stamp) && from == loadedFrom && to == loadedTo) {
+            return false;
+        }
+
+        bool had = !data.empty();
+        data.clear();
+        loaded = true;
+        loadedFrom = from;
+        loadedTo = to;
+        stamp = now;
+
+        archive::Reader reader;
+        if (!now.exists || !reader.open(path)) {
+            return had;
+        }
+        reader.scan(from, to, [this](std::time_t time, double temperature) {
+            data.append(static_cast<double>(time), temperature);
+        });
+        return true;
+    }
+
+    void forEachSeries(const std::function<void(const timeindex::Series&)>& visit) const override {
+        visit(data);
+    }
+
+    bool latest(double&, double&) const override {
+        return false;  // в архиве только старые измерения
+    }
+
+private:
+    std::string path;
+    logtail::FileStamp stamp;
+    bool loaded = false;
+    std::time_t loadedFrom = 0;
+    std::time_t loadedTo = 0;
+    timeindex::Series data;
+};
+
+// Журналы логгера в каталоге: файлы lab6 (measurements.log, hourly_avg.log, daily_avg.log)
+// и сегменты lab4 (measurements/YYYY-MM-DDTHH.log, hourly_avg/YYYY-MM-DD.log,
+// daily_avg/YYYY-MM.log). Файлы читаются целиком, но инкрементально: при повторной
+// загрузке разбираются только дописанные строки (log_tail.h), а переписанный или
+// замененный файл перечитывается с начала; у сегментов каждый файл - свой ряд, новые
+// сегменты добавляются, удаленные логгером отбрасываются. Окно выбирается из загруженного
+// по индексу.
+class LogDirectorySource : public DataSource {
+public:
+    explicit LogDirectorySource(const std::string& dir)
+        : dir(dir), archived(join(dir, "measurements.l5a")) {
+        measurements.tail = std::make_unique<logtail::Tail>(join(dir, "measurements.log"));
+        hourly.tail = std::make_unique<logtail::Tail>(join(dir, "hourly_avg.log"));
+        daily.tail = std::make_unique<logtail::Tail>(join(dir, "daily_avg.log"));
+    }
+
+    // Каталог с журналами: первый из кандидатов, где есть measurements.log, архив
+    // или каталог сегментов measurements/
+    static std::string findDirectory(const std::vector<std::string>& candidates) {
+        for (const auto& candidate : candidates) {
+            if (logtail::FileStamp::of(join(candidate, "measurements.log")).exists ||
+                logtail::FileStamp::of(join(candidate, "measurements.l5a")).exists ||
+                logtail::FileStamp::of(join(candidate, "measurements")).exists) {
+                return candidate;
+            }
+        }
+        return candidates.empty() ? "." : candidates.front();
+    }
+
+    std::string name() const override {
+        return "logs " + dir;
+    }
+
+    bool load(std::time_t from, std::time_t to, size_t columns) override {
+        // Измерения старше суток логгер переносит из measurements.log в архив
+        bool changed = archived.load(from, to, columns);
+        changed |= refresh(measurements, parseMeasurementLine);
+        changed |= refresh(hourly, parseHourlyLine);
+        changed |= refresh(daily, parseDailyLine);
+        changed |= refreshSegments(measurementSegments, parseMeasurementLine);
+        changed |= refreshSegments(hourlySegments, parseHourlyLine);
+        changed |= refreshSegments(dailySegments, parseDailyLine);
+        return changed;
+    }
+
+    void forEachSeries(const std::function<void(const timeindex::Series&)>& visit) const override {
+        archived.forEachSeries(visit);
+        visit(measurements.data);
+        visit(hourly.data);
+        visit(daily.data);
+        for (const Segments* segments : {&measurementSegments, &hourlySegments, &dailySegments}) {
+            for (const auto& segment : segments->logs) {
+                visit(segment.second.data);
+            }
+        }
+    }
+
+    bool latest(double& time, double& temperature) const override {
+        bool found = false;
+        auto consider = [&](const timeindex::Series& data) {
+            if (data.empty() || (found && data.times().back() < time)) return;
+            time = data.times().back();
+            temperature = data.values().back();
+            found = true;
+        };
+        consider(measurements.data);
+        // Сегменты упорядочены по имени, т.е. по времени: последний непустой - самый новый
+        for (auto it = measurementSegments.logs.rbegin(); it != measurementSegments.logs.rend(); ++it) {
+            if (!it->second.data.empty()) {
+                consider(it->second.data);
+                break;
+            }
+        }
+        return found;
+    }
+
+private:
+    struct Entry {
+        double time;
+        double temperature;
+    };
+
+    // Журнал, читаемый с места остановки
+    struct Log {
+        std::unique_ptr<logtail::Tail> tail;
+        timestamp::Parser parser;
+        timeindex::Series data;
+    };
+
+    // Каталог сегментов lab4: журнал на каждый файл *.log, по имени сегмента
+    struct Segments {
+        std::string dir;
+        std::map<std::string, Log> logs;
+    };
+
+    std::string dir;
+    ArchiveFileSource archived;
+    Log measurements;
+    Log hourly;
+    Log daily;
+    Segments measurementSegments{join(dir, "measurements"), {}};
+    Segments hourlySegments{join(dir, "hourly_avg"), {}};
+    Segments dailySegments{join(dir, "daily_avg"), {}};
+
+    static std::string join(const std::string& dir, const std::string& file) {
+        if (dir.empty() || dir == ".") return file;
+        char last = dir.back();
+        return last == '/' || last == '\\' ? dir + file : dir + "/" + file;
+    }
+
+    template <typename ParseLine>
+    static bool refresh(Log& log, ParseLine parseLine) {
+        std::vector<Entry> lines;
+        auto change = log.tail->poll([&](const char* line, size_t length) {
+            Entry entry;
+            if (parseLine(log.parser, line, length, entry)) {
+                lines.push_back(entry);
+            }
+        });
+
+        switch (change) {
+            case logtail::Tail::Change::None:
+                return false;
+            case logtail::Tail::Change::Reset:
+                std::cerr << "Reloading " << log.tail->path() << " (" << lines.size() << " entries)" << std::endl;
+                log.data.clear();
+                break;
+            case logtail::Tail::Change::Appended:
+                break;
+        }
+        for (const auto& entry : lines) {
+            log.data.append(entry.time, entry.temperature);
+        }
+        return true;
+    }
+
+    // Сегменты каталога: новые файлы добавляются, удаленные отбрасываются вместе с их рядами
+    template <typename ParseLine>
+    static bool refreshSegments(Segments& segments, ParseLine parseLine) {
+        std::map<std::string, bool> present;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(segments.dir, ec)) {
+            if (entry.path().extension() == ".log") {
+                present[entry.path().stem().string()] = true;
+            }
+        }
+
+        bool changed = false;
+        for (auto it = segments.logs.begin(); it != segments.logs.end();) {
+            if (present.count(it->first) == 0) {
+                it = segments.logs.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& name : present) {
+            Log& log = segments.logs[name.first];
+            if (!log.tail) {
+                log.tail = std::make_unique<logtail::Tail>(join(segments.dir, name.first + ".log"));
+            }
+            changed |= refresh(log, parseLine);
+        }
+        return changed;
+    }
+
+    // Строка measurements.log: YYYY-MM-DDTHH:MM:SS температура
+    static bool parseMeasurementLine(timestamp::Parser& parser, const char* line, size_t length, Entry& out) {
+        std::time_t epoch;
+        if (!parser.parse(line, length, epoch)) return false;
+
+        std::string value(line + 19, length - 19);
+        char* end;
+        double temp = std::strtod(value.c_str(), &end);
+        if (end == value.c_str()) return false;
+
+        out = {static_cast<double>(epoch), temp};
+        return true;
+    }
+
+    // Строка hourly_avg.log: YYYY-MM-DD час температура
+    static bool parseHourlyLine(timestamp::Parser& parser, const char* line, size_t length, Entry& out) {
+        if (length < 10) return false;
+        std::string rest(line + 10, length - 10);
+        const char* begin = rest.c_str();
+        char* end;
+        long hour = std::strtol(begin, &end, 10);
+        if (end == begin) return false;
+        begin = end;
+        double temp = std::strtod(begin, &end);
+        if (end == begin) return false;
+
+        std::time_t epoch;
+        if (!parser.parseDate(line, length, static_cast<int>(hour), 0, 0, epoch)) return false;
+        out = {static_cast<double>(epoch), temp};
+        return true;
+    }
+
+    // Строка daily_avg.log: YYYY-MM-DD температура (точка ставится на полдень)
+    static bool parseDailyLine(timestamp::Parser& parser, const char* line, size_t length, Entry& out) {
+        if (length < 10) return false;
+        std::string rest(line + 10, length - 10);
+        char* end;
+        double temp = std::strtod(rest.c_str(), &end);
+        if (end == rest.c_str()) return false;
+
+        std::time_t epoch;
+        if (!parser.parseDate(line, length, 12, 0, 0, epoch)) return false;
+        out = {static_cast<double>(epoch), temp};
+        return true;
+    }
+};
+
+}  // namespace source
@@ -0,0 +1,189 @@
+#pragma once
+// Источник данных - база lab5 measurements.db (схема описана в lab5/src/storage.h).
+//
+// База открывается только для чтения; фильтр по времени и датчику выполняет SQLite:
+// читаются только секции measurements_YYYYMMDD, пересекающиеся с окном. Если измерений
+// в окне намного больше, чем точек на графике, вместо них читаются средние из hourly_avg
+// или daily_avg - самая грубая таблица, у которой точек в окне не меньше ширины графика.
+// Повторная загрузка того же окна измерений дочитывает только новые строки.
+#include <sqlite3.h>
+
+#include <string>
+#include <vector>
+
+#include "data_source.h"
+
+namespace source {
+
+class DatabaseSource : public DataSource {
+public:
+    DatabaseSource(std::string path, int sensor) : path(std::move(path)), sensor(sensor) {}
+
+    ~DatabaseSource() override {
+        if (db) sqlite3_close(db);
+    }
+
+    DatabaseSource(const DatabaseSource&) = delete;
+    DatabaseSource& operator=(const DatabaseSource&) = delete;
+
+    std::string name() const override {
+        return "database " + path + " sensor " + std::to_string(sensor);
+    }
+
+    bool load(std::time_t from, std::time_t to, size_t columns) override {
+        if (!open()) return false;
+
+        // Чтение в одной транзакции: логгер может дописывать и удалять секции
+        exec("BEGIN");
+        long resolution = chooseResolution(from, to, columns);
+        bool changed;
+        if (resolution == 0 && loadedResolution == 0 && from == loadedFrom && to == loadedTo) {
+            // То же окно измерений: только строки новее загруженных
+            std::time_t since = data.empty() ? from : static_cast<std::time_t>(data.times().back()) + 1;
+            size_t before = data.size();
+            changed = readMeasurements(since, to);
+            changed = changed && data.size() != before;
+        } else {
+            data.clear();
+            changed = true;
+            bool ok = resolution == 0 ? readMeasurements(from, to)
+                                      : readAggregates(resolution == 3600 ? "hourly_avg" : "daily_avg",
+                                                       resolution == 3600 ? "hour_epoch" : "day_epoch",
+                                                       from, to);
+            if (ok) {
+                loadedResolution = resolution;
+                loadedFrom = from;
+                loadedTo = to;
+            } else {
+                loadedResolution = -1;
+            }
+        }
+        readLatest();
+        exec("COMMIT");
+        return changed;
+    }
+
+    void forEachSeries(const std::function<void(const timeindex::Series&)>& visit) const override {
+        visit(data);
+    }
+
+    bool latest(double& time, double& temperature) const override {
+        if (!hasLatest) return false;
+        time = latestTime;
+        temperature = latestTemperature;
+        return true;
+    }
+
+private:
+    std::string path;
+    int sensor;
+    sqlite3* db = nullptr;
+
+    timeindex::Series data;
+    long loadedResolution = -1;  // 0 - измерения, 3600/86400 - средние за час/сутки
+    std::time_t loadedFrom = 0;
+    std::time_t loadedTo = 0;
+
+    bool hasLatest = false;
+    double latestTime = 0.0;
+    double latestTemperature = 0.0;
+
+    bool open() {
+        if (db) return true;
+        if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+            std::cerr << "Cannot open " << path << ": " << sqlite3_errmsg(db) << std::endl;
+            sqlite3_close(db);
+            db = nullptr;
+            return false;
+        }
+        sqlite3_busy_timeout(db, 5000);
+        return true;
+    }
+
+    void exec(const char* sql) {
+        sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+    }
+
+    // 0 - измерения, иначе размер окна таблицы средних
+    static long chooseResolution(std::time_t from, std::time_t to, size_t columns) {
+        std::time_t range = to - from;
+        if (columns == 0 || range <= 0) return 0;
+        if (static_cast<size_t>(range / 86400) >= columns) return 86400;
+        if (static_cast<size_t>(range / 3600) >= columns) return 3600;
+        return 0;
+    }
+
+    bool readMeasurements(std::time_t from, std::time_t to) {
+        sqlite3_stmt* partitions;
+        if (sqlite3_prepare_v2(db, "SELECT name FROM measurement_partitions "
+                                   "WHERE end_epoch > ?1 AND start_epoch <= ?2 ORDER BY start_epoch",
+                               -1, &partitions, nullptr) != SQLITE_OK) {
+            std::cerr << "Query failed: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        sqlite3_bind_int64(partitions, 1, from);
+        sqlite3_bind_int64(partitions, 2, to);
+        std::vector<std::string> names;
+        while (sqlite3_step(partitions) == SQLITE_ROW) {
+            names.push_back(reinterpret_cast<const char*>(sqlite3_column_text(partitions, 0)));
+        }
+        sqlite3_finalize(partitions);
+
+        for (const auto& name : names) {
+            readSeries("SELECT epoch, temperature FROM " + name +
+                       " WHERE sensor = ?1 AND epoch >= ?2 AND epoch <= ?3 ORDER BY epoch", from, to);
+        }
+        return true;
+    }
+
+    bool readAggregates(const char* table, const char* column, std::time_t from, std::time_t to) {
+        return readSeries(std::string("SELECT ") + column + ", average FROM " + table +
+                          " WHERE sensor = ?1 AND " + column + " >= ?2 AND " + column + " <= ?3 ORDER BY " +
+                          column, from, to);
+    }
+
+    bool readSeries(const std::string& sql, std::time_t from, std::time_t to) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cerr << "Query failed: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+        sqlite3_bind_int(stmt, 1, sensor);
+        sqlite3_bind_int64(stmt, 2, from);
+        sqlite3_bind_int64(stmt, 3, to);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            data.append(static_cast<double>(sqlite3_column_int64(stmt, 0)), sqlite3_column_double(stmt, 1));
+        }
+        sqlite3_finalize(stmt);
+        return true;
+    }
+
+    // Последнее измерение датчика: самая новая секция, где он есть
+    void readLatest() {
+        hasLatest = false;
+        sqlite3_stmt* partitions;
+        if (sqlite3_prepare_v2(db, "SELECT name FROM measurement_partitions ORDER BY start_epoch DESC",
+                               -1, &partitions, nullptr) != SQLITE_OK) {
+            return;
+        }
+        while (!hasLatest && sqlite3_step(partitions) == SQLITE_ROW) {
+            std::string name = reinterpret_cast<const char*>(sqlite3_column_text(partitions, 0));
+            sqlite3_stmt* stmt;
+            if (sqlite3_prepare_v2(db, ("SELECT epoch, temperature FROM " + name +
+                                        " WHERE sensor = ? ORDER BY epoch DESC LIMIT 1").c_str(),
+                                   -1, &stmt, nullptr) != SQLITE_OK) {
+                continue;
+            }
+            sqlite3_bind_int(stmt, 1, sensor);
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                hasLatest = true;
+                latestTime = static_cast<double>(sqlite3_column_int64(stmt, 0));
+                latestTemperature = sqlite3_column_double(stmt, 1);
+            }
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_finalize(partitions);
+    }
+};
+
+}  // namespace source
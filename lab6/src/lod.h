@@ -0,0 +1,192 @@
+#pragma once
+// Прореживание ряда для графика: огибающая min/max по столбцам пикселей.
+//
+// На экран шириной W пикселей нельзя вывести больше W различимых столбцов, поэтому вместо
+// всех измерений диапазона рисуются минимум и максимум каждого столбца - форма кривой и
+// выбросы сохраняются, а число точек не превышает 2 * W при любом масштабе.
+//
+// Чтобы не просматривать все измерения при каждой перерисовке, над рядом строится пирамида:
+// узел уровня k хранит положение минимума и максимума FANOUT^k соседних измерений.
+// Для видимого диапазона выбирается самый грубый уровень, у которого на столбец приходится
+// хотя бы пара узлов, так что стоимость прореживания - O(W * FANOUT) и не зависит от
+// длины ряда. Минимум и максимум узла попадают в столбец, где они лежат по времени.
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace lod {
+
+class Pyramid {
+public:
+    static constexpr size_t FANOUT = 8;
+
+    // Ряд должен быть упорядочен по времени
+    Pyramid(std::vector<double> times, std::vector<double> values)
+        : t(std::move(times)), v(std::move(values)) {
+        build();
+    }
+
+    Pyramid() = default;
+
+    size_t size() const {
+        return t.size();
+    }
+
+    bool empty() const {
+        return t.empty();
+    }
+
+    const std::vector<double>& times() const {
+        return t;
+    }
+
+    const std::vector<double>& values() const {
+        return v;
+    }
+
+    // Точки (время, значение) диапазона [from, to] для columns столбцов в порядке времени.
+    // Соседние с диапазоном измерения тоже выдаются, чтобы линия доходила до краев.
+    // Возвращает true, если выданы сами измерения (их не больше 2 * columns).
+    template <typename Emit>
+    bool decimate(double from, double to, size_t columns, Emit emit) const {
+        size_t lo = static_cast<size_t>(std::lower_bound(t.begin(), t.end(), from) - t.begin());
+        size_t hi = static_cast<size_t>(std::upper_bound(t.begin(), t.end(), to) - t.begin());
+        if (lo > 0) lo--;
+        if (hi < t.size()) hi++;
+        if (lo >= hi) return true;
+
+        columns = std::max<size_t>(columns, 1);
+        if (hi - lo <= 2 * columns || !(to > from)) {
+            for (size_t i = lo; i < hi; ++i) emit(t[i], v[i]);
+            return true;
+        }
+
+        // Самый грубый уровень, где на столбец приходится не меньше двух узлов
+        size_t level = 0;
+        size_t span = 1;  // измерений в узле уровня level
+        while (level < levels.size() && (hi - lo) / (span * FANOUT) >= 2 * columns) {
+            level++;
+            span *= FANOUT;
+        }
+
+        Envelope envelope(from, to, columns);
+        size_t i = lo;
+        // Неполные узлы по краям диапазона разбираются по измерениям
+        size_t firstNode = (lo + span - 1) / span;
+        size_t lastNode = hi / span;
+        if (level == 0 || firstNode >= lastNode) {
+            for (; i < hi; ++i) envelope.add(t[i], v[i], i);
+        } else {
+            for (; i < firstNode * span; ++i) envelope.add(t[i], v[i], i);
+            const Level& nodes = levels[level - 1];
+            for (size_t n = firstNode; n < lastNode; ++n) {
+                uint32_t mn = nodes.minIndex[n];
+                uint32_t mx = nodes.maxIndex[n];
+                envelope.add(t[mn], v[mn], mn);
+                envelope.add(t[mx], v[mx], mx);
+            }
+            for (i = lastNode * span; i < hi; ++i) envelope.add(t[i], v[i], i);
+        }
+        envelope.emitTo(t, v, emit);
+        return false;
+    }
+
+private:
+    // Узлы одного уровня: индексы минимума и максимума в исходном ряду
+    struct Level {
+        std::vector<uint32_t> minIndex;
+        std::vector<uint32_t> maxIndex;
+    };
+
+    // Минимум и максимум каждого столбца
+    class Envelope {
+    public:
+        Envelope(double from, double to, size_t columns)
+            : start(from), scale(columns / (to - from)), minIndex(columns, NONE), maxIndex(columns, NONE),
+              minValue(columns), maxValue(columns) {}
+
+        void add(double time, double value, size_t index) {
+            double c = (time - start) * scale;
+            size_t column = c <= 0 ? 0 : std::min(static_cast<size_t>(c), minIndex.size() - 1);
+            uint32_t idx = static_cast<uint32_t>(index);
+            if (minIndex[column] == NONE) {
+                minIndex[column] = maxIndex[column] = idx;
+                minValue[column] = maxValue[column] = value;
+                return;
+            }
+            if (value < minValue[column]) {
+                minValue[column] = value;
+                minIndex[column] = idx;
+            }
+            if (value > maxValue[column]) {
+                maxValue[column] = value;
+                maxIndex[column] = idx;
+            }
+        }
+
+        template <typename Emit>
+        void emitTo(const std::vector<double>& t, const std::vector<double>& v, Emit& emit) const {
+            for (size_t c = 0; c < minIndex.size(); ++c) {
+                uint32_t a = minIndex[c];
+                uint32_t b = maxIndex[c];
+                if (a == NONE) continue;
+                if (a > b) std::swap(a, b);
+                emit(t[a], v[a]);
+                if (b != a) emit(t[b], v[b]);
+            }
+        }
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+        double start;
+        double scale;
+        std::vector<uint32_t> minIndex;
+        std::vector<uint32_t> maxIndex;
+        std::vector<double> minValue;
+        std::vector<double> maxValue;
+    };
+
+    std::vector<double> t;
+    std::vector<double> v;
+    std::vector<Level> levels;  // levels[k - 1] - уровень k
+
+    void build() {
+        // Уровень 1 - по измерениям, каждый следующий - по узлам предыдущего
+        size_t span = FANOUT;
+        while (t.size() > span) {
+            Level level;
+            size_t count = (t.size() + span - 1) / span;
+            level.minIndex.resize(count);
+            level.maxIndex.resize(count);
+            for (size_t n = 0; n < count; ++n) {
+                uint32_t mn, mx;
+                if (levels.empty()) {
+                    size_t begin = n * span;
+                    size_t end = std::min(begin + span, t.size());
+                    mn = mx = static_cast<uint32_t>(begin);
+                    for (size_t i = begin + 1; i < end; ++i) {
+                        if (v[i] < v[mn]) mn = static_cast<uint32_t>(i);
+                        if (v[i] > v[mx]) mx = static_cast<uint32_t>(i);
+                    }
+                } else {
+                    const Level& below = levels.back();
+                    size_t begin = n * FANOUT;
+                    size_t end = std::min(begin + FANOUT, below.minIndex.size());
+                    mn = below.minIndex[begin];
+                    mx = below.maxIndex[begin];
+                    for (size_t c = begin + 1; c < end; ++c) {
+                        if (v[below.minIndex[c]] < v[mn]) mn = below.minIndex[c];
+                        if (v[below.maxIndex[c]] > v[mx]) mx = below.maxIndex[c];
+                    }
+                }
+                level.minIndex[n] = mn;
+                level.maxIndex[n] = mx;
+            }
+            levels.push_back(std::move(level));
+            span *= FANOUT;
+        }
+    }
+};
+
+}  // namespace lod
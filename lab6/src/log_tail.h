@@ -0,0 +1,252 @@
+#pragma once
+// Инкрементальное чтение текстового журнала, который дописывается другим процессом.
+//
+// Tail помнит, до какого байта файл уже разобран, и при каждом poll() отдает только
+// строки, появившиеся после этого места. Файл отображается в память (mmap) целиком, но
+// страницы читаются лениво: обращения идут только к началу файла, нескольким байтам перед
+// разобранной границей и новым данным, поэтому стоимость опроса пропорциональна новым данным.
+//
+// Файл считается переписанным, и разбор начинается с начала (poll() возвращает Reset),
+// если сменился файл (другой inode - ротация, запись через временный файл и rename),
+// файл стал короче разобранного или изменились первые байты файла либо байты перед
+// разобранной границей (файл переписан на месте, например ofstream с trunc). Переписанный
+// файл, у которого эти байты совпали, читается как дописанный.
+//
+// Недописанная последняя строка (без '\n') не разбирается до следующего опроса.
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace logtail {
+
+// Идентичность и состояние файла
+struct FileStamp {
+    bool exists = false;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    std::time_t mtime = 0;
+    long mtimeNsec = 0;
+
+    static FileStamp of(const std::string& path) {
+        FileStamp s;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return s;
+        s.exists = true;
+        s.device = static_cast<uint64_t>(st.st_dev);
+        s.inode = static_cast<uint64_t>(st.st_ino);  // на Windows всегда 0
+        s.size = static_cast<uint64_t>(st.st_size);
+        s.mtime = st.st_mtime;
+#if defined(__APPLE__)
+        s.mtimeNsec = st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+        s.mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+        return s;
+    }
+
+    bool sameFile(const FileStamp& other) const {
+        return exists && other.exists && device == other.device && inode == other.inode;
+    }
+
+    bool sameContentStamp(const FileStamp& other) const {
+        return sameFile(other) && size == other.size && mtime == other.mtime && mtimeNsec == other.mtimeNsec;
+    }
+};
+
+// Содержимое файла в памяти: отображение на POSIX, чтение нужного диапазона на Windows
+class View {
+public:
+    View() = default;
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    ~View() {
+        release();
+    }
+
+    // Байты [from, size) файла плюс первые headBytes байтов
+    bool open(const std::string& path, uint64_t size, uint64_t from, size_t headBytes) {
+        release();
+        length = static_cast<size_t>(size);
+        if (length == 0) return true;
+#ifdef _WIN32
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        head.resize(std::min<size_t>(headBytes, length));
+        size_t got = std::fread(head.data(), 1, head.size(), f);
+        head.resize(got);
+        offset = static_cast<size_t>(std::min<uint64_t>(from, size));
+        tail.resize(length - offset);
+        std::fseek(f, static_cast<long>(offset), SEEK_SET);
+        got = std::fread(tail.data(), 1, tail.size(), f);
+        tail.resize(got);
+        length = offset + got;
+        std::fclose(f);
+        return true;
+#else
+        (void)from;
+        (void)headBytes;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            length = 0;
+            return false;
+        }
+        base = p;
+        return true;
+#endif
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // Указатель на байт pos (pos из запрошенных в open диапазонов)
+    const char* at(size_t pos) const {
+#ifdef _WIN32
+        return pos < head.size() && pos < offset ? head.data() + pos : tail.data() + (pos - offset);
+#else
+        return static_cast<const char*>(base) + pos;
+#endif
+    }
+
+private:
+    size_t length = 0;
+
+    void release() {
+#ifndef _WIN32
+        if (base) munmap(base, length);
+        base = nullptr;
+#endif
+        length = 0;
+    }
+
+#ifdef _WIN32
+    std::vector<char> head;
+    std::vector<char> tail;
+    size_t offset = 0;
+#else
+    void* base = nullptr;
+#endif
+};
+
+class Tail {
+public:
+    enum class Change {
+        None,      // новых строк нет
+        Appended,  // разобраны дописанные строки
+        Reset      // файл переписан или удален: прежние строки недействительны,
+                   // разобраны строки нового содержимого с начала
+    };
+
+    explicit Tail(std::string path) : filePath(std::move(path)) {}
+
+    const std::string& path() const {
+        return filePath;
+    }
+
+    // Разобрано байтов с начала файла
+    uint64_t offset() const {
+        return parsed;
+    }
+
+    // Новые полные строки передаются в onLine(const char* line, size_t length) без '\n'
+    template <typename OnLine>
+    Change poll(OnLine&& onLine) {
+        FileStamp now = FileStamp::of(filePath);
+        if (!now.exists) {
+            bool had = stamp.exists;
+            forget();
+            return had ? Change::Reset : Change::None;
+        }
+        if (now.sameContentStamp(stamp)) {
+            return Change::None;
+        }
+
+        bool reset = stamp.exists && (!now.sameFile(stamp) || now.size < parsed);
+        if (reset) forget();
+
+        // Проверяемые байты перед границей читаются вместе с новыми данными
+        uint64_t from = parsed - std::min<uint64_t>(parsed, FINGERPRINT);
+        View view;
+        if (!view.open(filePath, now.size, from, FINGERPRINT)) {
+            return reset ? Change::Reset : Change::None;
+        }
+        if (!reset && parsed > 0 && !fingerprintMatches(view)) {
+            reset = true;
+            forget();
+            if (!view.open(filePath, now.size, 0, FINGERPRINT)) {
+                return Change::Reset;
+            }
+        }
+
+        // Разбор до последнего '\n'
+        size_t pos = static_cast<size_t>(parsed);
+        size_t end = view.size();
+        bool any = false;
+        while (pos < end) {
+            const char* line = view.at(pos);
+            const char* nl = static_cast<const char*>(std::memchr(line, '\n', end - pos));
+            if (!nl) break;
+            size_t len = static_cast<size_t>(nl - line);
+            if (len > 0 && line[len - 1] == '\r') len--;
+            onLine(line, len);
+            pos += static_cast<size_t>(nl - line) + 1;
+            any = true;
+        }
+
+        parsed = pos;
+        saveFingerprint(view);
+        stamp = now;
+
+        if (reset) return Change::Reset;
+        return any ? Change::Appended : Change::None;
+    }
+
+private:
+    // Сколько байтов в начале файла и перед границей разбора сверяется
+    static constexpr uint64_t FINGERPRINT = 64;
+
+    std::string filePath;
+    FileStamp stamp;
+    uint64_t parsed = 0;
+    std::string head;  // первые байты файла
+    std::string tail;  // байты перед границей разбора
+
+    void forget() {
+        stamp = FileStamp();
+        parsed = 0;
+        head.clear();
+        tail.clear();
+    }
+
+    bool fingerprintMatches(const View& view) const {
+        if (view.size() < parsed) return false;
+        if (std::memcmp(view.at(0), head.data(), head.size()) != 0) return false;
+        return std::memcmp(view.at(static_cast<size_t>(parsed - tail.size())), tail.data(), tail.size()) == 0;
+    }
+
+    void saveFingerprint(const View& view) {
+        size_t headLength = static_cast<size_t>(std::min<uint64_t>(FINGERPRINT, parsed));
+        head.assign(view.at(0), headLength);
+        size_t tailLength = static_cast<size_t>(std::min<uint64_t>(FINGERPRINT, parsed));
+        tail.assign(view.at(static_cast<size_t>(parsed - tailLength)), tailLength);
+    }
+};
+
+}  // namespace logtail
@@ -6,6 +6,11 @@
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <cstdlib>
+
+#include "timestamp.h"
+#include "aggregates.h"
+#include "archive.h"
 
 using Clock = std::chrono::system_clock;
 
@@ -14,11 +19,32 @@ struct Measurement {
     double value;
 };
 
-Clock::time_point parseTime(const std::string& s) {
-    std::tm tm{};
-    std::istringstream ss(s);
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return Clock::from_time_t(std::mktime(&tm));
+// Строка симулятора "YYYY-MM-DDTHH:MM:SS temperature"
+bool parseLine(timestamp::Parser& parser, const std::string& line, std::time_t& epoch, std::tm& tm,
+               double& temp) {
+    if (!parser.parse(line.data(), line.size(), epoch, &tm)) return false;
+    const char* begin = line.c_str() + 19;
+    char* end;
+    temp = std::strtod(begin, &end);
+    return end != begin;
+}
+
+// Удаляет из журнала строки, для которых keep() ложно. Строки идут по времени, поэтому
+// если первая строка еще нужна, файл не трогается: переписывать его (и заставлять
+// читателей перечитывать файл целиком) имеет смысл только когда есть что удалять
+template <typename Keep>
+void pruneLog(const char* path, const char* tmpPath, Keep keep) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || keep(line)) return;
+
+    std::ofstream out(tmpPath);
+    do {
+        if (keep(line)) out << line << '\n';
+    } while (std::getline(in, line));
+    in.close();
+    out.close();
+    std::rename(tmpPath, path);
 }
 
 std::tm toTM(const Clock::time_point& tp) {
@@ -32,131 +58,111 @@ std::tm toTM(const Clock::time_point& tp) {
     return tm;
 }
 
+void writeMeasurement(std::ostream& out, const Measurement& m) {
+    std::tm tm = toTM(m.time);
+    out << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S") << " " << m.value << "\n";
+}
+
 int main() {
     std::deque<Measurement> measurements;
-    std::vector<Measurement> hourBuffer;
-    std::vector<Measurement> dayBuffer;
-
-    int currentHour = -1;
-    int currentDay  = -1;
-    int currentYear = -1;
+    // Средние за час и сутки считаются на лету, без буферов измерений
+    aggregate::Aggregator aggregator({aggregate::Window::Hour, aggregate::Window::Day});
+    std::vector<aggregate::Aggregator::Closed> closed;
+    bool started = false;
+
+    // Измерения старше суток уходят из measurements.log в архив measurements.l5a
+    archive::Writer archived;
+    if (!archived.open("measurements.l5a")) {
+        std::cerr << "Cannot open measurements.l5a, old measurements will not be archived" << std::endl;
+    }
 
+    timestamp::Parser parser;
+    timestamp::Parser hourlyParser;
     std::string line;
 
     while (std::getline(std::cin, line)) {
-        std::istringstream ss(line);
-        std::string ts;
+        std::time_t epoch;
+        std::tm tm;
         double temp;
 
-        ss >> ts >> temp;
-        auto tp = parseTime(ts);
-        auto tm = toTM(tp);
+        if (!parseLine(parser, line, epoch, tm, temp)) continue;
+        auto tp = Clock::from_time_t(epoch);
 
-        if (currentHour == -1) {
+        if (!started) {
             std::ofstream("hourly_avg.log", std::ios::app);
             std::ofstream("daily_avg.log", std::ios::app);
-            currentHour = tm.tm_hour;
-            currentDay  = tm.tm_mday;
-            currentYear = tm.tm_year;
+            std::ofstream("measurements.log", std::ios::trunc);  // начинается с текущего запуска
+            started = true;
         }
 
         measurements.push_back({tp, temp});
 
-        // Очистка измерений старше 24 часов
+        // Очистка измерений старше 24 часов. Устаревшие измерения переносятся в архив
+        // целыми блоками: пока блок не набран, они остаются в measurements.log,
+        // поэтому при сбое ничего не теряется
         auto now = Clock::now();
-        while (!measurements.empty() &&
-               now - measurements.front().time > std::chrono::hours(24)) {
-            measurements.pop_front();
+        size_t before = measurements.size();
+        size_t expired = 0;
+        while (expired < measurements.size() &&
+               now - measurements[expired].time > std::chrono::hours(24)) {
+            expired++;
         }
-
-        // Очистка daily_avg.log старше года
-        {
-            std::ifstream in("daily_avg.log");
-            std::ofstream out("daily_tmp.log");
-
-            std::string line;
-            while (std::getline(in, line)) {
-                std::tm t{};
-                std::istringstream ss(line);
-                ss >> std::get_time(&t, "%Y-%m-%d");
-
-                if (!ss.fail()) {
-                    // текущий или предыдущий календарный год
-                    if (t.tm_year == tm.tm_year ||
-                        t.tm_year == tm.tm_year - 1) {
-                        out << line << '\n';
-                    }
-                }
+        if (!archived.isOpen()) {
+            measurements.erase(measurements.begin(), measurements.begin() + expired);
+        } else if (expired >= archive::BLOCK_SAMPLES) {
+            bool ok = true;
+            for (size_t i = 0; i < expired && ok; ++i) {
+                ok = archived.append(Clock::to_time_t(measurements[i].time), measurements[i].value);
             }
-
-            in.close();
-            out.close();
-            std::rename("daily_tmp.log", "daily_avg.log");
-        }
-
-        // Очистка hourly_avg.log старше месяца
-        {
-            std::ifstream in("hourly_avg.log");
-            std::ofstream out("hourly_tmp.log");
-            std::string l;
-            while (std::getline(in, l)) {
-                std::tm t{};
-                std::istringstream s(l);
-                s >> std::get_time(&t, "%Y-%m-%d");
-                auto tp2 = Clock::from_time_t(std::mktime(&t));
-                if (now - tp2 < std::chrono::hours(24 * 30)) {
-                    out << l << "\n";
-                }
+            if (ok && archived.sync()) {
+                measurements.erase(measurements.begin(), measurements.begin() + expired);
+            } else {
+                // Повторное открытие отрезает недописанный блок, следующая попытка - с того же места
+                std::cerr << "Failed to write measurements.l5a" << std::endl;
+                archived.open("measurements.l5a");
             }
-            in.close(); out.close();
-            std::rename("hourly_tmp.log", "hourly_avg.log");
         }
 
-        // При смене часа сохраняем среднее за прошлый час
-        if (tm.tm_hour != currentHour) {
-            if (!hourBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : hourBuffer) sum += m.value;
-                double avg = sum / hourBuffer.size();
+        // Очистка daily_avg.log старше года
+        pruneLog("daily_avg.log", "daily_tmp.log", [&](const std::string& l) {
+            int year, month, day;
+            if (!timestamp::Parser::parseCalendarDate(l.data(), l.size(), year, month, day)) return false;
+            // текущий или предыдущий календарный год
+            return year - 1900 == tm.tm_year || year - 1900 == tm.tm_year - 1;
+        });
 
+        // Очистка hourly_avg.log старше месяца
+        pruneLog("hourly_avg.log", "hourly_tmp.log", [&](const std::string& l) {
+            std::time_t day;
+            if (!hourlyParser.parseDate(l.data(), l.size(), 0, 0, 0, day)) return false;
+            return now - Clock::from_time_t(day) < std::chrono::hours(24 * 30);
+        });
+
+        // При смене часа/суток сохраняем среднее за прошлый час/сутки
+        aggregator.add(tm, temp, closed);
+        for (const auto& c : closed) {
+            std::tm oldTm = toTM(Clock::from_time_t(c.start));
+            if (c.window == aggregate::Window::Hour) {
                 std::ofstream f("hourly_avg.log", std::ios::app);
-                std::tm oldTm = toTM(hourBuffer.front().time);
-
                 f << std::put_time(&oldTm, "%Y-%m-%d ")
-                << currentHour << " " << avg << "\n";
-            }
-
-            hourBuffer.clear();
-            currentHour = tm.tm_hour;
-        }
-        hourBuffer.push_back({tp, temp});
-
-        // При смене дня сохраняем среднее за прошлый день
-        if (tm.tm_mday != currentDay) {
-            if (!dayBuffer.empty()) {
-                double sum = 0;
-                for (auto& m : dayBuffer) sum += m.value;
-                double avg = sum / dayBuffer.size();
-
+                << oldTm.tm_hour << " " << c.stats.average() << "\n";
+            } else {
                 std::ofstream f("daily_avg.log", std::ios::app);
-                std::tm oldTm = toTM(dayBuffer.front().time);
                 f << std::put_time(&oldTm, "%Y-%m-%d ")
-                << avg << "\n";
+                << c.stats.average() << "\n";
             }
-
-            dayBuffer.clear();
-            currentDay = tm.tm_mday;
         }
-        dayBuffer.push_back({tp, temp});
-
-        // Перезапись measurements.log
-        {
+        closed.clear();
+
+        // Новое измерение дописывается в measurements.log; файл переписывается целиком,
+        // только если из него ушли устаревшие измерения
+        if (measurements.size() == before) {
+            std::ofstream f("measurements.log", std::ios::app);
+            writeMeasurement(f, measurements.back());
+        } else {
             std::ofstream f("measurements.log", std::ios::trunc);
             for (auto& m : measurements) {
-                std::tm tm = toTM(m.time);
-                f << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S")
-                    << " " << m.value << "\n";
-
+                writeMeasurement(f, m);
             }
         }
     }
@@ -1,32 +1,32 @@
 #include <iostream>
-#include <chrono>
-#include <thread>
-#include <random>
-#include <iomanip>
 #include <ctime>
+#include <string>
 
-std::string isoTime() {
-    std::time_t t = std::time(nullptr);
-    std::tm tm{};
-#ifdef _WIN32
-    localtime_s(&tm, &t);
-#else
-    localtime_r(&t, &tm);
-#endif
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
-    return buf;
-}
+#include "load_gen.h"
 
-int main() {
-    std::default_random_engine gen(std::random_device{}());
-    std::normal_distribution<double> temp(22.0, 2.0);
+int main(int argc, char* argv[]) {
+    loadgen::Options load;
+    for (int i = 1; i < argc; ++i) {
+        if (!load.parse(i, argc, argv)) {
+            std::cerr << "Usage: " << argv[0] << loadgen::Options::usage() << std::endl;
+            return 1;
+        }
+    }
 
-    while (true) {
-        std::cout << isoTime() << " "
-                  << std::fixed << std::setprecision(2)
-                  << temp(gen) << std::endl;
+    // Строка "YYYY-MM-DDTHH:MM:SS temperature"; номер датчика из журнала при повторе отбрасывается
+    loadgen::TextOutput out(false);
+    auto emit = [&](std::time_t epoch, double value, int sensor) {
+        out.append(epoch, value, sensor);
+    };
+    auto flush = [&] { return out.flush(); };
 
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+    if (!load.replay.empty()) {
+        if (loadgen::replay(load, emit, flush) < 0) {
+            std::cerr << "Cannot open " << load.replay << std::endl;
+            return 1;
+        }
+        return 0;
     }
+    loadgen::generate(load, 1, emit, flush);
+    return 0;
 }
@@ -15,14 +15,29 @@
 #include <QTextStream>
 #include <QDateTime>
 #include <QStringList>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QVector>
+#include <QPointF>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <string>
 #include <iomanip>
 #include <ctime>
 #include <cstdlib>
 #include <iostream>
 
+#include "lod.h"
+#include "time_index.h"
+#include "data_source.h"
+#include "db_source.h"
+#include "api_source.h"
+
 #include <qwt_plot.h>
 #include <qwt_plot_curve.h>
 #include <qwt_plot_grid.h>
@@ -30,12 +45,223 @@
 #include <qwt_legend.h>
 #include <qwt_date_scale_engine.h>
 #include <qwt_date_scale_draw.h>
+#include <qwt_series_data.h>
+#include <qwt_scale_map.h>
+#include <qwt_plot_panner.h>
+#include <qwt_plot_magnifier.h>
 
 struct TemperatureData {
     double timestamp;  // seconds since epoch
     double temperature;
 };
 
+// Result of one background load: everything the window needs to show the selected range.
+// Never modified after it is emitted, so the UI thread reads it without locking.
+struct DataSnapshot {
+    qint64 startTime = 0;        // requested range, seconds since epoch
+    qint64 endTime = 0;
+    lod::Pyramid series;         // samples in the range sorted by time, seconds
+    double minTemp = 0.0;
+    double maxTemp = 0.0;
+    double sum = 0.0;
+    bool hasCurrent = false;
+    double currentTemp = 0.0;    // newest measurement, regardless of the range
+    size_t totalLoaded = 0;      // samples held by all sources
+    qint64 loadMs = 0;           // time spent reading files and filtering
+};
+
+using DataSnapshotPtr = std::shared_ptr<const DataSnapshot>;
+Q_DECLARE_METATYPE(DataSnapshotPtr)
+
+// Owns the data sources and lives on a worker thread: file and database reading, range
+// filtering and statistics never run on the UI thread
+class DataLoader : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DataLoader(std::vector<std::unique_ptr<source::DataSource>> sources)
+        : sources(std::move(sources)) {}
+
+public slots:
+    // Loads [startTime, endTime] for a plot `columns` pixels wide
+    void load(qint64 startTime, qint64 endTime, int columns) {
+        QElapsedTimer timer;
+        timer.start();
+
+        bool changed = false;
+        for (const auto &source : sources) {
+            changed |= source->load(startTime, endTime, static_cast<size_t>(std::max(columns, 1)));
+        }
+        if (changed) {
+            std::cerr << "Total data points loaded: " << loadedCount() << std::endl;
+        }
+
+        auto snapshot = std::make_shared<DataSnapshot>();
+        snapshot->startTime = startTime;
+        snapshot->endTime = endTime;
+
+        // Each source is sorted by time: its part of the range is two binary searches and its
+        // sum a difference of prefix sums. The parts are merged into one time-ordered series in
+        // a single pass that also finds min/max for the plot scale.
+        struct Part {
+            const timeindex::Series *series;
+            size_t pos;
+            size_t end;
+        };
+        std::vector<Part> parts;
+        size_t count = 0;
+        forEachSeries([&](const timeindex::Series &series) {
+            timeindex::Range r = series.range(startTime, endTime);
+            if (r.empty()) return;
+            parts.push_back({&series, r.begin, r.end});
+            count += r.size();
+            snapshot->sum += series.sum(r);
+        });
+
+        std::vector<double> times;
+        std::vector<double> values;
+        times.reserve(count);
+        values.reserve(count);
+        while (!parts.empty()) {
+            size_t next = 0;
+            for (size_t p = 1; p < parts.size(); ++p) {
+                if (parts[p].series->times()[parts[p].pos] < parts[next].series->times()[parts[next].pos]) {
+                    next = p;
+                }
+            }
+            Part &part = parts[next];
+            double temperature = part.series->values()[part.pos];
+            if (values.empty()) {
+                snapshot->minTemp = snapshot->maxTemp = temperature;
+            }
+            snapshot->minTemp = std::min(snapshot->minTemp, temperature);
+            snapshot->maxTemp = std::max(snapshot->maxTemp, temperature);
+            times.push_back(part.series->times()[part.pos]);
+            values.push_back(temperature);
+            if (++part.pos == part.end) {
+                parts.erase(parts.begin() + next);
+            }
+        }
+
+        snapshot->series = lod::Pyramid(std::move(times), std::move(values));
+        // Newest measurement among the sources that know it
+        double newest = 0.0;
+        for (const auto &source : sources) {
+            double time, temperature;
+            if (source->latest(time, temperature) && (!snapshot->hasCurrent || time > newest)) {
+                snapshot->hasCurrent = true;
+                snapshot->currentTemp = temperature;
+                newest = time;
+            }
+        }
+        snapshot->totalLoaded = loadedCount();
+        snapshot->loadMs = timer.elapsed();
+
+        emit loaded(DataSnapshotPtr(std::move(snapshot)));
+    }
+
+signals:
+    void loaded(DataSnapshotPtr snapshot);
+
+private:
+    std::vector<std::unique_ptr<source::DataSource>> sources;
+
+    size_t loadedCount() const {
+        size_t count = 0;
+        forEachSeries([&](const timeindex::Series &series) {
+            count += series.size();
+        });
+        return count;
+    }
+
+    // Visits the series of every source
+    void forEachSeries(const std::function<void(const timeindex::Series &)> &visit) const {
+        for (const auto &source : sources) {
+            source->forEachSeries(visit);
+        }
+    }
+};
+
+// Curve samples for the visible part of a snapshot: at most two points (min and max) per
+// pixel column, taken from the snapshot's pyramid (see lod.h). Recomputed only when the
+// visible interval or the canvas width changes, so zoom and pan cost O(width).
+class DecimatedSeries : public QwtSeriesData<QPointF> {
+public:
+    explicit DecimatedSeries(DataSnapshotPtr snapshot) : snapshot(std::move(snapshot)) {
+        const lod::Pyramid &series = this->snapshot->series;
+        if (!series.empty()) {
+            bounds = QRectF(QPointF(series.times().front() * 1000.0, this->snapshot->minTemp),
+                            QPointF(series.times().back() * 1000.0, this->snapshot->maxTemp));
+        }
+    }
+
+    size_t size() const override {
+        return points.size();
+    }
+
+    QPointF sample(size_t i) const override {
+        return points[static_cast<int>(i)];
+    }
+
+    // Whole series, so autoscaling does not depend on the current zoom
+    QRectF boundingRect() const override {
+        return bounds;
+    }
+
+    // Decimates [fromMs, toMs] to the given number of pixel columns
+    void update(double fromMs, double toMs, int width) const {
+        if (fromMs > toMs) std::swap(fromMs, toMs);
+        if (fromMs == shownFrom && toMs == shownTo && width == columns) return;
+        shownFrom = fromMs;
+        shownTo = toMs;
+        columns = width;
+
+        points.clear();
+        raw = snapshot->series.decimate(fromMs / 1000.0, toMs / 1000.0, static_cast<size_t>(width),
+                                        [this](double time, double temperature) {
+                                            points.append(QPointF(time * 1000.0, temperature));
+                                        });
+    }
+
+    // Samples are shown one by one and sparse enough to mark each with a symbol
+    bool sparse() const {
+        return raw && points.size() * 4 <= columns;
+    }
+
+private:
+    DataSnapshotPtr snapshot;
+    QRectF bounds;
+
+    mutable QVector<QPointF> points;
+    mutable double shownFrom = 0.0;
+    mutable double shownTo = -1.0;
+    mutable int columns = 0;
+    mutable bool raw = true;
+};
+
+// Curve that decimates its DecimatedSeries to the visible interval right before painting
+class DecimatedCurve : public QwtPlotCurve {
+public:
+    using QwtPlotCurve::QwtPlotCurve;
+
+protected:
+    void drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap,
+                    const QRectF &canvasRect, int, int) const override {
+        const auto *series = static_cast<const DecimatedSeries *>(data());
+        int width = qMax(1, qRound(qAbs(xMap.p2() - xMap.p1())));
+        series->update(xMap.s1(), xMap.s2(), width);
+        QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, 0, -1);
+    }
+
+    // A symbol per sample only where the samples are far apart
+    void drawSymbols(QPainter *painter, const QwtSymbol &symbol, const QwtScaleMap &xMap,
+                     const QwtScaleMap &yMap, const QRectF &canvasRect, int from, int to) const override {
+        if (static_cast<const DecimatedSeries *>(data())->sparse()) {
+            QwtPlotCurve::drawSymbols(painter, symbol, xMap, yMap, canvasRect, from, to);
+        }
+    }
+};
+
 class TemperatureGUI : public QMainWindow {
     Q_OBJECT
 
@@ -49,11 +275,34 @@ private:
     QComboBox *periodComboBox;
     QTimer *updateTimer;
 
-    std::vector<TemperatureData> allData;
+    QThread loaderThread;
+    DataLoader *loader;
+    bool loading = false;        // a load request is being processed by the loader
+    bool reloadPending = false;  // refresh requested while loading: run once more afterwards
+    qint64 shownStart = 0;       // range the axes were last set for: zoom and pan are kept
+    qint64 shownEnd = -1;        // while the timer refreshes the same range
+
+signals:
+    void loadRequested(qint64 startTime, qint64 endTime, int columns);
 
 public:
-    TemperatureGUI(QWidget *parent = nullptr) : QMainWindow(parent) {
-        setWindowTitle("Temperature Monitor - Temperature Sensor Data Viewer");
+    explicit TemperatureGUI(std::vector<std::unique_ptr<source::DataSource>> sources, QWidget *parent = nullptr)
+        : QMainWindow(parent) {
+        qRegisterMetaType<DataSnapshotPtr>();
+
+        // Loader runs on its own thread; signals between it and the window are queued
+        QStringList names;
+        for (const auto &source : sources) {
+            names << QString::fromStdString(source->name());
+        }
+        loader = new DataLoader(std::move(sources));
+        loader->moveToThread(&loaderThread);
+        connect(&loaderThread, &QThread::finished, loader, &QObject::deleteLater);
+        connect(this, &TemperatureGUI::loadRequested, loader, &DataLoader::load);
+        connect(loader, &DataLoader::loaded, this, &TemperatureGUI::showSnapshot);
+        loaderThread.start();
+
+        setWindowTitle("Temperature Monitor - " + names.join(", "));
         setGeometry(100, 100, 1400, 800);
 
         QWidget *centralWidget = new QWidget(this);
@@ -99,6 +348,11 @@ public:
         QwtLegend *legend = new QwtLegend();
         plot->insertLegend(legend, QwtPlot::BottomLegend);
 
+        // Drag to pan, mouse wheel to zoom the time axis
+        new QwtPlotPanner(plot->canvas());
+        QwtPlotMagnifier *magnifier = new QwtPlotMagnifier(plot->canvas());
+        magnifier->setAxisEnabled(QwtPlot::yLeft, false);
+
         mainLayout->addWidget(plot, 1);
 
         // Control section
@@ -180,23 +434,52 @@ public:
         updateTimer->start(5000);  // Update every 5 seconds
 
         // Initial load
-        loadAllData();
         updatePlot();
     }
 
     ~TemperatureGUI() {
         updateTimer->stop();
+        loaderThread.quit();
+        loaderThread.wait();
     }
 
 private slots:
+    // Asks the loader for the selected range. Requests made while a load is running are
+    // coalesced into a single reload with the range current at the time it starts.
     void updatePlot() {
-        QDateTime startDT = startDateEdit->dateTime();
-        QDateTime endDT = endDateEdit->dateTime();
+        if (loading) {
+            reloadPending = true;
+            return;
+        }
+        loading = true;
+        emit loadRequested(startDateEdit->dateTime().toSecsSinceEpoch(),
+                           endDateEdit->dateTime().toSecsSinceEpoch(), plot->canvas()->width());
+    }
+
+    void showSnapshot(DataSnapshotPtr snapshot) {
+        loading = false;
+
+        plotData(snapshot);
+        updateStatistics(*snapshot);
+
+        if (snapshot->totalLoaded == 0) {
+            statusLabel->setText("No data available. Is the logger running?");
+            statusLabel->setStyleSheet("color: #ff0000;");
+        } else {
+            statusLabel->setStyleSheet("color: #008000;");
+            if (snapshot->series.empty()) {
+                statusLabel->setText("No data in selected range");
+            } else {
+                statusLabel->setText("Updated: " + QDateTime::currentDateTime().toString("hh:mm:ss") +
+                                     QString(" (%1 points, loaded in %2 ms)")
+                                         .arg(snapshot->series.size()).arg(snapshot->loadMs));
+            }
+        }
 
-        loadAllData();
-        plotData(startDT, endDT);
-        updateStatistics(startDT, endDT);
-        statusLabel->setText("Updated: " + QDateTime::currentDateTime().toString("hh:mm:ss"));
+        if (reloadPending) {
+            reloadPending = false;
+            updatePlot();
+        }
     }
 
     void onPeriodChanged(int index) {
@@ -225,175 +508,22 @@ private slots:
     }
 
 private:
-    std::string findLogFile(const std::string &filename) {
-        // Try multiple search paths
-        std::vector<std::string> searchPaths = {
-            filename,                           // Current directory
-            "src/" + filename,                  // src/ subdirectory
-            "../src/" + filename,               // parent/src/
-        };
-        
-        // Add home directory path if HOME is set
-        const char* home = getenv("HOME");
-        if (home) {
-            searchPaths.push_back(std::string(home) + "/Documents/University/os/lab6/src/" + filename);
-        }
-        
-        for (const auto &path : searchPaths) {
-            std::ifstream test(path);
-            if (test.good()) {
-                std::cerr << "Found log file at: " << path << std::endl;
-                return path;
-            }
-        }
-        
-        std::cerr << "WARNING: Could not find " << filename << " in any standard location" << std::endl;
-        return filename;  // Return original if not found
-    }
-
-    void loadAllData() {
-        allData.clear();
-
-        // Find and load from measurements.log (current measurements)
-        std::string measFile = findLogFile("measurements.log");
-        loadFromFile(measFile);
-
-        // Find and load from hourly_avg.log
-        std::string hourlyFile = findLogFile("hourly_avg.log");
-        loadHourlyData(hourlyFile);
-
-        // Find and load from daily_avg.log
-        std::string dailyFile = findLogFile("daily_avg.log");
-        loadDailyData(dailyFile);
-
-        std::cerr << "Total data points loaded: " << allData.size() << std::endl;
-
-        if (allData.empty()) {
-            statusLabel->setText("No data available. Is the logger running?");
-            statusLabel->setStyleSheet("color: #ff0000;");
-        } else {
-            statusLabel->setStyleSheet("color: #008000;");
-        }
-    }
-
-    void loadFromFile(const std::string &filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            std::cerr << "Could not open: " << filename << std::endl;
-            return;
-        }
-
-        int count = 0;
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string timestamp;
-            double temp;
-
-            if (iss >> timestamp >> temp) {
-                TemperatureData data;
-                data.temperature = temp;
-
-                // Parse ISO 8601 timestamp: YYYY-MM-DDTHH:MM:SS
-                std::tm tm = {};
-                std::istringstream ts_stream(timestamp);
-                ts_stream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-
-                if (ts_stream.fail()) continue;
-
-                data.timestamp = std::mktime(&tm);
-                allData.push_back(data);
-                count++;
-            }
-        }
-        file.close();
-        std::cerr << "Loaded " << count << " entries from " << filename << std::endl;
-    }
-
-    void loadHourlyData(const std::string &filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            return;
-        }
-
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string dateStr;
-            int hour;
-            double temp;
-
-            if (iss >> dateStr >> hour >> temp) {
-                TemperatureData data;
-                data.temperature = temp;
-
-                // Parse date: YYYY-MM-DD
-                std::tm tm = {};
-                std::istringstream date_stream(dateStr);
-                date_stream >> std::get_time(&tm, "%Y-%m-%d");
-
-                if (date_stream.fail()) continue;
-
-                tm.tm_hour = hour;
-                data.timestamp = std::mktime(&tm);
-                allData.push_back(data);
-            }
+    void plotData(const DataSnapshotPtr &snapshot) {
+        // Update current temperature
+        if (snapshot->hasCurrent) {
+            currentTempDisplay->display(snapshot->currentTemp);
         }
-        file.close();
-    }
 
-    void loadDailyData(const std::string &filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
+        if (snapshot->series.empty()) {
             return;
         }
 
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string dateStr;
-            double temp;
-
-            if (iss >> dateStr >> temp) {
-                TemperatureData data;
-                data.temperature = temp;
-
-                // Parse date: YYYY-MM-DD
-                std::tm tm = {};
-                std::istringstream date_stream(dateStr);
-                date_stream >> std::get_time(&tm, "%Y-%m-%d");
-
-                if (date_stream.fail()) continue;
-
-                tm.tm_hour = 12;  // Noon
-                data.timestamp = std::mktime(&tm);
-                allData.push_back(data);
-            }
-        }
-        file.close();
-    }
-
-    void plotData(const QDateTime &startDT, const QDateTime &endDT) {
-        double startTime = startDT.toSecsSinceEpoch();
-        double endTime = endDT.toSecsSinceEpoch();
-
-        QwtPlotCurve *curve = new QwtPlotCurve("Temperature");
+        // The curve draws a per-pixel min/max envelope of the series, never all samples
+        DecimatedCurve *curve = new DecimatedCurve("Temperature");
         curve->setStyle(QwtPlotCurve::Lines);
         curve->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-
-        QVector<QPointF> points;
-        for (const auto &data : allData) {
-            if (data.timestamp >= startTime && data.timestamp <= endTime) {
-                points.append(QPointF(data.timestamp * 1000.0, data.temperature));
-            }
-        }
-
-        if (points.isEmpty()) {
-            statusLabel->setText("No data in selected range");
-            return;
-        }
-
-        curve->setSamples(points);
+        curve->setPaintAttribute(QwtPlotCurve::FilterPoints, true);
+        curve->setData(new DecimatedSeries(snapshot));
 
         // Style
         QPen pen;
@@ -410,45 +540,22 @@ private:
         // Attach new curve
         curve->attach(plot);
 
-        // Set scales
-        plot->setAxisScale(QwtPlot::xBottom, startTime * 1000.0, endTime * 1000.0);
+        // Set scales, unless this is a refresh of the range the user is zoomed or panned into
+        if (snapshot->startTime != shownStart || snapshot->endTime != shownEnd) {
+            shownStart = snapshot->startTime;
+            shownEnd = snapshot->endTime;
+            plot->setAxisScale(QwtPlot::xBottom, snapshot->startTime * 1000.0, snapshot->endTime * 1000.0);
 
-        if (!points.isEmpty()) {
-            double minTemp = points[0].y();
-            double maxTemp = points[0].y();
-            for (const auto &p : points) {
-                minTemp = std::min(minTemp, p.y());
-                maxTemp = std::max(maxTemp, p.y());
-            }
-            double margin = (maxTemp - minTemp) * 0.1;
-            plot->setAxisScale(QwtPlot::yLeft, minTemp - margin, maxTemp + margin);
+            double margin = (snapshot->maxTemp - snapshot->minTemp) * 0.1;
+            plot->setAxisScale(QwtPlot::yLeft, snapshot->minTemp - margin, snapshot->maxTemp + margin);
         }
 
         plot->replot();
-
-        // Update current temperature
-        if (!allData.empty()) {
-            const auto &latest = allData.back();
-            currentTempDisplay->display(latest.temperature);
-        }
     }
 
-    void updateStatistics(const QDateTime &startDT, const QDateTime &endDT) {
-        double startTime = startDT.toSecsSinceEpoch();
-        double endTime = endDT.toSecsSinceEpoch();
-
-        double sum = 0.0;
-        int count = 0;
-
-        for (const auto &data : allData) {
-            if (data.timestamp >= startTime && data.timestamp <= endTime) {
-                sum += data.temperature;
-                count++;
-            }
-        }
-
-        if (count > 0) {
-            double average = sum / count;
+    void updateStatistics(const DataSnapshot &snapshot) {
+        if (!snapshot.series.empty()) {
+            double average = snapshot.sum / snapshot.series.size();
             averageTempDisplay->setText(QString::number(average, 'f', 2) + " °C");
         } else {
             averageTempDisplay->setText("-- °C");
@@ -458,7 +565,50 @@ private:
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
-    TemperatureGUI gui;
+
+    // Data sources:
+    //   --logs DIR   lab6 logger logs or lab4 log segments (measurements/, hourly_avg/, daily_avg/);
+    //                default: ., src/ or ../src/ with measurements.log or measurements/
+    //   --db FILE    lab5 measurements.db
+    //   --api URL    lab5 server, e.g. http://localhost:8080
+    //   --sensor N   sensor shown from --db/--api (default 0)
+    //   FILE         archive file, e.g. written by the lab5 logger --archive
+    QStringList logDirs, databases, apis, archives;
+    int sensor = 0;
+    QStringList args = app.arguments().mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        const QString &arg = args[i];
+        bool hasValue = i + 1 < args.size();
+        if (arg == "--logs" && hasValue) logDirs << args[++i];
+        else if (arg == "--db" && hasValue) databases << args[++i];
+        else if (arg == "--api" && hasValue) apis << args[++i];
+        else if (arg == "--sensor" && hasValue) sensor = args[++i].toInt();
+        else if (!arg.startsWith("--")) archives << arg;
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--logs DIR] [--db FILE] [--api URL] [--sensor N] [ARCHIVE...]" << std::endl;
+            return 1;
+        }
+    }
+    if (logDirs.isEmpty() && databases.isEmpty() && apis.isEmpty()) {
+        logDirs << QString::fromStdString(source::LogDirectorySource::findDirectory({".", "src", "../src"}));
+    }
+
+    std::vector<std::unique_ptr<source::DataSource>> sources;
+    for (const QString &dir : logDirs) {
+        sources.push_back(std::make_unique<source::LogDirectorySource>(dir.toStdString()));
+    }
+    for (const QString &path : databases) {
+        sources.push_back(std::make_unique<source::DatabaseSource>(path.toStdString(), sensor));
+    }
+    for (const QString &url : apis) {
+        sources.push_back(std::make_unique<source::ApiSource>(url.toStdString(), sensor));
+    }
+    for (const QString &path : archives) {
+        sources.push_back(std::make_unique<source::ArchiveFileSource>(path.toStdString()));
+    }
+
+    TemperatureGUI gui(std::move(sources));
     gui.show();
     return app.exec();
 }
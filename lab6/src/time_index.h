@@ -0,0 +1,92 @@
+#pragma once
+// Ряд измерений, упорядоченный по времени, в виде отдельных массивов времени и значений
+// (structure of arrays) с префиксными суммами значений.
+//
+// Выбор диапазона [from, to] - два двоичных поиска по массиву времени, сумма и среднее за
+// диапазон - разность двух префиксных сумм, т.е. O(log n) и O(1) без просмотра измерений.
+// Журналы дописываются по времени, поэтому добавление в конец - O(1); измерение из прошлого
+// вставляется на свое место с пересчетом сумм после него.
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace timeindex {
+
+// Измерения [begin, end) ряда
+struct Range {
+    size_t begin = 0;
+    size_t end = 0;
+
+    size_t size() const {
+        return end - begin;
+    }
+
+    bool empty() const {
+        return begin == end;
+    }
+};
+
+class Series {
+public:
+    void clear() {
+        t.clear();
+        v.clear();
+        prefix.assign(1, 0.0);
+    }
+
+    void append(double time, double value) {
+        if (t.empty() || time >= t.back()) {
+            t.push_back(time);
+            v.push_back(value);
+            prefix.push_back(prefix.back() + value);
+            return;
+        }
+        // Вставка после измерений с тем же временем
+        size_t pos = static_cast<size_t>(std::upper_bound(t.begin(), t.end(), time) - t.begin());
+        t.insert(t.begin() + pos, time);
+        v.insert(v.begin() + pos, value);
+        prefix.push_back(0.0);
+        for (size_t i = pos; i < v.size(); ++i) {
+            prefix[i + 1] = prefix[i] + v[i];
+        }
+    }
+
+    size_t size() const {
+        return t.size();
+    }
+
+    bool empty() const {
+        return t.empty();
+    }
+
+    const std::vector<double>& times() const {
+        return t;
+    }
+
+    const std::vector<double>& values() const {
+        return v;
+    }
+
+    // Измерения со временем в [from, to]
+    Range range(double from, double to) const {
+        Range r;
+        r.begin = static_cast<size_t>(std::lower_bound(t.begin(), t.end(), from) - t.begin());
+        r.end = static_cast<size_t>(std::upper_bound(t.begin() + r.begin, t.end(), to) - t.begin());
+        return r;
+    }
+
+    double sum(const Range& r) const {
+        return prefix[r.end] - prefix[r.begin];
+    }
+
+    double average(const Range& r) const {
+        return r.empty() ? 0.0 : sum(r) / r.size();
+    }
+
+private:
+    std::vector<double> t;
+    std::vector<double> v;
+    std::vector<double> prefix = {0.0};  // prefix[i] - сумма v[0..i)
+};
+
+}  // namespace timeindex